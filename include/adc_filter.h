@@ -0,0 +1,173 @@
+#ifndef ADC_FILTER_H_
+#define ADC_FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * \file adc_filter.h
+ */
+
+/**
+ * \defgroup adc_filter_module ADC filter
+ *
+ * \brief Compile-time configured filter stage for ADC samples
+ *
+ * Each analog sensor runs its samples through three integer stages, all
+ *   sized by a configuration struct picked at compile time:
+ *
+ * * median of the last MEDIAN_N samples, a sliding window - rejects single
+ *   sample spikes (switching noise, a relay kick) without costing extra
+ *   conversions;
+ * * oversampling and decimation - 4^OVERSAMPLE_BITS medians are summed and
+ *   shifted right by OVERSAMPLE_BITS, giving OVERSAMPLE_BITS extra bits of
+ *   resolution when the input carries at least 1 LSB of noise;
+ * * exponential moving average over the decimated outputs,
+ *   y += (x - y) / 2^EMA_SHIFT, kept with EMA_SHIFT fractional bits so
+ *   small steps are not lost to truncation.
+ *
+ * A stage is bypassed with MEDIAN_N = 1, OVERSAMPLE_BITS = 0 or
+ *   EMA_SHIFT = 0. Outputs have 10 + OVERSAMPLE_BITS bits.
+ *
+ * \code
+ * typedef AdcFilterConfig<3, 2, 2> NtcFilterConfig;   // 16 samples per output
+ * static AdcFilter<NtcFilterConfig> filter;
+ * if (filter.push(sample)) { code = filter.value(); }
+ * \endcode
+ *
+ * @{
+ */
+
+/**
+ * \brief Filter configuration
+ *
+ * @tparam MEDIAN - median window, odd, 1 to 7 samples
+ * @tparam OVERSAMPLE - extra bits from oversampling, 0 to 4
+ * @tparam EMA - EMA weight of a new output is 1 / 2^EMA, 0 to 8
+ */
+template <uint8_t MEDIAN, uint8_t OVERSAMPLE, uint8_t EMA>
+struct AdcFilterConfig
+{
+    static_assert((MEDIAN & 1U) && (MEDIAN <= 7U), "median window must be odd, up to 7 samples");
+    static_assert(OVERSAMPLE <= 4U, "up to 4 extra bits - 256 samples per output");
+    static_assert(EMA <= 8U, "EMA shift up to 8");
+
+    static constexpr uint8_t MEDIAN_N = MEDIAN;                 //!< Median window, in samples
+    static constexpr uint8_t OVERSAMPLE_BITS = OVERSAMPLE;      //!< Extra resolution bits
+    static constexpr uint8_t EMA_SHIFT = EMA;                   //!< EMA weight, as a shift
+    static constexpr uint16_t SAMPLES_PER_OUTPUT = (uint16_t)(1U << (2U * OVERSAMPLE));  //!< 4^OVERSAMPLE_BITS
+    static constexpr uint8_t RESULT_BITS = (uint8_t)(10U + OVERSAMPLE);                    //!< Output resolution
+};
+
+template <class CONFIG>
+class AdcFilter
+{
+public:
+    AdcFilter(void) { reset(); }
+
+    /** Drops the filter state - the next output restarts the average */
+    void reset(void)
+    {
+        restart();
+        average = 0;
+        primed = false;
+        last_decimated = 0;
+    }
+
+    /** Drops the median window and the partial sum, keeping the average - a new series of samples starts */
+    void restart(void)
+    {
+        window_count = 0;
+        window_next = 0;
+        sum = 0;
+        sum_count = 0;
+    }
+
+    /**
+     * \brief Feeds one ADC sample
+     *
+     * @param [in] sample - 10 bit ADC code
+     * @return true when a new output is ready - after SAMPLES_PER_OUTPUT medians
+     */
+    bool push(uint16_t sample)
+    {
+        window[window_next] = sample;
+        if (++window_next >= CONFIG::MEDIAN_N)
+        {
+            window_next = 0;
+        }
+        if (window_count < CONFIG::MEDIAN_N)
+        {
+            window_count++;
+        }
+
+        sum += median();
+        if (++sum_count < CONFIG::SAMPLES_PER_OUTPUT)
+        {
+            return false;
+        }
+
+        /* Decimation, rounded */
+        last_decimated = (uint16_t)((sum + ((1UL << CONFIG::OVERSAMPLE_BITS) >> 1)) >> CONFIG::OVERSAMPLE_BITS);
+        sum = 0;
+        sum_count = 0;
+
+        if (primed)
+        {
+            average = average - (average >> CONFIG::EMA_SHIFT) + last_decimated;
+        }
+        else
+        {
+            average = (uint32_t)last_decimated << CONFIG::EMA_SHIFT;
+            primed = true;
+        }
+        return true;
+    }
+
+    /** Filtered output, RESULT_BITS bits */
+    uint16_t value(void) const
+    {
+        return (uint16_t)((average + ((1UL << CONFIG::EMA_SHIFT) >> 1)) >> CONFIG::EMA_SHIFT);
+    }
+
+    /** Last decimated output, before the EMA - for range checks that must not lag */
+    uint16_t decimated(void) const
+    {
+        return last_decimated;
+    }
+
+private:
+    /** Median of the window - while it fills, of the samples it holds */
+    uint16_t median(void) const
+    {
+        uint16_t sorted[CONFIG::MEDIAN_N];
+        for (uint8_t i = 0; i < window_count; i++)
+        {
+            /* Insertion sort - at most 7 entries */
+            uint16_t v = window[i];
+            uint8_t j = i;
+            while ((j > 0U) && (sorted[j - 1U] > v))
+            {
+                sorted[j] = sorted[j - 1U];
+                j--;
+            }
+            sorted[j] = v;
+        }
+        return sorted[window_count / 2U];
+    }
+
+    uint16_t window[CONFIG::MEDIAN_N];  //!< Last samples, circular
+    uint8_t  window_count;              //!< Samples in the window
+    uint8_t  window_next;               //!< Next window slot written
+    uint32_t sum;                       //!< Medians summed for the current output
+    uint16_t sum_count;                 //!< Medians in 'sum'
+    uint32_t average;                   //!< EMA state, EMA_SHIFT fractional bits
+    bool     primed;                    //!< 'average' holds an output
+    uint16_t last_decimated;            //!< Last decimated output
+};
+
+/**  @}
+ * End of adc_filter_module group definition
+ */
+
+#endif /* ADC_FILTER_H_ */
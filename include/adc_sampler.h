@@ -0,0 +1,51 @@
+#ifndef ADC_SAMPLER_H_
+#define ADC_SAMPLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * \file adc_sampler.h
+ */
+
+/**
+ *  \addtogroup adc_sampler_module
+ *  @{
+ */
+
+/** Samples kept per channel - a power of two */
+#define ADC_RING_SIZE 16U
+
+/**
+ * \brief Sampled analog channels, in schedule order
+ */
+typedef enum AdcChannel
+{
+    ADC_CHANNEL_NTC,                //!< NTC divider (A0), AVcc reference
+    ADC_CHANNEL_MIC,                //!< Analog microphone (A1), AVcc reference - not fitted yet
+    ADC_CHANNEL_MCU_TEMPERATURE,    //!< Internal temperature sensor, 1.1V reference
+    ADC_CHANNEL_COUNT               //!< Number of channels, not a channel
+} ADC_CHANNEL_t;
+
+/**
+ * \brief Sampler counters, by channel
+ */
+typedef struct AdcStats
+{
+    uint16_t samples[ADC_CHANNEL_COUNT];        //!< Samples stored
+    uint16_t overwritten[ADC_CHANNEL_COUNT];    //!< Samples dropped unread from a full ring
+    uint16_t reference_switches;                //!< Reference changes, each one waits a settling time
+} ADC_STATS_t;
+
+void ADC_SAMPLER_run(TASKS_t running_task);
+void AdcSamplerEnable(ADC_CHANNEL_t channel, bool enable);
+uint8_t AdcSamplerAvailable(ADC_CHANNEL_t channel);
+uint8_t AdcSamplerRead(ADC_CHANNEL_t channel, uint16_t *samples, uint8_t max_samples);
+void AdcSamplerGetStats(ADC_STATS_t *stats);
+void AdcSamplerReportStats(void);
+
+/**  @}
+ * End of adc_sampler_module group inclusion
+ */
+
+#endif /* ADC_SAMPLER_H_ */
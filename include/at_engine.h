@@ -0,0 +1,63 @@
+#ifndef AT_ENGINE_H_
+#define AT_ENGINE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tasks.h"
+
+/**
+ * \file at_engine.h
+ */
+
+/**
+ *  \addtogroup at_engine_module
+ *  @{
+ */
+
+/** Commands waiting or running, at most */
+#define AT_QUEUE_SIZE        4U
+/** Longest inbound +IPD payload kept - longer ones are truncated */
+#define AT_IPD_MAX          32U
+
+/**
+ * \brief Command result, written to the caller's result variable
+ */
+typedef enum AtResult
+{
+    AT_PENDING = 0,     //!< Queued or running
+    AT_OK,              //!< "OK", or "SEND OK" for a payload
+    AT_ERROR,           //!< "ERROR"/"FAIL"/"SEND FAIL", or the link closed during a send
+    AT_TIMEOUT          //!< No final response within the command's timeout
+} AT_RESULT_t;
+
+/** Inbound data handler - gets each +IPD payload */
+typedef void (*AT_IPD_HANDLER_t)(const uint8_t *data, uint8_t len);
+/** Link closed handler - the ESP-01 printed "CLOSED" */
+typedef void (*AT_CLOSED_HANDLER_t)(void);
+
+/**
+ * \brief Engine statistics
+ */
+typedef struct AtStats
+{
+    uint16_t commands;      //!< Commands completed
+    uint16_t errors;        //!< Completed with AT_ERROR
+    uint16_t timeouts;      //!< Completed with AT_TIMEOUT
+    uint16_t ipd_frames;    //!< +IPD payloads received
+    uint16_t ipd_truncated; //!< +IPD payloads longer than AT_IPD_MAX
+} AT_STATS_t;
+
+void AT_ENGINE_run(TASKS_t running_task);
+bool AtEngineCommand(const char *command, uint16_t timeout_ms, AT_RESULT_t *result);
+bool AtEngineSend(const uint8_t *payload, uint16_t len, uint16_t timeout_ms, AT_RESULT_t *result);
+bool AtEngineIdle(void);
+void AtEngineSetHandlers(AT_IPD_HANDLER_t ipd_handler, AT_CLOSED_HANDLER_t closed_handler);
+void AtEngineGetStats(AT_STATS_t *stats);
+void AtEngineReportStats(void);
+
+/**  @}
+ * End of at_engine_module group inclusion
+ */
+
+#endif /* AT_ENGINE_H_ */
@@ -1,8 +1,30 @@
 #ifndef DHT11_ACCESS_H_
 #define DHT11_ACCESS_H_
 
+/**
+ * \brief DHT read statistics, since power on
+ */
+typedef struct DhtStats
+{
+    uint16_t reads;             //!< Read attempts, retries included
+    uint16_t good_reads;        //!< Good frames
+    uint16_t retries;           //!< Reads made to retry a failed one
+    uint16_t give_ups;          //!< Failures with no retry left
+    uint16_t timeout_response;  //!< Timeouts with no sensor response
+    uint16_t timeout_ready;     //!< Timeouts after the response, before the data
+    uint16_t timeout_data;      //!< Timeouts in the middle of the data
+    uint16_t frame_errors;      //!< Bits of invalid width - lost or spurious edges
+    uint16_t checksum_errors;   //!< Frames failing the checksum
+} DHT_STATS_t;
+
 void DHT11_run(TASKS_t running_task);
+void Dht11GetStats(DHT_STATS_t *stats);
+void Dht11ReportStats(void);
 float Dht11GetHumidity(void);
 float Dht11GetTemperature(void);
 
+#ifdef BENCHMARK
+void Dht11Benchmark(void);
+#endif
+
 #endif /* DHT11_ACCESS_H_ */
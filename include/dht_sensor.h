@@ -0,0 +1,95 @@
+#ifndef DHT_SENSOR_H_
+#define DHT_SENSOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * \file dht_sensor.h
+ */
+
+/**
+ * \defgroup dht_sensor_module DHT sensor family
+ *
+ * \brief Compile-time sensor policies for the DHT11/DHT22/AM2302 driver
+ *
+ * The sensors of the family share the single wire protocol - host start
+ *   signal, 80us/80us response, 40 bits of 50us low plus 26-28us ("0") or
+ *   70us ("1") high, checksum byte - so the driver (dht11_access.cpp)
+ *   captures every frame the same way. What differs is carried by a policy
+ *   struct: the start signal length, the minimum interval between reads,
+ *   the bit timing limits and the decode of the 4 data bytes.
+ *
+ * The policy is picked at build time with -D DHT_SENSOR=<policy> (default:
+ *   Dht11Policy) and reached through static members only, so there is no
+ *   run time dispatch.
+ *
+ * Decoded values are fixed point: temperature in tenths of degree Celsius,
+ *   relative humidity in tenths of percent.
+ *
+ * @{
+ */
+
+/** Data bytes of a frame, checksum included */
+#define DHT_FRAME_BYTES 5U
+
+/**
+ * \brief DHT11: integer humidity and temperature, 0 to 50 C
+ */
+struct Dht11Policy
+{
+    static constexpr uint8_t  START_SIGNAL_MS = 25U;    //!< Host start signal low time - 18ms minimum
+    static constexpr uint16_t MIN_INTERVAL_MS = 1000U;  //!< Minimum interval between two reads
+    static constexpr uint8_t  FRAME_TIMEOUT_MS = 10U;   //!< Frame timeout, from the line release
+    static constexpr uint8_t  BIT_MIN_US = 60U;         //!< Shortest valid bit (falling edge to falling edge)
+    static constexpr uint8_t  BIT_ONE_MIN_US = 100U;    //!< Shortest "1" bit
+    static constexpr uint8_t  BIT_MAX_US = 170U;        //!< Longest valid bit
+
+    /** Byte 0: humidity, byte 1: its tenths; byte 2: temperature, byte 3: its tenths */
+    static inline void decode(const uint8_t data[DHT_FRAME_BYTES], int16_t *temperature, uint16_t *humidity)
+    {
+        *humidity = (uint16_t)(data[0] * 10U + data[1]);
+        *temperature = (int16_t)(data[2] * 10U + data[3]);
+    }
+};
+
+/**
+ * \brief DHT22: 16 bit humidity and temperature in tenths, sign and magnitude temperature
+ */
+struct Dht22Policy
+{
+    static constexpr uint8_t  START_SIGNAL_MS = 2U;     //!< Host start signal low time - 1ms typical
+    static constexpr uint16_t MIN_INTERVAL_MS = 2000U;  //!< Minimum interval between two reads
+    static constexpr uint8_t  FRAME_TIMEOUT_MS = 10U;   //!< Frame timeout, from the line release
+    static constexpr uint8_t  BIT_MIN_US = 60U;         //!< Shortest valid bit (falling edge to falling edge)
+    static constexpr uint8_t  BIT_ONE_MIN_US = 100U;    //!< Shortest "1" bit
+    static constexpr uint8_t  BIT_MAX_US = 170U;        //!< Longest valid bit
+
+    /** Bytes 0-1: humidity; bytes 2-3: temperature, bit 15 is the sign */
+    static inline void decode(const uint8_t data[DHT_FRAME_BYTES], int16_t *temperature, uint16_t *humidity)
+    {
+        *humidity = (uint16_t)(((uint16_t)data[0] << 8) | data[1]);
+        int16_t magnitude = (int16_t)((((uint16_t)data[2] & 0x7FU) << 8) | data[3]);
+        *temperature = (data[2] & 0x80U) ? (int16_t)-magnitude : magnitude;
+    }
+};
+
+/**
+ * \brief AM2302: the wired DHT22 - same framing and timing
+ */
+struct Am2302Policy : Dht22Policy
+{
+};
+
+#ifndef DHT_SENSOR
+#define DHT_SENSOR Dht11Policy
+#endif
+
+/** Sensor policy selected for the build */
+typedef DHT_SENSOR DhtSensor;
+
+/**  @}
+ * End of dht_sensor_module group definition
+ */
+
+#endif /* DHT_SENSOR_H_ */
@@ -0,0 +1,26 @@
+#ifndef EEPROM_MAP_H_
+#define EEPROM_MAP_H_
+
+#include <stdint.h>
+
+/**
+ * \file eeprom_map.h
+ *
+ * \brief EEPROM layout - every module's persistent data has its fixed area here
+ *
+ * Areas are given as byte addresses and sizes; each module checks at
+ *   compile time that its record fits its area.
+ */
+
+/** EEPROM size (ATmega328P) */
+#define EEPROM_SIZE                   1024U
+
+/** MCU temperature sensor two point calibration */
+#define EEPROM_MCU_CALIBRATION_ADDR   0x000U
+#define EEPROM_MCU_CALIBRATION_SIZE   16U
+
+/** Store-and-forward ring of the readings taken while the uplink is down - the rest of the EEPROM */
+#define EEPROM_SAMPLE_STORE_ADDR      (EEPROM_MCU_CALIBRATION_ADDR + EEPROM_MCU_CALIBRATION_SIZE)
+#define EEPROM_SAMPLE_STORE_SIZE      (EEPROM_SIZE - EEPROM_SAMPLE_STORE_ADDR)
+
+#endif /* EEPROM_MAP_H_ */
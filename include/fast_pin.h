@@ -0,0 +1,145 @@
+#ifndef FAST_PIN_H_
+#define FAST_PIN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <Arduino.h>
+
+/**
+ * \file fast_pin.h
+ */
+
+/**
+ * \defgroup fast_pin_module Fast pin
+ *
+ * \brief Compile-time resolved GPIO access
+ *
+ * digitalRead()/digitalWrite() look the pin's port, bit mask and timer up
+ *   in flash tables at run time, and digitalWrite() also masks interrupts
+ *   around its read-modify-write - several microseconds per call on the Uno.
+ *
+ * FastPin<N> resolves the PORT, DDR and PIN registers and the bit mask of
+ *   Uno pin N (D0..D13, A0..A5 as 14..19) at compile time. Those registers
+ *   are in the I/O space, so set()/clear() compile to a single sbi/cbi -
+ *   atomic, no interrupt masking needed - and read() to a single in or
+ *   sbis/sbic. The pin must not be driven by a PWM output (analogWrite()).
+ *
+ * \code
+ * FastPin<4>::setOutput();
+ * FastPin<4>::clear();          // Ligar ventilador
+ * if (FastPin<3>::read()) { ... }
+ * \endcode
+ *
+ * On the native build the accesses go to the HAL pin state, with no
+ *   virtual time charged.
+ *
+ * @{
+ */
+
+template <uint8_t PIN>
+class FastPin
+{
+    static_assert(PIN < 20U, "Uno pins are 0..19");
+
+public:
+    /** Configures the pin as an output */
+    static inline void setOutput(void)
+    {
+#ifdef NATIVE_BUILD
+        HalPinMode(PIN, OUTPUT);
+#else
+        ddr() |= MASK;
+#endif
+    }
+
+    /** Configures the pin as a floating input */
+    static inline void setInput(void)
+    {
+#ifdef NATIVE_BUILD
+        HalPinMode(PIN, INPUT);
+#else
+        ddr() &= (uint8_t)~MASK;
+        port() &= (uint8_t)~MASK;
+#endif
+    }
+
+    /** Configures the pin as an input with pull-up */
+    static inline void setInputPullup(void)
+    {
+#ifdef NATIVE_BUILD
+        HalPinMode(PIN, INPUT_PULLUP);
+#else
+        ddr() &= (uint8_t)~MASK;
+        port() |= MASK;
+#endif
+    }
+
+    /** Drives the pin high (output) or enables its pull-up (input) */
+    static inline void set(void)
+    {
+#ifdef NATIVE_BUILD
+        HalPinWrite(PIN, HIGH);
+#else
+        port() |= MASK;
+#endif
+    }
+
+    /** Drives the pin low (output) or disables its pull-up (input) */
+    static inline void clear(void)
+    {
+#ifdef NATIVE_BUILD
+        HalPinWrite(PIN, LOW);
+#else
+        port() &= (uint8_t)~MASK;
+#endif
+    }
+
+    /** Writes a level - a single sbi/cbi when 'level' is a constant */
+    static inline void write(bool level)
+    {
+        if (level)
+        {
+            set();
+        }
+        else
+        {
+            clear();
+        }
+    }
+
+    /** Toggles an output - writing the PIN register bit toggles PORT on the AVR */
+    static inline void toggle(void)
+    {
+#ifdef NATIVE_BUILD
+        HalPinWrite(PIN, HalPinRead(PIN) ? LOW : HIGH);
+#else
+        pin() = MASK;
+#endif
+    }
+
+    /** Reads the pin level */
+    static inline bool read(void)
+    {
+#ifdef NATIVE_BUILD
+        return HIGH == HalPinRead(PIN);
+#else
+        return 0U != (pin() & MASK);
+#endif
+    }
+
+private:
+    /** Bit of the pin in its port: PORTD holds D0..D7, PORTB D8..D13, PORTC A0..A5 */
+    static constexpr uint8_t MASK = (uint8_t)(1U << ((PIN < 8U) ? PIN : ((PIN < 14U) ? (PIN - 8U) : (PIN - 14U))));
+
+#ifndef NATIVE_BUILD
+    static inline volatile uint8_t &port(void) { return (PIN < 8U) ? PORTD : ((PIN < 14U) ? PORTB : PORTC); }
+    static inline volatile uint8_t &ddr(void)  { return (PIN < 8U) ? DDRD  : ((PIN < 14U) ? DDRB  : DDRC);  }
+    static inline volatile uint8_t &pin(void)  { return (PIN < 8U) ? PIND  : ((PIN < 14U) ? PINB  : PINC);  }
+#endif
+};
+
+/**  @}
+ * End of fast_pin_module group definition
+ */
+
+#endif /* FAST_PIN_H_ */
@@ -0,0 +1,240 @@
+#ifndef FSM_H_
+#define FSM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <Arduino.h>
+
+#include "timer.h"
+
+/**
+ * \file fsm.h
+ */
+
+/**
+ * \defgroup fsm_module Table driven FSM
+ *
+ * \brief State machine engine for the drivers, described by constexpr tables
+ *
+ * A driver describes its state machine with two tables instead of a
+ *   hand written setState() switch:
+ *
+ * * a state table, indexed by state, holding for each state its entry
+ *   action, its state action - run from the driver's task, returning the
+ *   next state (its own state to stay) - and an optional guard timeout,
+ *   in ms since the state was entered, with the state it leads to;
+ * * a transition table listing every allowed (from, to) pair. Any other
+ *   transition is refused and reported.
+ *
+ * Both tables are constexpr, so their consistency - state table in state
+ *   order, timeout targets allowed - is checked at compile time with
+ *   FsmStatesIndexed() and FsmTimeoutsAllowed().
+ *
+ * Fsm::run() chains transitions: when a state action moves to another
+ *   state, that state's entry and state actions run in the same call, so a
+ *   state that only passes control on costs no extra task period. The
+ *   chain is bounded by the number of states.
+ *
+ * With -D FSM_TRACE every transition is printed, with the system time.
+ *
+ * \code
+ * static constexpr FsmStateConfig<MY_STATE_t> my_states[] =
+ * {
+ *     { MY_IDLE, &idleEntry, &idleRun, 0U,   MY_IDLE },
+ *     { MY_BUSY, &busyEntry, &busyRun, 100U, MY_IDLE },
+ * };
+ * static constexpr FsmTransition<MY_STATE_t> my_transitions[] =
+ * {
+ *     { MY_IDLE, MY_BUSY }, { MY_BUSY, MY_IDLE },
+ * };
+ * static Fsm<MY_STATE_t, 2, 2> my_fsm("MY", my_states, my_transitions, MY_IDLE);
+ * \endcode
+ *
+ * @{
+ */
+
+/**
+ * \brief State table entry
+ */
+template <typename STATE>
+struct FsmStateConfig
+{
+    STATE    state;         //!< State described - the table is indexed by state
+    void   (*entry)(void);  //!< Entry action, or NULL
+    STATE  (*run)(void);    //!< State action, returns the next state, or NULL
+    uint16_t timeout;       //!< Guard timeout, in ms since the state was entered - 0: none
+    STATE    on_timeout;    //!< State entered when the guard times out
+};
+
+/**
+ * \brief Allowed transition
+ */
+template <typename STATE>
+struct FsmTransition
+{
+    STATE from;
+    STATE to;
+};
+
+/** The state table holds entry i for state i */
+template <typename STATE>
+constexpr bool FsmStatesIndexed(const FsmStateConfig<STATE> *states, uint8_t count, uint8_t i = 0)
+{
+    return (i >= count) || (((uint8_t)states[i].state == i) && FsmStatesIndexed(states, count, (uint8_t)(i + 1U)));
+}
+
+/** (from, to) is in the transition table */
+template <typename STATE>
+constexpr bool FsmTransitionAllowed(const FsmTransition<STATE> *transitions, uint8_t count, STATE from, STATE to,
+                                    uint8_t i = 0)
+{
+    return (i < count) &&
+           (((transitions[i].from == from) && (transitions[i].to == to)) ||
+            FsmTransitionAllowed(transitions, count, from, to, (uint8_t)(i + 1U)));
+}
+
+/** Every guard timeout leads to an allowed transition */
+template <typename STATE>
+constexpr bool FsmTimeoutsAllowed(const FsmStateConfig<STATE> *states, uint8_t state_count,
+                                  const FsmTransition<STATE> *transitions, uint8_t transition_count, uint8_t i = 0)
+{
+    return (i >= state_count) ||
+           (((0U == states[i].timeout) ||
+             FsmTransitionAllowed(transitions, transition_count, states[i].state, states[i].on_timeout)) &&
+            FsmTimeoutsAllowed(states, state_count, transitions, transition_count, (uint8_t)(i + 1U)));
+}
+
+template <typename STATE, uint8_t STATE_COUNT, uint8_t TRANSITION_COUNT>
+class Fsm
+{
+public:
+    /**
+     * @param [in] name - name shown in the trace and error messages
+     * @param [in] states - state table, in state order
+     * @param [in] transitions - allowed transitions
+     * @param [in] initial - state held until start() - its entry action is not run
+     */
+    constexpr Fsm(const char *name, const FsmStateConfig<STATE> (&states)[STATE_COUNT],
+                  const FsmTransition<STATE> (&transitions)[TRANSITION_COUNT], STATE initial)
+        : name(name), states(states), transitions(transitions), current(initial), entry_time(0U)
+    {
+    }
+
+    /** Enters a state unconditionally, running its entry action - power on, reset */
+    void start(STATE initial)
+    {
+        enter(initial);
+    }
+
+    /** Current state */
+    STATE state(void) const
+    {
+        return current;
+    }
+
+    /** System time the current state was entered at, in ms */
+    uint32_t entryTime(void) const
+    {
+        return entry_time;
+    }
+
+    /**
+     * \brief Moves to another state, if the transition table allows it
+     *
+     * Requesting the current state is a no-op.
+     *
+     * @return false if the transition was refused
+     */
+    bool setState(STATE next)
+    {
+        if (next == current)
+        {
+            return true;
+        }
+        if (!FsmTransitionAllowed(transitions, TRANSITION_COUNT, current, next))
+        {
+            Serial.print("[FSM ");
+            Serial.print(name);
+            Serial.print("] invalid transition ");
+            Serial.print((int)current);
+            Serial.print(" -> ");
+            Serial.println((int)next);
+            return false;
+        }
+        trace(next, false);
+        enter(next);
+        return true;
+    }
+
+    /**
+     * \brief Runs the current state - call from the driver's task
+     *
+     * Checks the guard timeout, then runs the state action, following
+     *   the transitions it asks for within the same call.
+     */
+    void run(void)
+    {
+        for (uint8_t step = 0; step < STATE_COUNT; step++)
+        {
+            const FsmStateConfig<STATE> *config = &states[current];
+            STATE next = current;
+            bool timeout = (config->timeout > 0U) && TestTimerExpired(entry_time, config->timeout);
+
+            if (timeout)
+            {
+                next = config->on_timeout;
+                trace(next, true);
+                enter(next);
+                continue;
+            }
+            if (NULL != config->run)
+            {
+                next = config->run();
+            }
+            if ((next == current) || !setState(next))
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    void enter(STATE next)
+    {
+        current = next;
+        entry_time = GetSystemTime();
+        if (NULL != states[current].entry)
+        {
+            states[current].entry();
+        }
+    }
+
+    void trace(STATE next, bool timeout) const
+    {
+#ifdef FSM_TRACE
+        Serial.print("[FSM ");
+        Serial.print(name);
+        Serial.print("] ");
+        Serial.print((int)current);
+        Serial.print(" -> ");
+        Serial.print((int)next);
+        Serial.print(timeout ? " timeout @" : " @");
+        Serial.println(GetSystemTime());
+#else
+        (void)next;
+        (void)timeout;
+#endif
+    }
+
+    const char *name;
+    const FsmStateConfig<STATE> *states;
+    const FsmTransition<STATE> *transitions;
+    STATE current;
+    uint32_t entry_time;
+};
+
+/**  @}
+ * End of fsm_module group definition
+ */
+
+#endif /* FSM_H_ */
@@ -14,14 +14,32 @@
  */
 
 
+/** Fractional bits of the raw sensor readings */
+#define MCU_RAW_FRAC_BITS 4U
+
+/**
+ * \brief Two point calibration of the internal sensor - stored in EEPROM
+ */
+typedef struct McuTemperatureCalibration
+{
+    uint16_t magic;         //!< Record validity marker
+    uint16_t raw_low;       //!< Reading at the low point, MCU_RAW_FRAC_BITS fractional bits
+    int16_t  centi_low;     //!< Low point temperature, in centi-degrees
+    uint16_t raw_high;      //!< Reading at the high point, MCU_RAW_FRAC_BITS fractional bits
+    int16_t  centi_high;    //!< High point temperature, in centi-degrees
+    uint8_t  checksum;      //!< Inverted byte sum of the fields above
+} MCU_TEMP_CALIBRATION_t;
+
+void MCU_TEMPERATURE_run(TASKS_t running_task);
 int8_t TemperatureAccessSetup(void);
+int8_t McuTemperatureCalibrate(uint16_t raw_low, int16_t centi_low, uint16_t raw_high, int16_t centi_high);
 
 float GetMcuInternalTemperature(void);
 float GetInternalTemperature(void);
+int16_t GetMcuCentiTemperature(void);
+uint16_t GetMcuRawReading(void);
 uint16_t GetEncodedInternalTemperature(void);
 
-//uint32_t TEMPERATURE_run(void);
-
 /**  @}
  * End of temperature_access_module group inclusion
  */
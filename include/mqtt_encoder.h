@@ -0,0 +1,56 @@
+#ifndef MQTT_ENCODER_H_
+#define MQTT_ENCODER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * \file mqtt_encoder.h
+ */
+
+/**
+ *  \addtogroup mqtt_encoder_module
+ *  @{
+ */
+
+/** Longest topic name, in bytes */
+#define MQTT_TOPIC_MAX          47U
+/** Longest Remaining Length field of a packet up to 64KB, in bytes */
+#define MQTT_REMAINING_LEN_MAX   3U
+
+/**
+ * \brief PUBLISH topic header: the topic name, prefixed by its big endian length
+ *
+ * Built at compile time by MQTT_TOPIC(), to be kept in PROGMEM - a topic
+ *   name too long for MQTT_TOPIC_MAX does not compile.
+ */
+typedef struct MqttTopic
+{
+    uint8_t length[2];              //!< Topic name length, big endian
+    char    name[MQTT_TOPIC_MAX + 1U];
+} MQTT_TOPIC_t;
+
+/** MQTT_TOPIC_t initializer for a string literal topic name */
+#define MQTT_TOPIC(topic) \
+    { { (uint8_t)((sizeof(topic) - 1U) >> 8), (uint8_t)((sizeof(topic) - 1U) & 0xFFU) }, topic }
+
+/** PUBLISH quality of service */
+typedef enum MqttQos
+{
+    MQTT_QOS_0 = 0,     //!< At most once
+    MQTT_QOS_1 = 1      //!< At least once - needs a packet identifier
+} MQTT_QOS_t;
+
+uint8_t  MqttEncodeRemainingLength(uint8_t *buffer, uint16_t length);
+uint16_t MqttEncodeConnect(uint8_t *buffer, uint16_t size, const char *client_id, uint16_t keep_alive_s,
+                           bool clean_session);
+uint16_t MqttEncodePublish(uint8_t *buffer, uint16_t size, const MQTT_TOPIC_t *topic, const uint8_t *payload,
+                           uint16_t payload_len, MQTT_QOS_t qos, uint16_t packet_id);
+uint16_t MqttEncodePingreq(uint8_t *buffer, uint16_t size);
+uint16_t MqttEncodeDisconnect(uint8_t *buffer, uint16_t size);
+
+/**  @}
+ * End of mqtt_encoder_module group inclusion
+ */
+
+#endif /* MQTT_ENCODER_H_ */
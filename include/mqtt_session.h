@@ -0,0 +1,70 @@
+#ifndef MQTT_SESSION_H_
+#define MQTT_SESSION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tasks.h"
+#include "mqtt_encoder.h"
+
+/**
+ * \file mqtt_session.h
+ */
+
+/**
+ *  \addtogroup mqtt_session_module
+ *  @{
+ */
+
+/** QoS 1 PUBLISH packets awaiting their PUBACK, at most */
+#define MQTT_INFLIGHT_MAX        4U
+/** Longest application message of a session PUBLISH, in bytes */
+#define MQTT_PAYLOAD_MAX        48U
+
+/**
+ * \brief Session state
+ */
+typedef enum MqttSessionState
+{
+    MQTT_SESSION_DOWN,          //!< No TCP link, or not connected yet
+    MQTT_SESSION_CONNECTING,    //!< CONNECT sent, waiting CONNACK
+    MQTT_SESSION_CONNECTED,     //!< CONNACK accepted
+    MQTT_SESSION_LOST           //!< CONNACK refused, or the broker stopped answering
+} MQTT_SESSION_STATE_t;
+
+/** PUBACK handler - gets the packet identifier of each PUBLISH acknowledged */
+typedef void (*MQTT_PUBACK_HANDLER_t)(uint16_t packet_id);
+
+/**
+ * \brief Session statistics
+ */
+typedef struct MqttSessionStats
+{
+    uint16_t connects;          //!< CONNACKs accepted
+    uint16_t published;         //!< QoS 1 PUBLISH packets queued
+    uint16_t acknowledged;      //!< PUBACKs matching an in-flight packet
+    uint16_t retransmits;       //!< PUBLISH packets sent again, with DUP set
+    uint16_t window_full;       //!< PUBLISH refused, no in-flight slot free
+    uint16_t pings;             //!< PINGREQs sent
+    uint16_t lost;              //!< Sessions lost for lack of an answer
+} MQTT_SESSION_STATS_t;
+
+void MQTT_SESSION_run(TASKS_t running_task);
+uint16_t MqttSessionConnect(uint8_t *buffer, uint16_t size, const char *client_id);
+uint16_t MqttSessionPublish(uint8_t *buffer, uint16_t size, const MQTT_TOPIC_t *topic, const uint8_t *payload,
+                            uint8_t payload_len);
+uint16_t MqttSessionLastPacketId(void);
+void MqttSessionSetPubackHandler(MQTT_PUBACK_HANDLER_t handler);
+uint16_t MqttSessionPoll(uint8_t *buffer, uint16_t size);
+void MqttSessionReceive(const uint8_t *data, uint8_t len);
+void MqttSessionLinkDown(void);
+MQTT_SESSION_STATE_t MqttSessionState(void);
+uint8_t MqttSessionInFlight(void);
+void MqttSessionGetStats(MQTT_SESSION_STATS_t *stats);
+void MqttSessionReportStats(void);
+
+/**  @}
+ * End of mqtt_session_module group inclusion
+ */
+
+#endif /* MQTT_SESSION_H_ */
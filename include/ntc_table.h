@@ -0,0 +1,153 @@
+#ifndef NTC_TABLE_H_
+#define NTC_TABLE_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/**
+ * \file ntc_table.h
+ */
+
+/**
+ * \defgroup ntc_table_module NTC conversion table
+ *
+ * \brief Compile-time ADC code to temperature table, in flash
+ *
+ * The beta equation - T = 1 / (ln(Rt / R0) / B + 1 / T0) - needs soft-float
+ *   divisions and a log() per conversion on the AVR. Here it is evaluated
+ *   by the compiler instead: NtcTable<THERMISTOR> is a PROGMEM table of
+ *   NTC_TABLE_SIZE temperatures, in centi-degrees Celsius, one every
+ *   NTC_TABLE_STEP ADC codes, and NtcCodeToCentiDegrees() interpolates
+ *   between two entries with integer arithmetic only.
+ *
+ * A thermistor is described by a parameter struct - B, R0 at T0, and the
+ *   series resistor of the divider; each one used gets its own table.
+ *   The divider has the thermistor on the supply side, so
+ *   Rt = R_SERIES * (ADC_MAX / code - 1).
+ *
+ * Everything is C++11 constexpr (the AVR core is built as gnu++11), and
+ *   the table is built from an index pack, so no run time code fills it.
+ *
+ * @{
+ */
+
+/** ADC full scale code */
+#define NTC_ADC_MAX      1023U
+/** Table step, as a power of two of ADC codes */
+#define NTC_TABLE_SHIFT  3U
+/** Table step, in ADC codes */
+#define NTC_TABLE_STEP   (1U << NTC_TABLE_SHIFT)
+/** Table entries - codes 0 to 1024, both ends included */
+#define NTC_TABLE_SIZE   ((1024U >> NTC_TABLE_SHIFT) + 1U)
+/** Fractional bits of the interpolation input code */
+#define NTC_CODE_FRAC_BITS 4U
+
+/** Table entries saturate here, in centi-degrees - the divider ends map to ~-80C and +350C */
+#define NTC_CENTI_MIN   (-30000)
+#define NTC_CENTI_MAX     30000
+
+/**
+ * \brief 10k B3950 thermistor over a 10k series resistor
+ */
+struct Ntc10kB3950
+{
+    static constexpr double B = 3950.0;         //!< Beta, in K
+    static constexpr double R0 = 10000.0;       //!< Resistance at T0, in ohms
+    static constexpr double T0 = 25.0;          //!< Reference temperature, in C
+    static constexpr double R_SERIES = 10000.0; //!< Divider series resistor, in ohms
+};
+
+/* constexpr natural logarithm: range reduction to [1, 2), then 2 * atanh((x - 1) / (x + 1)) */
+static constexpr double NTC_LN2 = 0.69314718055994531;
+
+static constexpr double ntcAtanhSeries(double y2, double power, uint8_t k)
+{
+    return (k > 25U) ? 0.0 : (power / k) + ntcAtanhSeries(y2, power * y2, k + 2U);
+}
+
+static constexpr double ntcLnReduced(double x)
+{
+    return 2.0 * ntcAtanhSeries(((x - 1.0) / (x + 1.0)) * ((x - 1.0) / (x + 1.0)), (x - 1.0) / (x + 1.0), 1U);
+}
+
+static constexpr double ntcLn(double x)
+{
+    return (x >= 2.0) ? ntcLn(x / 2.0) + NTC_LN2 :
+           (x < 1.0)  ? ntcLn(x * 2.0) - NTC_LN2 :
+                        ntcLnReduced(x);
+}
+
+/** Codes are kept off the divider ends, where Rt is 0 or infinite */
+static constexpr double ntcClampCode(uint16_t code)
+{
+    return (code < 1U) ? 1.0 : ((code > (NTC_ADC_MAX - 1U)) ? (double)(NTC_ADC_MAX - 1U) : (double)code);
+}
+
+template <class THERMISTOR>
+static constexpr double ntcCelsius(double code)
+{
+    return 1.0 / (ntcLn(THERMISTOR::R_SERIES * (NTC_ADC_MAX / code - 1.0) / THERMISTOR::R0) / THERMISTOR::B +
+                  1.0 / (THERMISTOR::T0 + 273.15)) - 273.15;
+}
+
+static constexpr int16_t ntcSaturate(double centi)
+{
+    return (centi < NTC_CENTI_MIN) ? (int16_t)NTC_CENTI_MIN :
+           (centi > NTC_CENTI_MAX) ? (int16_t)NTC_CENTI_MAX :
+           (int16_t)((centi < 0.0) ? (centi - 0.5) : (centi + 0.5));
+}
+
+template <class THERMISTOR>
+static constexpr int16_t ntcTableEntry(uint16_t index)
+{
+    return ntcSaturate(100.0 * ntcCelsius<THERMISTOR>(ntcClampCode(index * NTC_TABLE_STEP)));
+}
+
+/* Index pack 0 .. N-1 (no std::index_sequence on the AVR toolchain) */
+template <uint16_t... I> struct NtcIndexList {};
+template <uint16_t N, uint16_t... I> struct NtcMakeIndexList : NtcMakeIndexList<N - 1U, N - 1U, I...> {};
+template <uint16_t... I> struct NtcMakeIndexList<0U, I...> { typedef NtcIndexList<I...> type; };
+
+template <class THERMISTOR, class INDEXES> struct NtcTableData;
+
+template <class THERMISTOR, uint16_t... I>
+struct NtcTableData<THERMISTOR, NtcIndexList<I...> >
+{
+    static const int16_t values[sizeof...(I)];
+};
+
+template <class THERMISTOR, uint16_t... I>
+const int16_t NtcTableData<THERMISTOR, NtcIndexList<I...> >::values[sizeof...(I)] PROGMEM =
+{
+    ntcTableEntry<THERMISTOR>(I)...
+};
+
+/**
+ * \brief Temperature table of a thermistor, in centi-degrees, one entry every NTC_TABLE_STEP codes
+ */
+template <class THERMISTOR>
+struct NtcTable : NtcTableData<THERMISTOR, typename NtcMakeIndexList<NTC_TABLE_SIZE>::type>
+{
+};
+
+/**
+ * \brief Converts an ADC code to temperature
+ *
+ * @param [in] code - ADC code with NTC_CODE_FRAC_BITS fractional bits (0 to 1023 << NTC_CODE_FRAC_BITS)
+ * @return temperature, in centi-degrees Celsius
+ */
+template <class THERMISTOR>
+static inline int16_t NtcCodeToCentiDegrees(uint16_t code)
+{
+    uint8_t index = (uint8_t)(code >> (NTC_TABLE_SHIFT + NTC_CODE_FRAC_BITS));
+    uint8_t fraction = (uint8_t)(code & ((1U << (NTC_TABLE_SHIFT + NTC_CODE_FRAC_BITS)) - 1U));
+    int16_t t0 = (int16_t)pgm_read_word(&NtcTable<THERMISTOR>::values[index]);
+    int16_t t1 = (int16_t)pgm_read_word(&NtcTable<THERMISTOR>::values[index + 1U]);
+    return (int16_t)(t0 + (((int32_t)(t1 - t0) * fraction) >> (NTC_TABLE_SHIFT + NTC_CODE_FRAC_BITS)));
+}
+
+/**  @}
+ * End of ntc_table_module group definition
+ */
+
+#endif /* NTC_TABLE_H_ */
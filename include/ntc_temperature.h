@@ -4,27 +4,18 @@
 /* Cell temperature state enum type */
 typedef enum CellTempState
 {
-    CELLTEMP_IDLE,
-    CELLTEMP_SETUP,
-    CELLTEMP_READ_SETUP,
-    CELLTEMP_CHEK_SETUP,
-    CELLTEMP_START_MEASUREMENT,
-    CELLTEMP_MEASUREMENT,
-    CELLTEMP_END
+    CELLTEMP_IDLE,          //!< Waiting for the next measurement
+    CELLTEMP_MEASUREMENT,   //!< Collecting the samples of one filter output
+    CELLTEMP_FAULT,         //!< The samples did not come in time - reported, back to idle
+    CELLTEMP_STATE_COUNT    //!< Number of states, not a state
 }  CELLTEMP_STATE_t;
 
-typedef struct CellTempStatus
-{
-    uint64_t          transition_time;
-    CELLTEMP_STATE_t  state;
-    uint8_t           setup_count;
-} CELLTEMP_STATUS_t;
-
 void CliTempTest(void);
 
 float GetTemperature(void);
 // To send via radio
 uint16_t GetEncodedTemperature(void);
+int16_t GetCentiTemperature(void);
 
 float MeasureExtTmp(void);
 
@@ -33,4 +24,8 @@ void SetupCellTemperature(void);
 
 void NTC_TEMPERATURE_run(TASKS_t running_task);
 
+#ifdef BENCHMARK
+void NtcBenchmark(void);
+#endif
+
 #endif /* BAT_TEMPERATURE_H_ */
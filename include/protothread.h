@@ -0,0 +1,114 @@
+#ifndef PROTOTHREAD_H_
+#define PROTOTHREAD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "timer.h"
+
+/**
+ * \file protothread.h
+ */
+
+/**
+ * \defgroup protothread_module Protothread
+ *
+ * \brief Stackless coroutines for long running driver sequences
+ *
+ * A protothread is a function that can return in the middle of its body
+ *   and, when called again, resume right after the point it returned from.
+ *   Long sequences - a sensor handshake, a list of AT commands - are written
+ *   as straight line code, and each step that must wait yields back to the
+ *   scheduler instead of blocking the whole firmware. The owning module
+ *   resumes its protothreads from its periodic task runner.
+ *
+ * The implementation is the classic switch based one (local continuations
+ *   are source line numbers), so:
+ *   * local variables are *not* preserved across a wait - use static or
+ *     module variables;
+ *   * a protothread body must not contain a switch statement around a wait;
+ *   * only one wait macro per source line.
+ *
+ * \code
+ * static PT_THREAD(blink(PT_t *pt))
+ * {
+ *     PT_BEGIN(pt);
+ *     for (;;)
+ *     {
+ *         digitalWrite(13, HIGH);
+ *         PT_WAIT_MS(pt, 100);
+ *         digitalWrite(13, LOW);
+ *         PT_YIELD_UNTIL(pt, button_pressed);
+ *     }
+ *     PT_END(pt);
+ * }
+ * \endcode
+ *
+ * @{
+ */
+
+/** Protothread state: local continuation and wait reference time */
+typedef struct Protothread
+{
+    uint16_t lc;    //!< Resume point (source line), 0 at start
+    uint32_t t0;    //!< Reference time for PT_WAIT_MS()
+} PT_t;
+
+/** Protothread return codes */
+#define PT_WAITING 0    //!< Blocked on a condition
+#define PT_YIELDED 1    //!< Yielded, will go on at the next call
+#define PT_EXITED  2    //!< Ran PT_EXIT()
+#define PT_ENDED   3    //!< Reached PT_END()
+
+/** Declares a protothread function */
+#define PT_THREAD(name_args) char name_args
+
+/** Initializes (or resets) a protothread */
+#define PT_INIT(pt) ((pt)->lc = 0U)
+
+/** Starts a protothread body */
+#define PT_BEGIN(pt) { char pt_yield_flag = 1; (void)pt_yield_flag; switch ((pt)->lc) { case 0:
+
+/** Ends a protothread body - the protothread restarts on the next call */
+#define PT_END(pt) } pt_yield_flag = 0; PT_INIT(pt); return PT_ENDED; }
+
+/** Sets the resume point - falling into its case label is intended */
+#define PT_SET_LC(pt) (pt)->lc = __LINE__; __attribute__((fallthrough)); case __LINE__:
+
+/** Waits, returning to the caller, until 'cond' is true - no wait if it already is */
+#define PT_WAIT_UNTIL(pt, cond) \
+    do { PT_SET_LC(pt) if (!(cond)) { return PT_WAITING; } } while (0)
+
+/** Waits while 'cond' is true */
+#define PT_WAIT_WHILE(pt, cond) PT_WAIT_UNTIL(pt, !(cond))
+
+/** Returns to the caller once, going on at the next call */
+#define PT_YIELD(pt) \
+    do { pt_yield_flag = 0; PT_SET_LC(pt) if (0 == pt_yield_flag) { return PT_YIELDED; } } while (0)
+
+/** Returns to the caller at least once, and then until 'cond' is true */
+#define PT_YIELD_UNTIL(pt, cond) \
+    do { pt_yield_flag = 0; PT_SET_LC(pt) if ((0 == pt_yield_flag) || !(cond)) { return PT_YIELDED; } } while (0)
+
+/** Waits 'ms' milliseconds, on the system timer */
+#define PT_WAIT_MS(pt, ms) \
+    do { (pt)->t0 = GetSystemTime(); PT_WAIT_UNTIL(pt, TestTimerExpired((pt)->t0, (ms))); } while (0)
+
+/** Waits until a child protothread exits or ends */
+#define PT_WAIT_THREAD(pt, thread) PT_WAIT_WHILE(pt, (thread) < PT_EXITED)
+
+/** Starts a child protothread and waits until it exits or ends */
+#define PT_SPAWN(pt, child, thread) \
+    do { PT_INIT(child); PT_WAIT_THREAD(pt, thread); } while (0)
+
+/** Leaves the protothread - it restarts on the next call */
+#define PT_EXIT(pt) do { PT_INIT(pt); return PT_EXITED; } while (0)
+
+/** Restarts the protothread from its beginning, on the next call */
+#define PT_RESTART(pt) do { PT_INIT(pt); return PT_WAITING; } while (0)
+
+/**  @}
+ * End of protothread_module group definition
+ */
+
+#endif /* PROTOTHREAD_H_ */
@@ -0,0 +1,59 @@
+#ifndef SAMPLE_STORE_H_
+#define SAMPLE_STORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tasks.h"
+
+/**
+ * \file sample_store.h
+ */
+
+/**
+ *  \addtogroup sample_store_module
+ *  @{
+ */
+
+/** Readings queued for writing, at most - one uplink cycle */
+#define SAMPLE_STORE_PENDING_MAX 4U
+/** Metric identifiers up to this value - the caller's own numbering */
+#define SAMPLE_STORE_METRIC_MAX  0x7FU
+
+/**
+ * \brief Stored reading
+ */
+typedef struct StoredSample
+{
+    uint8_t  slot;      //!< Ring slot - confirms the delivery, SampleStoreAcknowledge()
+    uint8_t  metric;    //!< Metric identifier
+    uint16_t value;     //!< Encoded value, as SensorEncode()
+    bool     aged;      //!< Taken since power on - 'age' is known
+    uint32_t age;       //!< Time since the reading, in s - up to the ~49.7 days of the ms clock
+} STORED_SAMPLE_t;
+
+/**
+ * \brief Store statistics
+ */
+typedef struct SampleStoreStats
+{
+    uint16_t stored;        //!< Readings written
+    uint16_t forwarded;     //!< Readings delivered
+    uint16_t overwritten;   //!< Oldest readings lost to a full ring
+    uint16_t dropped;       //!< Readings refused, the write queue was full
+} SAMPLE_STORE_STATS_t;
+
+void SAMPLE_STORE_run(TASKS_t running_task);
+bool SampleStoreAppend(uint8_t metric, uint16_t value);
+bool SampleStoreNext(STORED_SAMPLE_t *sample);
+void SampleStoreAcknowledge(uint8_t slot);
+void SampleStoreRewind(void);
+uint8_t SampleStoreCount(void);
+void SampleStoreGetStats(SAMPLE_STORE_STATS_t *stats);
+void SampleStoreReportStats(void);
+
+/**  @}
+ * End of sample_store_module group inclusion
+ */
+
+#endif /* SAMPLE_STORE_H_ */
@@ -1,6 +1,10 @@
 #ifndef SCHEDULER_H_
 #define SCHEDULER_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tasks.h"
 
 /**
  * \file scheduler.h
@@ -12,10 +16,33 @@
  */
 
 
+/** Number of run time histogram buckets - bucket k holds runs shorter than 16us * 4^k */
+#define SCHED_HIST_BUCKETS 8
+
+/**
+ * \brief Run time statistics of a periodic task
+ */
+typedef struct SchedTaskStats
+{
+    uint32_t     runs;                          //!< Number of runs measured
+    uint32_t     min_us;                        //!< Shortest run, in microseconds
+    uint32_t     max_us;                        //!< Longest run, in microseconds
+    uint32_t     mean_us;                       //!< Mean run time, in microseconds
+    unsigned int missed;                        //!< Missed activations
+    uint16_t     histogram[SCHED_HIST_BUCKETS]; //!< Log4 run time histogram
+} SCHED_TASK_STATS_t;
+
+
 void SetTasksFlags(void);
 void RunMainLoop(void);
 void EnableSystemTasks(void);
 void TriggerPowerOnTask(void);
+bool SchedulerPostEvent(EVENTS_t event, uint8_t data);
+
+uint8_t SchedulerGetTaskCount(void);
+bool    SchedulerGetTaskStats(uint8_t index, SCHED_TASK_STATS_t *stats);
+void    SchedulerReportStats(void);
+uint8_t SchedulerGetCpuLoad(void);
 
 
 /**  @}
@@ -0,0 +1,71 @@
+#ifndef SENSOR_CACHE_H_
+#define SENSOR_CACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * \file sensor_cache.h
+ */
+
+/**
+ *  \addtogroup sensor_cache_module
+ *  @{
+ */
+
+/**
+ * \brief Cached sensor values
+ */
+typedef enum SensorId
+{
+    SENSOR_DHT_TEMPERATURE, //!< DHT air temperature, in C
+    SENSOR_DHT_HUMIDITY,    //!< DHT relative humidity, in %
+    SENSOR_NTC_TEMPERATURE, //!< NTC thermistor temperature, in C
+    SENSOR_MCU_TEMPERATURE, //!< MCU internal temperature, in C
+    SENSOR_COUNT            //!< Number of sensor slots, not a sensor
+} SENSOR_ID_t;
+
+/**
+ * \brief Result of the last read attempt of a sensor
+ */
+typedef enum SensorError
+{
+    SENSOR_OK,              //!< Good reading
+    SENSOR_ERR_NO_DATA,     //!< Never read
+    SENSOR_ERR_TIMEOUT,     //!< Sensor did not answer
+    SENSOR_ERR_FRAME,       //!< Malformed answer (lost or spurious edges, ...)
+    SENSOR_ERR_CHECKSUM,    //!< Answer failed its checksum
+    SENSOR_ERR_RANGE        //!< Reading out of the sensor's range
+} SENSOR_ERROR_t;
+
+/** Quality flags */
+#define SENSOR_FLAG_VALID       0x01U   //!< value holds a good reading
+#define SENSOR_FLAG_LAST_FAILED 0x02U   //!< The last read attempt failed - value is from an older one
+
+/** 16 bit encoding of a value: centi-units + SENSOR_ENCODING_OFFSET, -200.00 to 455.35 */
+#define SENSOR_ENCODING_OFFSET  20000
+
+/**
+ * \brief Sensor slot snapshot
+ */
+typedef struct SensorReading
+{
+    float    value;     //!< Last good value
+    uint32_t timestamp; //!< System time of the last good value, in ms
+    uint8_t  flags;     //!< SENSOR_FLAG_*
+    uint8_t  error;     //!< SENSOR_ERROR_t of the last read attempt
+} SENSOR_READING_t;
+
+
+void SensorCacheUpdate(SENSOR_ID_t sensor, float value);
+void SensorCacheReportError(SENSOR_ID_t sensor, SENSOR_ERROR_t error);
+bool SensorCacheGet(SENSOR_ID_t sensor, SENSOR_READING_t *reading);
+bool SensorCacheGetFresh(SENSOR_ID_t sensor, uint32_t max_age, float *value);
+uint16_t SensorEncode(float value);
+
+
+/**  @}
+ * End of sensor_cache_module group inclusion
+ */
+
+#endif /* SENSOR_CACHE_H_ */
@@ -24,6 +24,15 @@ typedef enum Tasks
     POWEROFF_TASK       //!< POWEROFF_TASK
 } TASKS_t;
 
+/**
+ * \brief System events - posted by interrupt handlers, each one runs its event task
+ */
+typedef enum Events
+{
+    SOUND_DETECTED_EVENT,   //!< Sound detector output rising edge
+    EVENT_COUNT             //!< Number of events, not an event
+} EVENTS_t;
+
 
 void RunFastTimeTask(void);
 void RunMediumTimeTask(void);
@@ -31,6 +40,7 @@ void RunSlowTimeTask(void);
 void RunVerySlowTimeTask(void);
 void RunPowerOnTask(void);
 void RunPowerOffTask(void);
+void RunSoundEventTask(uint8_t data);
 
 bool IsSoundAlarm(void);
 
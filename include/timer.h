@@ -12,19 +12,53 @@
  * \addtogroup timer_module
  */
 
+/** Software timer expiry callback - runs in scheduler (main loop) context */
+typedef void (*SOFT_TIMER_CALLBACK_t)(void *context);
 
-uint64_t GetSystemTime(void);
+/**
+ * \brief One-shot software timer
+ *
+ * Storage is owned by the caller (usually a static variable of the
+ *   module using it); the timer service only links it into its list.
+ */
+typedef struct SoftTimer
+{
+    struct SoftTimer      *next;     //!< Next timer in the expiry ordered list
+    uint32_t               expiry;   //!< Expiry time, in system ms
+    SOFT_TIMER_CALLBACK_t  callback; //!< Expiry callback
+    void                  *context;  //!< Callback argument
+    bool                   armed;    //!< Timer is in the list
+} SOFT_TIMER_t;
+
+
+uint32_t GetSystemTime(void);
 
-uint64_t GetElapsedTime(uint64_t ref_time);
-bool   TestTimerExpired(uint64_t ref_time, uint64_t timeout);
+uint32_t GetElapsedTime(uint32_t ref_time);
+bool     TestTimerExpired(uint32_t ref_time, uint32_t timeout);
 
-uint64_t GetHiResSystemTime(void);
-uint64_t GetHiResElapsedTime(uint64_t reference_time);
+uint32_t GetHiResSystemTime(void);
+uint32_t GetHiResElapsedTime(uint32_t reference_time);
 
 
 void     SetupSystemTimer(void);
 void     SystickRunner(void);
 
+void     SoftTimerArm(SOFT_TIMER_t *timer, uint32_t delay_ms, SOFT_TIMER_CALLBACK_t callback, void *context);
+void     SoftTimerCancel(SOFT_TIMER_t *timer);
+bool     SoftTimerIsArmed(const SOFT_TIMER_t *timer);
+bool     SoftTimerDue(void);
+void     SoftTimerRun(void);
+
+#ifdef NATIVE_BUILD
+void     SetSystemTime(uint32_t now);
+#endif
+
+#ifdef BENCHMARK
+void     SetupCycleCounter(void);
+uint16_t GetCycleCount(void);
+void     TimerBenchmark(void);
+#endif
+
 
 /**  @}
  * End of timer_module group inclusion
@@ -0,0 +1,19 @@
+#ifndef UPLINK_H_
+#define UPLINK_H_
+
+/**
+ * \file uplink.h
+ */
+
+/**
+ *  \addtogroup uplink_module
+ *  @{
+ */
+
+void UPLINK_run(TASKS_t running_task);
+
+/**  @}
+ * End of uplink_module group inclusion
+ */
+
+#endif /* UPLINK_H_ */
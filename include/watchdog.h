@@ -0,0 +1,45 @@
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * \file watchdog.h
+ */
+
+/**
+ *  \addtogroup watchdog_module
+ *  @{
+ */
+
+/** No task - e.g. the watchdog fired outside any task */
+#define WATCHDOG_NO_TASK 0xFFU
+
+/**
+ * \brief Overrun and hang record - survives a watchdog reset
+ */
+typedef struct WatchdogRecord
+{
+    uint16_t magic;             //!< Record validity marker
+    uint16_t overrun_count;     //!< Task budget overruns since power on
+    uint8_t  overrun_task;      //!< Task of the last overrun
+    uint32_t overrun_time;      //!< Run time of the last overrun, in microseconds
+    uint8_t  running_task;      //!< Task running now (WATCHDOG_NO_TASK between tasks)
+    uint8_t  hung_task;         //!< Task running when the watchdog fired
+    bool     wdt_fired;         //!< The watchdog interrupt ran - a reset follows, unless the task recovers
+    uint8_t  wdt_reset_count;   //!< Watchdog resets since power on
+} WATCHDOG_RECORD_t;
+
+void WATCHDOG_run(TASKS_t running_task);
+
+void WatchdogTaskStart(TASKS_t task);
+void WatchdogTaskDone(TASKS_t task, uint32_t run_time);
+const WATCHDOG_RECORD_t *WatchdogGetRecord(void);
+bool WatchdogResetOccurred(void);
+
+/**  @}
+ * End of watchdog_module group inclusion
+ */
+
+#endif /* WATCHDOG_H_ */
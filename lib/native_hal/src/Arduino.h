@@ -0,0 +1,198 @@
+#ifndef NATIVE_ARDUINO_H_
+#define NATIVE_ARDUINO_H_
+
+/**
+ * \file Arduino.h
+ *
+ * \brief Native (Linux) stand-in for the subset of the Arduino core used by the firmware
+ *
+ * Every primitive is charged against the HAL virtual clock (see native_hal.h),
+ *   so busy-wait loops written against millis()/digitalRead() terminate and
+ *   the measured timings resemble the ones seen on the Uno.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+
+#include "native_hal.h"
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH   0x1
+#define LOW    0x0
+
+#define INPUT         0x0
+#define OUTPUT        0x1
+#define INPUT_PULLUP  0x2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define NOT_AN_INTERRUPT -1
+/** Uno external interrupts: INT0 on pin 2, INT1 on pin 3 */
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+
+#ifndef _BV
+#define _BV(bit) (1U << (bit))
+#endif
+
+/* ADMUX bits */
+#define MUX0   0
+#define MUX1   1
+#define MUX2   2
+#define MUX3   3
+#define ADLAR  5
+#define REFS0  6
+#define REFS1  7
+/* ADCSRA bits */
+#define ADPS0  0
+#define ADPS1  1
+#define ADPS2  2
+#define ADIE   3
+#define ADIF   4
+#define ADATE  5
+#define ADSC   6
+#define ADEN   7
+
+/**
+ * \brief ADCSRA stand-in: setting ADSC runs one conversion of the channel selected in ADMUX
+ *
+ * With ADIE clear the conversion completes within the write, as a polled
+ *   one would; with ADIE set it completes 104us of virtual time later and
+ *   calls the installed ADC callback (see HalInstallAdcCallback()).
+ */
+class HalAdcsraRegister
+{
+public:
+    operator uint8_t() const { return value; }
+    HalAdcsraRegister& operator=(uint8_t v)  { write(v); return *this; }
+    HalAdcsraRegister& operator|=(uint8_t v) { write(value | v); return *this; }
+    HalAdcsraRegister& operator&=(uint8_t v) { write(value & v); return *this; }
+    void completeConversion(void);
+private:
+    void write(uint8_t v);
+    uint8_t value;
+};
+
+#define INTF0  0
+#define INTF1  1
+
+/**
+ * \brief EIFR stand-in: external interrupt flags - writing a one clears the flag
+ */
+class HalEifrRegister
+{
+public:
+    operator uint8_t() const;
+    HalEifrRegister& operator=(uint8_t v);
+};
+
+extern volatile uint8_t  ADMUX;
+extern HalAdcsraRegister ADCSRA;
+extern HalEifrRegister   EIFR;
+extern volatile uint16_t ADCW;
+
+void     pinMode(uint8_t pin, uint8_t mode);
+void     digitalWrite(uint8_t pin, uint8_t level);
+int      digitalRead(uint8_t pin);
+int      analogRead(uint8_t pin);
+unsigned long millis(void);
+unsigned long micros(void);
+void     delay(unsigned long ms);
+void     delayMicroseconds(unsigned int us);
+void     attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode);
+void     detachInterrupt(uint8_t interrupt);
+
+#define noInterrupts() HalDisableInterrupts()
+#define interrupts()   HalEnableInterrupts()
+#define cli()          HalDisableInterrupts()
+#define sei()          HalEnableInterrupts()
+
+char *dtostrf(double val, signed char width, unsigned char prec, char *sout);
+
+/**
+ * \brief Minimal Arduino String, backed by std::string
+ */
+class String
+{
+public:
+    String(const char *s = "") : str(s ? s : "") {}
+    String(const std::string &s) : str(s) {}
+    String(char c) : str(1, c) {}
+    String(int v);
+    String(unsigned int v);
+    String(long v);
+    String(unsigned long v);
+    String(float v, unsigned char decimals = 2);
+    String(double v, unsigned char decimals = 2);
+
+    unsigned int length(void) const { return (unsigned int)str.length(); }
+    const char  *c_str(void) const { return str.c_str(); }
+    int indexOf(const char *s) const;
+    int indexOf(const String &s) const { return indexOf(s.c_str()); }
+
+    String &operator+=(const String &rhs) { str += rhs.str; return *this; }
+    friend String operator+(const String &lhs, const String &rhs) { return String(lhs.str + rhs.str); }
+    friend String operator+(const char *lhs, const String &rhs)   { return String(std::string(lhs) + rhs.str); }
+    bool operator==(const char *rhs) const { return str == rhs; }
+
+private:
+    std::string str;
+};
+
+/**
+ * \brief Arduino Print/Stream subset shared by Serial and SoftwareSerial
+ */
+class Stream
+{
+public:
+    virtual ~Stream() {}
+    virtual size_t write(uint8_t data) = 0;
+    virtual int available(void) { return 0; }
+    virtual int read(void) { return -1; }
+
+    size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+
+    size_t print(const char *s)    { return write(s); }
+    size_t print(const String &s)  { return write(s.c_str()); }
+    size_t print(char c)           { return write((uint8_t)c); }
+    size_t print(int v)            { return print(String(v)); }
+    size_t print(unsigned int v)   { return print(String(v)); }
+    size_t print(long v)           { return print(String(v)); }
+    size_t print(unsigned long v)  { return print(String(v)); }
+    size_t print(double v, int decimals = 2) { return print(String(v, (unsigned char)decimals)); }
+
+    size_t println(void)           { return write("\r\n"); }
+    template <typename T>
+    size_t println(T v)            { size_t n = print(v); return n + println(); }
+
+    String readString(void);
+};
+
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t write(uint8_t data);
+    using Stream::write;
+};
+
+extern HardwareSerial Serial;
+
+/* Firmware entry points, provided by src/main.cpp */
+void setup(void);
+void loop(void);
+
+#endif /* NATIVE_ARDUINO_H_ */
@@ -0,0 +1,23 @@
+#ifndef NATIVE_SOFTWARE_SERIAL_H_
+#define NATIVE_SOFTWARE_SERIAL_H_
+
+/**
+ * \file SoftwareSerial.h
+ *
+ * \brief Native stand-in for SoftwareSerial, connected to the simulated ESP-01
+ */
+
+#include "Arduino.h"
+
+class SoftwareSerial : public Stream
+{
+public:
+    SoftwareSerial(uint8_t rx_pin, uint8_t tx_pin) { (void)rx_pin; (void)tx_pin; }
+    void begin(long baud) { (void)baud; }
+    size_t write(uint8_t data);
+    int available(void);
+    int read(void);
+    using Stream::write;
+};
+
+#endif /* NATIVE_SOFTWARE_SERIAL_H_ */
@@ -0,0 +1,57 @@
+#ifndef NATIVE_AVR_EEPROM_H_
+#define NATIVE_AVR_EEPROM_H_
+
+/**
+ * \file eeprom.h
+ *
+ * \brief Native stand-in for avr-libc <avr/eeprom.h>: 1KB of RAM, erased (0xFF) at start
+ *
+ * The contents do not survive the program - every run starts from a blank EEPROM.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/** Last EEPROM address (ATmega328P: 1KB) */
+#define E2END 0x3FF
+
+/** EEPROM contents - a single instance across translation units */
+inline uint8_t *HalEepromData(void)
+{
+    static uint8_t data[E2END + 1];
+    static bool erased = (memset(data, 0xFF, sizeof(data)), true);
+    (void)erased;
+    return data;
+}
+
+/** Writes complete at once - never busy */
+#define eeprom_is_ready() 1
+
+inline uint8_t eeprom_read_byte(const uint8_t *addr)
+{
+    return HalEepromData()[(uintptr_t)addr & E2END];
+}
+
+inline void eeprom_update_byte(uint8_t *addr, uint8_t value)
+{
+    HalEepromData()[(uintptr_t)addr & E2END] = value;
+}
+
+inline void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        ((uint8_t *)dst)[i] = eeprom_read_byte((const uint8_t *)src + i);
+    }
+}
+
+inline void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        eeprom_update_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+    }
+}
+
+#endif /* NATIVE_AVR_EEPROM_H_ */
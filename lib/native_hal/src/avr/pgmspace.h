@@ -0,0 +1,20 @@
+#ifndef NATIVE_AVR_PGMSPACE_H_
+#define NATIVE_AVR_PGMSPACE_H_
+
+/**
+ * \file pgmspace.h
+ *
+ * \brief Native stand-in for avr-libc <avr/pgmspace.h>: flash data is plain memory on the host
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+
+#endif /* NATIVE_AVR_PGMSPACE_H_ */
@@ -0,0 +1,20 @@
+#ifndef NATIVE_AVR_SLEEP_H_
+#define NATIVE_AVR_SLEEP_H_
+
+/**
+ * \file sleep.h
+ *
+ * \brief Native stand-in for avr-libc <avr/sleep.h>: sleeping jumps the virtual clock to the next tick
+ */
+
+#include "native_hal.h"
+
+#define SLEEP_MODE_IDLE        0
+#define SLEEP_MODE_PWR_DOWN    2
+
+#define set_sleep_mode(mode)   ((void)(mode))
+#define sleep_enable()         ((void)0)
+#define sleep_disable()        ((void)0)
+#define sleep_cpu()            HalSleepUntilNextTick()
+
+#endif /* NATIVE_AVR_SLEEP_H_ */
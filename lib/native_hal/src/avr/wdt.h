@@ -0,0 +1,29 @@
+#ifndef NATIVE_AVR_WDT_H_
+#define NATIVE_AVR_WDT_H_
+
+/**
+ * \file wdt.h
+ *
+ * \brief Native stand-in for avr-libc <avr/wdt.h> - the watchdog never fires on the host
+ */
+
+#include <stdint.h>
+
+#define WDTO_15MS   0
+#define WDTO_250MS  4
+#define WDTO_500MS  5
+#define WDTO_1S     6
+#define WDTO_2S     7
+#define WDTO_4S     8
+#define WDTO_8S     9
+
+#define WDIE        6
+#define WDRF        3
+
+extern volatile uint8_t WDTCSR;
+
+#define wdt_enable(timeout) ((void)(timeout))
+#define wdt_disable()       ((void)0)
+#define wdt_reset()         ((void)0)
+
+#endif /* NATIVE_AVR_WDT_H_ */
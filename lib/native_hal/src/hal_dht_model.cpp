@@ -0,0 +1,148 @@
+/**
+ * \file hal_dht_model.cpp
+ *
+ * \brief Behavioural DHT11/DHT22 model on the simulated pin 2
+ *
+ * The model follows the sensor policy the firmware is built for (see
+ *   dht_sensor.h) - DHT11 or DHT22/AM2302 data encoding and start signal.
+ *
+ * A host start pulse (line driven low for at least 18 ms - DHT11 - or
+ *   1 ms - DHT22 - then released)
+ *   triggers one frame: ~30 us pull-up, 80 us low response, 80 us high,
+ *   then 40 bits of 50 us low followed by 26 us ("0") or 70 us ("1") high,
+ *   and a final 50 us low. The line idles high otherwise.
+ *
+ *  \addtogroup native_hal_module
+ *  @{
+ */
+
+#include <type_traits>
+
+#include "Arduino.h"
+#include "native_hal.h"
+#include "dht_sensor.h"
+
+#define HAL_DHT_PIN            2U
+/** DHT22 family framing: 16 bit values in tenths, sign and magnitude temperature */
+#define HAL_DHT22_FRAMING (std::is_base_of<Dht22Policy, DhtSensor>::value)
+#define DHT_START_MIN_US   (HAL_DHT22_FRAMING ? 1000U : 18000U)
+#define DHT_RELEASE_US        30U
+#define DHT_RESPONSE_US       80U
+#define DHT_READY_US          80U
+#define DHT_BIT_LOW_US        50U
+#define DHT_BIT_ZERO_US       26U
+#define DHT_BIT_ONE_US        70U
+
+static uint8_t  frame[5];
+static bool     reading_set;
+static bool     frame_active;
+static uint64_t frame_start_us;
+static uint64_t host_low_since_us;
+static bool     host_driving_low;
+
+static uint8_t dhtPinModel(uint64_t now_us)
+{
+    if (!frame_active)
+    {
+        return HIGH;
+    }
+
+    uint64_t t = now_us - frame_start_us;
+    if (t < DHT_RELEASE_US)
+    {
+        return HIGH;
+    }
+    t -= DHT_RELEASE_US;
+    if (t < DHT_RESPONSE_US)
+    {
+        return LOW;
+    }
+    t -= DHT_RESPONSE_US;
+    if (t < DHT_READY_US)
+    {
+        return HIGH;
+    }
+    t -= DHT_READY_US;
+
+    for (uint8_t bit = 0; bit < 40U; bit++)
+    {
+        uint32_t high = (frame[bit / 8U] & (0x80U >> (bit % 8U))) ? DHT_BIT_ONE_US : DHT_BIT_ZERO_US;
+        if (t < DHT_BIT_LOW_US)
+        {
+            return LOW;
+        }
+        t -= DHT_BIT_LOW_US;
+        if (t < high)
+        {
+            return HIGH;
+        }
+        t -= high;
+    }
+    if (t < DHT_BIT_LOW_US)
+    {
+        return LOW;
+    }
+
+    frame_active = false;
+    return HIGH;
+}
+
+void HalDhtSetReading(float humidity, float temperature)
+{
+    if (HAL_DHT22_FRAMING)
+    {
+        uint16_t rh = (uint16_t)lroundf(humidity * 10.0f);
+        uint16_t t = (uint16_t)lroundf(fabsf(temperature) * 10.0f) & 0x7FFFU;
+        if (temperature < 0.0f)
+        {
+            t |= 0x8000U;
+        }
+        frame[0] = (uint8_t)(rh >> 8);
+        frame[1] = (uint8_t)rh;
+        frame[2] = (uint8_t)(t >> 8);
+        frame[3] = (uint8_t)t;
+    }
+    else
+    {
+        frame[0] = (uint8_t)humidity;
+        frame[1] = (uint8_t)lroundf((humidity - frame[0]) * 10.0f);
+        frame[2] = (uint8_t)temperature;
+        frame[3] = (uint8_t)lroundf((temperature - frame[2]) * 10.0f);
+    }
+    frame[4] = (uint8_t)(frame[0] + frame[1] + frame[2] + frame[3]);
+    reading_set = true;
+}
+
+void HalDhtNotifyPinWrite(uint8_t pin, uint8_t mode, uint8_t level)
+{
+    if (HAL_DHT_PIN != pin)
+    {
+        return;
+    }
+    HalInstallPinModel(HAL_DHT_PIN, &dhtPinModel);
+    if (!reading_set)
+    {
+        HalDhtSetReading(55.0f, 24.5f);
+    }
+
+    bool low = (OUTPUT == mode) && (LOW == level);
+    uint64_t now = HalGetVirtualMicros();
+    if (low && !host_driving_low)
+    {
+        host_low_since_us = now;
+        frame_active = false;
+    }
+    else if (!low && host_driving_low)
+    {
+        if ((now - host_low_since_us) >= DHT_START_MIN_US)
+        {
+            frame_active = true;
+            frame_start_us = now;
+        }
+    }
+    host_driving_low = low;
+}
+
+/**  @}
+ * End of native_hal_module group
+ */
@@ -0,0 +1,287 @@
+/**
+ * \file hal_serial.cpp
+ *
+ * \brief Native String/Serial/SoftwareSerial and a behavioural ESP-01 model
+ *
+ * The ESP-01 model answers AT commands with "OK", opens the CIPSEND prompt,
+ *   acknowledges transmitted payloads with "SEND OK" and replies, through
+ *   "+IPD" frames, to the MQTT packets found in them (CONNACK, PUBACK,
+ *   PINGRESP). Replies are paced at 9600 bps on the virtual clock.
+ *
+ *  \addtogroup native_hal_module
+ *  @{
+ */
+
+#include <stdio.h>
+#include <deque>
+
+#include "Arduino.h"
+#include "SoftwareSerial.h"
+#include "native_hal.h"
+
+/** ESP reply latency, in microseconds */
+#define ESP_REPLY_LATENCY_US 2000U
+/** One byte at 9600 bps, in microseconds */
+#define ESP_BYTE_TIME_US     1042U
+/** Arduino Stream default timeout, in milliseconds */
+#define STREAM_TIMEOUT_MS    1000U
+
+HardwareSerial Serial;
+
+typedef struct EspRxByte
+{
+    uint64_t ready_us;
+    uint8_t  data;
+} ESP_RX_BYTE_t;
+
+static std::deque<ESP_RX_BYTE_t> esp_rx;
+static uint64_t    esp_rx_last_us;
+static std::string esp_line;
+static std::string esp_payload;
+static unsigned    esp_payload_remaining;
+
+/**********/
+/* String */
+/**********/
+
+String::String(int v)           { char b[16]; sprintf(b, "%d", v);  str = b; }
+String::String(unsigned int v)  { char b[16]; sprintf(b, "%u", v);  str = b; }
+String::String(long v)          { char b[24]; sprintf(b, "%ld", v); str = b; }
+String::String(unsigned long v) { char b[24]; sprintf(b, "%lu", v); str = b; }
+String::String(float v, unsigned char decimals)  { char b[40]; sprintf(b, "%.*f", decimals, (double)v); str = b; }
+String::String(double v, unsigned char decimals) { char b[40]; sprintf(b, "%.*f", decimals, v); str = b; }
+
+int String::indexOf(const char *s) const
+{
+    std::string::size_type pos = str.find(s);
+    return (std::string::npos == pos) ? -1 : (int)pos;
+}
+
+/**********/
+/* Stream */
+/**********/
+
+size_t Stream::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (n < size)
+    {
+        write(buffer[n]);
+        n++;
+    }
+    return n;
+}
+
+String Stream::readString(void)
+{
+    std::string out;
+    unsigned long start = millis();
+    while ((millis() - start) < STREAM_TIMEOUT_MS)
+    {
+        int c = read();
+        if (c >= 0)
+        {
+            out += (char)c;
+            start = millis();
+        }
+        else
+        {
+            HalAdvanceMicros(100U);
+        }
+    }
+    return String(out);
+}
+
+size_t HardwareSerial::write(uint8_t data)
+{
+    putchar(data);
+    return 1;
+}
+
+/*************/
+/* ESP model */
+/*************/
+
+static void espReply(const uint8_t *data, size_t len)
+{
+    uint64_t t = HalGetVirtualMicros() + ESP_REPLY_LATENCY_US;
+    if (t < esp_rx_last_us)
+    {
+        t = esp_rx_last_us;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        t += ESP_BYTE_TIME_US;
+        esp_rx.push_back({t, data[i]});
+    }
+    esp_rx_last_us = t;
+}
+
+static void espReplyText(const char *text)
+{
+    espReply((const uint8_t *)text, strlen(text));
+}
+
+static void espReplyIpd(const uint8_t *data, size_t len)
+{
+    char header[16];
+    sprintf(header, "\r\n+IPD,%u:", (unsigned)len);
+    espReplyText(header);
+    espReply(data, len);
+}
+
+/** Answers the MQTT control packets contained in one CIPSEND payload */
+static void espBrokerModel(const std::string &payload)
+{
+    size_t pos = 0;
+    while (pos + 2U <= payload.size())
+    {
+        uint8_t  type = (uint8_t)payload[pos];
+        uint32_t remaining = 0;
+        uint32_t multiplier = 1;
+        size_t   i = pos + 1U;
+        uint8_t  digit;
+        do
+        {
+            if (i >= payload.size())
+            {
+                return;
+            }
+            digit = (uint8_t)payload[i++];
+            remaining += (digit & 0x7FU) * multiplier;
+            multiplier *= 128U;
+        } while (digit & 0x80U);
+
+        const uint8_t *body = (const uint8_t *)payload.data() + i;
+        switch (type & 0xF0U)
+        {
+        case 0x10: /* CONNECT */
+        {
+            const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+            espReplyIpd(connack, sizeof(connack));
+            break;
+        }
+        case 0x30: /* PUBLISH */
+            if (((type >> 1) & 0x03U) == 1U)
+            {
+                uint16_t topic_len = (uint16_t)((body[0] << 8) | body[1]);
+                const uint8_t puback[] = {0x40, 0x02, body[2U + topic_len], body[3U + topic_len]};
+                espReplyIpd(puback, sizeof(puback));
+            }
+            break;
+        case 0xC0: /* PINGREQ */
+        {
+            const uint8_t pingresp[] = {0xD0, 0x00};
+            espReplyIpd(pingresp, sizeof(pingresp));
+            break;
+        }
+        default:
+            break;
+        }
+        pos = i + remaining;
+    }
+}
+
+static void espLine(const std::string &line)
+{
+    if (0 == line.compare(0, 11, "AT+CIPSEND="))
+    {
+        esp_payload_remaining = (unsigned)strtoul(line.c_str() + 11, NULL, 10);
+        esp_payload.clear();
+        espReplyText("\r\nOK\r\n> ");
+    }
+    else if (0 == line.compare(0, 11, "AT+CIPCLOSE"))
+    {
+        espReplyText("CLOSED\r\n\r\nOK\r\n");
+    }
+    else if (0 == line.compare(0, 11, "AT+CIPSTART"))
+    {
+        espReplyText("CONNECT\r\n\r\nOK\r\n");
+    }
+    else if (0 == line.compare(0, 2, "AT"))
+    {
+        espReplyText("\r\nOK\r\n");
+    }
+}
+
+void HalEspReceiveFromHost(uint8_t data)
+{
+    if (esp_payload_remaining > 0U)
+    {
+        esp_payload += (char)data;
+        if (0U == --esp_payload_remaining)
+        {
+            char text[40];
+            sprintf(text, "\r\nRecv %u bytes\r\n\r\nSEND OK\r\n", (unsigned)esp_payload.size());
+            espReplyText(text);
+            espBrokerModel(esp_payload);
+        }
+        return;
+    }
+
+    if ('\n' == data)
+    {
+        if (!esp_line.empty() && ('\r' == esp_line.back()))
+        {
+            esp_line.pop_back();
+        }
+        espLine(esp_line);
+        esp_line.clear();
+    }
+    else
+    {
+        esp_line += (char)data;
+    }
+}
+
+int HalEspAvailable(void)
+{
+    int n = 0;
+    uint64_t now = HalGetVirtualMicros();
+    for (const ESP_RX_BYTE_t &b : esp_rx)
+    {
+        if (b.ready_us > now)
+        {
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+int HalEspRead(void)
+{
+    if (0 == HalEspAvailable())
+    {
+        return -1;
+    }
+    uint8_t data = esp_rx.front().data;
+    esp_rx.pop_front();
+    return data;
+}
+
+/******************/
+/* SoftwareSerial */
+/******************/
+
+size_t SoftwareSerial::write(uint8_t data)
+{
+    HalAdvanceMicros(HAL_COST_SOFT_SERIAL_BYTE_US);
+    HalEspReceiveFromHost(data);
+    return 1;
+}
+
+int SoftwareSerial::available(void)
+{
+    HalAdvanceMicros(HAL_COST_MILLIS_US);
+    return HalEspAvailable();
+}
+
+int SoftwareSerial::read(void)
+{
+    return HalEspRead();
+}
+
+/**  @}
+ * End of native_hal_module group
+ */
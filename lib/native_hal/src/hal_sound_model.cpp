@@ -0,0 +1,42 @@
+/**
+ * \file hal_sound_model.cpp
+ *
+ * \brief Sound detector model on the simulated pin 3 (INT1)
+ *
+ * The detector output idles low and, every HAL_SOUND_PERIOD_MS, emits a
+ *   burst of HAL_SOUND_PULSES short high pulses, as a comparator based
+ *   module does on a loud noise.
+ *
+ *  \addtogroup native_hal_module
+ *  @{
+ */
+
+#include "Arduino.h"
+#include "native_hal.h"
+
+#define HAL_SOUND_PIN          3U
+#define HAL_SOUND_FIRST_MS  7000U
+#define HAL_SOUND_PERIOD_MS 20000U
+#define HAL_SOUND_PULSES       3U
+
+/**
+ * \brief Updates the detector output - called at each 1 ms boundary
+ *
+ * Each pulse is 1 ms high, 1 ms low.
+ */
+void HalSoundModelTick(uint64_t now_us)
+{
+    uint64_t now_ms = now_us / 1000U;
+    if (now_ms < HAL_SOUND_FIRST_MS)
+    {
+        return;
+    }
+
+    uint64_t t = (now_ms - HAL_SOUND_FIRST_MS) % HAL_SOUND_PERIOD_MS;
+    uint8_t level = ((t < (2U * HAL_SOUND_PULSES)) && (0U == (t & 1U))) ? HIGH : LOW;
+    HalSetPinInput(HAL_SOUND_PIN, level);
+}
+
+/**  @}
+ * End of native_hal_module group
+ */
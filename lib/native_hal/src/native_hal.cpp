@@ -0,0 +1,588 @@
+/**
+ * \file native_hal.cpp
+ */
+
+/**
+ * \defgroup native_hal_module Native HAL
+ *
+ * \brief Hardware stand-in used by the PlatformIO \e native environment
+ *
+ * The native HAL replaces the Arduino core and the AVR registers used by the
+ *   firmware, so the scheduler, the task runners and the sensor drivers can
+ *   be run and profiled on a Linux host.
+ *
+ * Time is virtual: a microseconds counter advanced only by the HAL itself.
+ *   Every primitive (digitalRead(), analogRead(), millis(), SoftwareSerial
+ *   bytes, ...) charges its nominal Uno cost, delay() jumps the clock forward,
+ *   and each main loop pass costs HAL_COST_LOOP_PASS_US. Whenever the clock
+ *   crosses a millisecond boundary the installed tick callback - the
+ *   SystickRunner() of the timer module - is called, as the timer compare
+ *   interrupt would on the target. Ticks that fall inside a
+ *   noInterrupts()/interrupts() section are held pending and delivered when
+ *   interrupts are re-enabled, like the AVR interrupt flag. External
+ *   interrupts (attachInterrupt()) follow the same rule, and are raised by
+ *   edges driven through HalSetPinInput() or produced by a pin model - while
+ *   an interrupt is attached to a modelled input pin, the clock advances in
+ *   1 us steps so each model edge is delivered at its own time. As on the
+ *   AVR, an edge of the sense mode last set latches the interrupt flag
+ *   (INTFn) even while no handler is attached, or the pin is an output:
+ *   attachInterrupt() does not clear it, EIFR does. The ADC
+ *   conversion complete interrupt is modelled the same way, at the end of
+ *   each interrupt driven conversion.
+ *
+ * The program runs setup() and then loop() until the requested virtual time
+ *   (first command line argument, in milliseconds, default 60 s) is reached.
+ *
+ * @{
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Arduino.h"
+#include "native_hal.h"
+
+/** Default simulated run length, in milliseconds */
+#define HAL_DEFAULT_RUN_MS 60000UL
+
+/** Virtual time since power on, in microseconds */
+static uint64_t virtual_us;
+/** Virtual time of the next 1 ms tick */
+static uint64_t next_tick_us = 1000U;
+/** Installed tick callback */
+static HAL_TICK_CALLBACK_t tick_callback;
+/** Global interrupt enable (SREG I bit) */
+static bool interrupts_enabled = true;
+/** Tick raised while interrupts were disabled */
+static bool tick_pending;
+/** Re-entrance guard: the tick callback itself runs with interrupts disabled */
+static bool in_tick;
+
+static uint8_t  pin_mode[HAL_PIN_COUNT];
+static uint8_t  pin_output[HAL_PIN_COUNT];
+static uint8_t  pin_input[HAL_PIN_COUNT];
+static HAL_PIN_MODEL_t pin_model[HAL_PIN_COUNT];
+/** attachInterrupt() handlers and trigger modes, by interrupt number */
+static void   (*ext_isr[HAL_EXT_INTERRUPTS])(void);
+static int      ext_mode[HAL_EXT_INTERRUPTS];
+/** External interrupt flags (INTFn) - set by a sensed edge, attached or not, until the handler runs */
+static bool     ext_flag[HAL_EXT_INTERRUPTS];
+/** Last pin level seen by the edge detector, by interrupt number */
+static uint8_t  ext_level[HAL_EXT_INTERRUPTS];
+static uint16_t adc_input[HAL_ADC_CHANNELS] = {512, 512, 512, 512, 512, 512, 512, 512, 355};
+/** Installed ADC conversion complete callback */
+static HAL_ADC_CALLBACK_t adc_callback;
+/** An interrupt driven conversion is running, and its completion time */
+static bool     adc_busy;
+static uint64_t adc_done_us;
+/** ADC interrupt raised while interrupts were disabled */
+static bool     adc_pending;
+
+volatile uint8_t  ADMUX;
+HalAdcsraRegister ADCSRA;
+HalEifrRegister   EIFR;
+volatile uint16_t ADCW;
+volatile uint8_t  WDTCSR;
+
+static void deliverTick(void)
+{
+    if ((NULL == tick_callback) || in_tick)
+    {
+        return;
+    }
+    in_tick = true;
+    interrupts_enabled = false;
+    tick_callback();
+    interrupts_enabled = true;
+    in_tick = false;
+}
+
+static void deliverExtInterrupt(uint8_t interrupt)
+{
+    void (*isr)(void) = ext_isr[interrupt];
+    if (NULL == isr)
+    {
+        return;
+    }
+    /* Running the vector clears INTFn */
+    ext_flag[interrupt] = false;
+    interrupts_enabled = false;
+    isr();
+    interrupts_enabled = true;
+}
+
+static void deliverAdcInterrupt(void)
+{
+    if (NULL == adc_callback)
+    {
+        return;
+    }
+    /* Running the vector clears ADIF - as writing it as one does */
+    ADCSRA |= _BV(ADIF);
+    interrupts_enabled = false;
+    adc_callback();
+    interrupts_enabled = true;
+}
+
+static void deliverPendingInterrupts(void)
+{
+    if (tick_pending)
+    {
+        tick_pending = false;
+        deliverTick();
+    }
+    for (uint8_t i = 0; i < HAL_EXT_INTERRUPTS; i++)
+    {
+        if (ext_flag[i])
+        {
+            deliverExtInterrupt(i);
+        }
+    }
+    if (adc_pending)
+    {
+        adc_pending = false;
+        deliverAdcInterrupt();
+    }
+}
+
+static void completeAdcConversion(void)
+{
+    adc_busy = false;
+    ADCSRA.completeConversion();
+    if (!(ADCSRA & _BV(ADIE)))
+    {
+        return;
+    }
+    if (interrupts_enabled && !in_tick)
+    {
+        deliverAdcInterrupt();
+    }
+    else
+    {
+        adc_pending = true;
+    }
+}
+
+static void raiseExtInterrupt(uint8_t interrupt, uint8_t level)
+{
+    int mode = ext_mode[interrupt];
+    if (!((CHANGE == mode) || ((RISING == mode) && (HIGH == level)) || ((FALLING == mode) && (LOW == level))))
+    {
+        return;
+    }
+    ext_flag[interrupt] = true;
+    if (interrupts_enabled && !in_tick)
+    {
+        deliverExtInterrupt(interrupt);
+    }
+}
+
+/** Feeds the edge detector of an external interrupt pin with its current level */
+static void trackExtLevel(uint8_t interrupt)
+{
+    uint8_t level = (uint8_t)HalPinRead(HAL_EXT_INTERRUPT_PIN(interrupt));
+    if (level != ext_level[interrupt])
+    {
+        ext_level[interrupt] = level;
+        raiseExtInterrupt(interrupt, level);
+    }
+}
+
+static void trackPinLevel(uint8_t pin)
+{
+    int interrupt = digitalPinToInterrupt(pin);
+    if (NOT_AN_INTERRUPT != interrupt)
+    {
+        trackExtLevel((uint8_t)interrupt);
+    }
+}
+
+/** An attached external interrupt must follow a pin model, edge by edge */
+static bool modelEdgeWatchActive(void)
+{
+    for (uint8_t i = 0; i < HAL_EXT_INTERRUPTS; i++)
+    {
+        uint8_t pin = HAL_EXT_INTERRUPT_PIN(i);
+        if ((NULL != ext_isr[i]) && (NULL != pin_model[pin]) && (OUTPUT != pin_mode[pin]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void sampleModelEdges(void)
+{
+    for (uint8_t i = 0; i < HAL_EXT_INTERRUPTS; i++)
+    {
+        uint8_t pin = HAL_EXT_INTERRUPT_PIN(i);
+        if ((NULL == ext_isr[i]) || (NULL == pin_model[pin]) || (OUTPUT == pin_mode[pin]))
+        {
+            continue;
+        }
+        trackExtLevel(i);
+    }
+}
+
+/** Edges of detached modelled pins are only seen at the end of a clock advance */
+static void sampleDetachedEdges(void)
+{
+    for (uint8_t i = 0; i < HAL_EXT_INTERRUPTS; i++)
+    {
+        if ((NULL == ext_isr[i]) && (NULL != pin_model[HAL_EXT_INTERRUPT_PIN(i)]))
+        {
+            trackExtLevel(i);
+        }
+    }
+}
+
+uint64_t HalGetVirtualMicros(void)
+{
+    return virtual_us;
+}
+
+void HalAdvanceMicros(uint32_t us)
+{
+    uint64_t target_us = virtual_us + us;
+    while (virtual_us < target_us)
+    {
+        if (modelEdgeWatchActive())
+        {
+            virtual_us++;
+            sampleModelEdges();
+        }
+        else if (adc_busy && (adc_done_us < target_us))
+        {
+            virtual_us = adc_done_us;
+        }
+        else
+        {
+            virtual_us = target_us;
+        }
+
+        while (virtual_us >= next_tick_us)
+        {
+            next_tick_us += 1000U;
+            HalSoundModelTick(next_tick_us - 1000U);
+            if (interrupts_enabled)
+            {
+                deliverTick();
+            }
+            else
+            {
+                tick_pending = true;
+            }
+        }
+
+        if (adc_busy && (virtual_us >= adc_done_us))
+        {
+            completeAdcConversion();
+        }
+    }
+    sampleDetachedEdges();
+    if (interrupts_enabled && !in_tick)
+    {
+        deliverPendingInterrupts();
+    }
+}
+
+void HalSleepUntilNextTick(void)
+{
+    HalAdvanceMicros((uint32_t)(next_tick_us - virtual_us));
+}
+
+/** Microseconds since the last tick boundary - the native TCNT2 */
+uint16_t HalGetTickMicros(void)
+{
+    return (uint16_t)(virtual_us - (next_tick_us - 1000U));
+}
+
+/** A tick was raised but is held by a critical section - the native OCF2A */
+bool HalTickPending(void)
+{
+    return tick_pending;
+}
+
+void HalInstallTickCallback(HAL_TICK_CALLBACK_t callback)
+{
+    tick_callback = callback;
+}
+
+void HalDisableInterrupts(void)
+{
+    interrupts_enabled = false;
+}
+
+void HalEnableInterrupts(void)
+{
+    interrupts_enabled = true;
+    deliverPendingInterrupts();
+}
+
+bool HalInterruptsEnabled(void)
+{
+    return interrupts_enabled;
+}
+
+void HalSetPinInput(uint8_t pin, uint8_t level)
+{
+    if (pin >= HAL_PIN_COUNT)
+    {
+        return;
+    }
+    pin_input[pin] = level ? HIGH : LOW;
+    trackPinLevel(pin);
+}
+
+void HalInstallPinModel(uint8_t pin, HAL_PIN_MODEL_t model)
+{
+    if (pin < HAL_PIN_COUNT)
+    {
+        pin_model[pin] = model;
+    }
+}
+
+uint8_t HalGetPinOutput(uint8_t pin)
+{
+    return (pin < HAL_PIN_COUNT) ? pin_output[pin] : LOW;
+}
+
+void HalSetAnalogInput(uint8_t channel, uint16_t adc_code)
+{
+    if (channel < HAL_ADC_CHANNELS)
+    {
+        adc_input[channel] = adc_code & 0x3FFU;
+    }
+}
+
+uint16_t HalConvertAdc(uint8_t channel)
+{
+    return (channel < HAL_ADC_CHANNELS) ? adc_input[channel] : 0U;
+}
+
+void HalInstallAdcCallback(HAL_ADC_CALLBACK_t callback)
+{
+    adc_callback = callback;
+}
+
+void HalAdcsraRegister::write(uint8_t v)
+{
+    /* Writing ADIF as one clears it */
+    if (v & _BV(ADIF))
+    {
+        v &= (uint8_t)~_BV(ADIF);
+    }
+    else
+    {
+        v |= (uint8_t)(value & _BV(ADIF));
+    }
+
+    bool start = (v & _BV(ADEN)) && (v & _BV(ADSC)) && !adc_busy;
+    value = v;
+    if (!start)
+    {
+        return;
+    }
+    if (v & _BV(ADIE))
+    {
+        /* 13 ADC clocks at 125 kHz, completed by HalAdvanceMicros() */
+        adc_busy = true;
+        adc_done_us = virtual_us + 104U;
+    }
+    else
+    {
+        HalAdvanceMicros(104U);
+        completeConversion();
+    }
+}
+
+/** Ends the running conversion: result in ADCW, ADSC cleared, ADIF set */
+void HalAdcsraRegister::completeConversion(void)
+{
+    ADCW = HalConvertAdc(ADMUX & 0x0FU);
+    value = (uint8_t)((value & ~_BV(ADSC)) | _BV(ADIF));
+}
+
+/*****************/
+/* Arduino core */
+/*****************/
+
+void HalPinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin >= HAL_PIN_COUNT)
+    {
+        return;
+    }
+    pin_mode[pin] = mode;
+    if (INPUT_PULLUP == mode)
+    {
+        pin_input[pin] = HIGH;
+    }
+    HalDhtNotifyPinWrite(pin, mode, pin_output[pin]);
+    trackPinLevel(pin);
+}
+
+void HalPinWrite(uint8_t pin, uint8_t level)
+{
+    if (pin >= HAL_PIN_COUNT)
+    {
+        return;
+    }
+    pin_output[pin] = level ? HIGH : LOW;
+    HalDhtNotifyPinWrite(pin, pin_mode[pin], pin_output[pin]);
+    trackPinLevel(pin);
+}
+
+int HalPinRead(uint8_t pin)
+{
+    if (pin >= HAL_PIN_COUNT)
+    {
+        return LOW;
+    }
+    if (OUTPUT == pin_mode[pin])
+    {
+        return pin_output[pin];
+    }
+    if (NULL != pin_model[pin])
+    {
+        return pin_model[pin](virtual_us);
+    }
+    return pin_input[pin];
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    HalPinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+    HalAdvanceMicros(HAL_COST_DIGITAL_IO_US);
+    HalPinWrite(pin, level);
+}
+
+int digitalRead(uint8_t pin)
+{
+    HalAdvanceMicros(HAL_COST_DIGITAL_IO_US);
+    return HalPinRead(pin);
+}
+
+int analogRead(uint8_t pin)
+{
+    HalAdvanceMicros(HAL_COST_ANALOG_READ_US);
+    /* Arduino accepts both 0..5 and A0..A5 (14..19) */
+    if (pin >= 14U)
+    {
+        pin -= 14U;
+    }
+    return HalConvertAdc(pin);
+}
+
+unsigned long millis(void)
+{
+    HalAdvanceMicros(HAL_COST_MILLIS_US);
+    return (unsigned long)(virtual_us / 1000U);
+}
+
+unsigned long micros(void)
+{
+    HalAdvanceMicros(HAL_COST_MILLIS_US);
+    return (unsigned long)virtual_us;
+}
+
+void delay(unsigned long ms)
+{
+    while (ms > 0U)
+    {
+        HalAdvanceMicros(1000U);
+        ms--;
+    }
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    HalAdvanceMicros(us);
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode)
+{
+    if (interrupt < HAL_EXT_INTERRUPTS)
+    {
+        /* EICRA, then EIMSK - a flag already set in EIFR fires right away */
+        ext_mode[interrupt] = mode;
+        trackExtLevel(interrupt);
+        ext_isr[interrupt] = isr;
+        if (ext_flag[interrupt] && interrupts_enabled && !in_tick)
+        {
+            deliverExtInterrupt(interrupt);
+        }
+    }
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+    if (interrupt < HAL_EXT_INTERRUPTS)
+    {
+        /* EIMSK only - the sense mode stays, and so does edge detection */
+        ext_isr[interrupt] = NULL;
+    }
+}
+
+HalEifrRegister::operator uint8_t() const
+{
+    uint8_t flags = 0;
+    for (uint8_t i = 0; i < HAL_EXT_INTERRUPTS; i++)
+    {
+        flags |= (uint8_t)(ext_flag[i] ? _BV(i) : 0U);
+    }
+    return flags;
+}
+
+HalEifrRegister& HalEifrRegister::operator=(uint8_t v)
+{
+    /* Writing a one clears the flag */
+    for (uint8_t i = 0; i < HAL_EXT_INTERRUPTS; i++)
+    {
+        if (v & _BV(i))
+        {
+            ext_flag[i] = false;
+        }
+    }
+    return *this;
+}
+
+char *dtostrf(double val, signed char width, unsigned char prec, char *sout)
+{
+    sprintf(sout, "%*.*f", width, prec, val);
+    return sout;
+}
+
+/****************/
+/* Program entry */
+/****************/
+
+/* Unit tests bring their own main() */
+#ifndef PIO_UNIT_TESTING
+int main(int argc, char *argv[])
+{
+    uint64_t run_us = (uint64_t)HAL_DEFAULT_RUN_MS * 1000U;
+    if (argc > 1)
+    {
+        run_us = strtoull(argv[1], NULL, 10) * 1000U;
+    }
+
+    setup();
+    while (virtual_us < run_us)
+    {
+        loop();
+        HalAdvanceMicros(HAL_COST_LOOP_PASS_US);
+    }
+
+    fflush(stdout);
+    return 0;
+}
+#endif
+
+/**  @}
+ * End of native_hal_module group definition
+ */
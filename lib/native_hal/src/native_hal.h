@@ -0,0 +1,76 @@
+#ifndef NATIVE_HAL_H_
+#define NATIVE_HAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * \file native_hal.h
+ */
+
+/**
+ * \addtogroup native_hal_module
+ * @{
+ */
+
+/** Number of simulated digital pins (Uno: D0..D19) */
+#define HAL_PIN_COUNT      20
+/** Number of simulated external interrupts (Uno: INT0, INT1) */
+#define HAL_EXT_INTERRUPTS  2
+/** Pin of an external interrupt */
+#define HAL_EXT_INTERRUPT_PIN(i) (2U + (i))
+/** Number of simulated ADC multiplexer channels (0..7 external, 8 internal temperature sensor) */
+#define HAL_ADC_CHANNELS    9
+
+/** Virtual cost, in microseconds, charged by each HAL primitive */
+#define HAL_COST_DIGITAL_IO_US     4
+#define HAL_COST_ANALOG_READ_US  112
+#define HAL_COST_MILLIS_US         1
+#define HAL_COST_LOOP_PASS_US     10
+/** SoftwareSerial at 9600 bps blocks ~1.04 ms per transmitted byte */
+#define HAL_COST_SOFT_SERIAL_BYTE_US 1042
+
+/** Level provided by a pin model at a given virtual time */
+typedef uint8_t (*HAL_PIN_MODEL_t)(uint64_t now_us);
+/** Periodic 1 ms tick callback (stands in for the timer compare interrupt) */
+typedef void (*HAL_TICK_CALLBACK_t)(void);
+/** ADC conversion complete callback (stands in for the ADC interrupt) */
+typedef void (*HAL_ADC_CALLBACK_t)(void);
+
+/* Virtual clock */
+uint64_t HalGetVirtualMicros(void);
+void     HalAdvanceMicros(uint32_t us);
+void     HalSleepUntilNextTick(void);
+uint16_t HalGetTickMicros(void);
+bool     HalTickPending(void);
+void     HalInstallTickCallback(HAL_TICK_CALLBACK_t callback);
+void     HalDisableInterrupts(void);
+void     HalEnableInterrupts(void);
+bool     HalInterruptsEnabled(void);
+
+/* Pin access charging no virtual time - single instruction accesses (FastPin) */
+void     HalPinMode(uint8_t pin, uint8_t mode);
+void     HalPinWrite(uint8_t pin, uint8_t level);
+int      HalPinRead(uint8_t pin);
+
+/* Stimulus */
+void     HalSetPinInput(uint8_t pin, uint8_t level);
+void     HalInstallPinModel(uint8_t pin, HAL_PIN_MODEL_t model);
+uint8_t  HalGetPinOutput(uint8_t pin);
+void     HalSetAnalogInput(uint8_t channel, uint16_t adc_code);
+uint16_t HalConvertAdc(uint8_t channel);
+void     HalInstallAdcCallback(HAL_ADC_CALLBACK_t callback);
+
+/* Sensor and link models */
+void     HalDhtSetReading(float humidity, float temperature);
+void     HalDhtNotifyPinWrite(uint8_t pin, uint8_t mode, uint8_t level);
+void     HalSoundModelTick(uint64_t now_us);
+void     HalEspReceiveFromHost(uint8_t data);
+int      HalEspAvailable(void);
+int      HalEspRead(void);
+
+/**  @}
+ * End of native_hal_module group inclusion
+ */
+
+#endif /* NATIVE_HAL_H_ */
@@ -0,0 +1,42 @@
+#ifndef NATIVE_UTIL_ATOMIC_H_
+#define NATIVE_UTIL_ATOMIC_H_
+
+/**
+ * \file atomic.h
+ *
+ * \brief Native stand-in for avr-libc <util/atomic.h>, built on the HAL interrupt flag
+ */
+
+#include <stdbool.h>
+
+#include "native_hal.h"
+
+static inline bool halAtomicEnter(void)
+{
+    bool enabled = HalInterruptsEnabled();
+    HalDisableInterrupts();
+    return enabled;
+}
+
+static inline void halAtomicRestore(bool *enabled)
+{
+    if (*enabled)
+    {
+        HalEnableInterrupts();
+    }
+}
+
+static inline void halAtomicForceOn(bool *enabled)
+{
+    (void)enabled;
+    HalEnableInterrupts();
+}
+
+#define ATOMIC_RESTORESTATE halAtomicRestore
+#define ATOMIC_FORCEON      halAtomicForceOn
+
+#define ATOMIC_BLOCK(type) \
+    for (bool hal_sreg_save __attribute__((cleanup(type))) = halAtomicEnter(), hal_atomic_once = true; \
+         hal_atomic_once; hal_atomic_once = false)
+
+#endif /* NATIVE_UTIL_ATOMIC_H_ */
@@ -6,8 +6,27 @@
 /**
  *  \defgroup acesso ao chip DHT11 - Versão para Arduino
  *
- *  \brief Provê acesso ao sensor de temperatura DHT11
+ *  \brief Provê acesso ao sensor de temperatura DHT11 (e DHT22/AM2302)
  *
+ *  O modelo de sensor é escolhido na compilação (-D DHT_SENSOR=Dht22Policy,
+ *  ver dht_sensor.h): a política define o sinal de início, o intervalo
+ *  mínimo entre leituras, os limites de largura dos bits e a decodificação
+ *  dos dados; a captura do quadro é a mesma para toda a família.
+ *
+ *  O quadro do sensor é lido por captura de bordas: depois do sinal de
+ *  início, a interrupção externa INT0 (pino 2) registra o instante de cada
+ *  borda de descida. Cada bit começa com uma descida, então a largura de um
+ *  bit - 50us em nível baixo mais 26-28us ("0") ou 70us ("1") em nível alto
+ *  - é a distância entre duas descidas consecutivas, e os 40 bits saem de
+ *  41 instantes. A decodificação é feita na tarefa rápida, depois do fim do
+ *  quadro, sem espera ocupada nem amostragem por delayMicroseconds().
+ *
+ *  Uma leitura que falha é repetida assim que o intervalo mínimo do sensor
+ *  permite, sem esperar o próximo pedido da tarefa muito lenta, até
+ *  DHT_MAX_RETRIES vezes. Cada falha seguida dobra o intervalo entre
+ *  leituras (até 2^DHT_MAX_BACKOFF vezes o mínimo), e o sucesso o
+ *  restabelece. As falhas são contadas por tipo - ver Dht11GetStats() e
+ *  Dht11ReportStats().
  *
  *  @{
  */
@@ -20,21 +39,60 @@
 // #include "terminal.h"
 // #include "nrf_delay.h"
 #include "timer.h"
+#include "protothread.h"
+#include "fast_pin.h"
+#include "dht_sensor.h"
+#include "sensor_cache.h"
 
-#define BYTES 5
+#define BYTES DHT_FRAME_BYTES
 #define BYTE 8
 #define TEMP_GPIO (2U)
 
+/** Sensor data line - INT0 */
+typedef FastPin<TEMP_GPIO> TempPin;
+
+/** Captured falling edges: the start of each of the 40 bits, and the end of the last one */
+#define FRAME_EDGES (BYTES * BYTE + 1U)
+
+/** Retries of a failed read, at growing intervals, before waiting for a new request */
+#define DHT_MAX_RETRIES 3U
+/** Largest backoff exponent - the read interval goes up to MIN_INTERVAL_MS << DHT_MAX_BACKOFF */
+#define DHT_MAX_BACKOFF 3U
+
 static float temperature;
 static float umidade;
-static const uint64_t SENSOR_TIMEOUT = 5000;
+/** End of the last read, in system ms - reads are DhtSensor::MIN_INTERVAL_MS apart */
+static uint32_t last_read_time;
+/** No read done yet */
+static bool first_read = true;
+/** Measurement sequence protothread, resumed by the fast time task */
+static PT_t measure_pt;
+/** A measurement was requested by the very slow time task */
+static bool measure_request;
+/** Retries left for the current failed read */
+static uint8_t retries_left;
+/** The read in progress is a retry */
+static bool retry_read;
+/** Consecutive failed reads - sets the read interval backoff */
+static uint8_t consecutive_failures;
+/** Read error statistics */
+static DHT_STATS_t dht_stats;
+
+/** Falling edge times, in us - written by the INT0 handler */
+static uint32_t edge_time[FRAME_EDGES];
+/** Falling edges seen so far, the sensor response edge included */
+static volatile uint8_t edge_count;
 
 // static void temperaturePowerOn(void);
-static uint8_t dht11MeasureTemperature(void);
+static PT_THREAD(dht11MeasureThread(PT_t *pt));
 static void sendStartSignal(void);
-static uint8_t waitForSensorResponse(void);
-static uint8_t waitSensorReadyToOutputSignal(void);
-static uint8_t receiveDataFromDHT11(uint8_t itens[5]);
+static void startEdgeCapture(void);
+static void stopEdgeCapture(void);
+static bool isFrameCaptured(void);
+static void dht11EdgeIsr(void);
+static SENSOR_ERROR_t decodeFrame(uint8_t itens[BYTES]);
+static void countReadError(SENSOR_ERROR_t error);
+static bool isReadDue(void);
 static bool isDataValid(uint8_t itens[BYTES]);
 
 /**
@@ -46,21 +104,22 @@ void DHT11_run(TASKS_t running_task)
     {
     case POWERON_TASK:
         //temperaturePowerOn();
+        PT_INIT(&measure_pt);
+        break;
+    case FAST_TIME_TASK:
+        dht11MeasureThread(&measure_pt);
         break;
     case VERY_SLOW_TIME_TASK:
+    {
         // Wait a few seconds between measurements.
         // The DHT sensor is very slow getting the readings
         // (the sensor readings may take up to 2 seconds)
         // Serial.print("DHT11 counter:");
         // Serial.println(count);
         Serial.println("Hora de medir a temp!");
-        uint8_t ret_code = dht11MeasureTemperature();
-        if(ret_code)
-        {
-            /* Log internal error */
-            // INTERRLOG("Temperature error");
-        }
+        measure_request = true;
         break;
+    }
     default:
         /* Log internal error */
         // INTERRLOG("tried to run an unsupported task");
@@ -75,151 +134,213 @@ uint8_t DHT11_test(TASKS_t running_task)
 
 // static void temperaturePowerOn(void) {}
 
-static uint8_t dht11MeasureTemperature(void)
+/**
+ * Measurement sequence: waits for a request (or a pending retry), drives
+ *   the start signal and yields while it lasts, then releases the line and
+ *   yields while the frame edges are captured. Requests made while a
+ *   measurement is in progress, or before the read interval, are served by
+ *   the next measurement.
+ */
+static PT_THREAD(dht11MeasureThread(PT_t *pt))
 {
-    uint8_t itens[5] = {0, // rh_int
-                        0, // rh_decimal
-                        0, // temperature_int
-                        0, // temperature_decimal
-                        0};// checksum
-    sendStartSignal();
-    uint8_t ret_code = waitForSensorResponse();
-    if(ret_code) // timeout
+    uint8_t itens[BYTES] = {0, 0, 0, 0, 0}; // 4 data bytes + checksum
+    int16_t decoded_temperature;
+    uint16_t decoded_humidity;
+    SENSOR_ERROR_t error;
+
+    PT_BEGIN(pt);
+
+    PT_WAIT_UNTIL(pt, measure_request || (retries_left > 0U));
+    PT_WAIT_UNTIL(pt, isReadDue());
+    /* A request arriving while a retry is pending is served by the retry */
+    retry_read = (retries_left > 0U);
+    if (retry_read)
     {
-        temperature = 0;
-        return ret_code;
+        retries_left--;
+        dht_stats.retries++;
     }
-    ret_code = waitSensorReadyToOutputSignal();
-    if(ret_code) // timeout
+    measure_request = false;
+    dht_stats.reads++;
+
+    sendStartSignal();
+    PT_WAIT_MS(pt, DhtSensor::START_SIGNAL_MS);
+
+    startEdgeCapture();
+    pt->t0 = GetSystemTime();
+    PT_WAIT_UNTIL(pt, isFrameCaptured() || TestTimerExpired(pt->t0, DhtSensor::FRAME_TIMEOUT_MS));
+    stopEdgeCapture();
+    last_read_time = GetSystemTime();
+    first_read = false;
+
+    error = decodeFrame(itens);
+    if(SENSOR_OK != error)
     {
-        temperature = 0;
-        return ret_code;
+        countReadError(error);
+        if (consecutive_failures < UINT8_MAX)
+        {
+            consecutive_failures++;
+        }
+        /* The first failure gets the retries; the next reads only back off */
+        if (1U == consecutive_failures)
+        {
+            retries_left = DHT_MAX_RETRIES;
+        }
+        else if (retry_read && (0U == retries_left))
+        {
+            dht_stats.give_ups++;
+        }
+        /* Last good values are kept - the cache tells they are getting old */
+        SensorCacheReportError(SENSOR_DHT_TEMPERATURE, error);
+        SensorCacheReportError(SENSOR_DHT_HUMIDITY, error);
+        /* Log internal error */
+        // INTERRLOG("Temperature error");
     }
-    ret_code = receiveDataFromDHT11(itens);
-
-    umidade = itens[0] + itens[1]/100.0f;
-    if(ret_code)
+    else
     {
-        temperature = 0;
-        return 1;
+        retries_left = 0;
+        consecutive_failures = 0;
+        dht_stats.good_reads++;
+        DhtSensor::decode(itens, &decoded_temperature, &decoded_humidity);
+        umidade = decoded_humidity / 10.0f;
+        temperature = decoded_temperature / 10.0f;
+        SensorCacheUpdate(SENSOR_DHT_TEMPERATURE, temperature);
+        SensorCacheUpdate(SENSOR_DHT_HUMIDITY, umidade);
     }
 
-    temperature = itens[2] + itens[3]/10.0f;
-
-    return ret_code;
+    PT_END(pt);
 }
 
-// Step 1.1: MCU send out start signal to DHT11 and
-static void sendStartSignal(void)
+/**
+ * The sensor can be read again: first read, or the read interval - the
+ *   sensor minimum, doubled for each consecutive failure after the first
+ *   one - elapsed.
+ */
+static bool isReadDue(void)
 {
-    // uint8_t start_signal;
-    pinMode(TEMP_GPIO, OUTPUT);
-
-    digitalWrite(TEMP_GPIO, LOW);  // Host send start signal
-    delay(25);                   // Host pulls low - 18ms minimum
-    // start_signal = 
-    digitalRead(TEMP_GPIO);
-    // printf("Start signal: %d\n", start_signal);
-    digitalWrite(TEMP_GPIO, HIGH);    // Host pulls up and wait for sensor's response
-
+    uint8_t backoff = (consecutive_failures > 1U) ? (uint8_t)(consecutive_failures - 1U) : 0U;
+    if (backoff > DHT_MAX_BACKOFF)
+    {
+        backoff = DHT_MAX_BACKOFF;
+    }
+    return first_read || TestTimerExpired(last_read_time, (uint32_t)DhtSensor::MIN_INTERVAL_MS << backoff);
 }
 
-// Step 1.2: DHT11 send response signal to MCU
-static uint8_t waitForSensorResponse(void)
+/**
+ * Counts a failed read by cause. Timeouts are split by the protocol phase
+ *   reached: no response edge, response but no data, incomplete data.
+ */
+static void countReadError(SENSOR_ERROR_t error)
 {
-    uint64_t ref_time = GetSystemTime();
-    //uint8_t host_holding_up;
-    //uint8_t sensor_pulls_low;
-    pinMode(TEMP_GPIO, INPUT);
-
-    //host_holding_up = nrf_gpio_pin_read(TEMP_GPIO);
-    while(digitalRead(TEMP_GPIO))
+    switch(error)
     {
-        if(TestTimerExpired(ref_time, SENSOR_TIMEOUT))
+    case SENSOR_ERR_TIMEOUT:
+        if (0U == edge_count)
+        {
+            dht_stats.timeout_response++;
+        }
+        else if (1U == edge_count)
         {
-            return 1;
+            dht_stats.timeout_ready++;
         }
-    } // Host pulls up - 20-40us
+        else
+        {
+            dht_stats.timeout_data++;
+        }
+        break;
+    case SENSOR_ERR_FRAME:
+        dht_stats.frame_errors++;
+        break;
+    case SENSOR_ERR_CHECKSUM:
+        dht_stats.checksum_errors++;
+        break;
+    default:
+        break;
+    }
+}
 
-    // sensor_pulls_low = nrf_gpio_pin_read(TEMP_GPIO); // Sensor remains low about 80us
-    // printf("Sensor out response 0: %d\n", sensor_pulls_low);
+// Step 1: MCU send out start signal to the sensor
+static void sendStartSignal(void)
+{
+    TempPin::clear();
+    TempPin::setOutput();          // Host send start signal
+                                   // Host pulls low - DhtSensor::START_SIGNAL_MS: see dht11MeasureThread()
+}
 
-    return 0;
+// Step 2: host releases the line and the sensor answers - 80us low, 80us
+//   high - then sends 40 bits, each one a 50us low followed by 26-28us
+//   ("0") or 70us ("1") high, and a final 50us low
+static void startEdgeCapture(void)
+{
+    edge_count = 0;
+    TempPin::set();                 // Host pulls up and wait for sensor's response
+    TempPin::setInput();
+    /* The start signal latched INTF0 - the sense mode outlives detachInterrupt() -
+       and attachInterrupt() leaves EIFR alone: a stale flag would count as the response */
+    EIFR = _BV(INTF0);
+    attachInterrupt(digitalPinToInterrupt(TEMP_GPIO), &dht11EdgeIsr, FALLING);
 }
 
-static uint8_t waitSensorReadyToOutputSignal(void)
+static void stopEdgeCapture(void)
 {
-    uint64_t ref_time = GetSystemTime();
+    detachInterrupt(digitalPinToInterrupt(TEMP_GPIO));
+}
 
-    //uint8_t sensor_pulls_up;
-    while(!digitalRead(TEMP_GPIO))
+static bool isFrameCaptured(void)
+{
+    return edge_count > FRAME_EDGES;
+}
+
+/**
+ * INT0 falling edge handler: the first edge is the sensor response, the
+ *   next FRAME_EDGES ones are timestamped.
+ */
+static void dht11EdgeIsr(void)
+{
+    uint8_t count = edge_count;
+    if (count > FRAME_EDGES)
     {
-        if(TestTimerExpired(ref_time, SENSOR_TIMEOUT))
-        {
-            return 1;
-        }
+        return;
     }
-
-    // sensor_pulls_up = 
-    digitalRead(TEMP_GPIO);
-    // printf("Sensor com 1: %d\n", sensor_pulls_up);
-    //AD5940_Delay10us(8); // Sensor pulls up - 80us
-    return 0;
+    if (count > 0U)
+    {
+        edge_time[count - 1U] = GetHiResSystemTime();
+    }
+    edge_count = count + 1U;
 }
 
-// Step 2: DHT11 send data to MCU
-/*
-    When DHT11 is sending data to MCU,
-    every bit's transmission begin with
-    low-voltage-level that last 50us, the
-    following high-voltage-level signal's length decide the bit is "1" or "0"
-    if the high level stands for 26-28us, this is "0"
-    if the high level stands for 70us, this is "1"
-*/
-static uint8_t receiveDataFromDHT11(uint8_t itens[5])
+// Step 3: bits from the distance between falling edges
+static SENSOR_ERROR_t decodeFrame(uint8_t itens[BYTES])
 {
-    uint64_t ref_time = GetSystemTime();
-    while(digitalRead(TEMP_GPIO))
+    if(!isFrameCaptured())
     {
-        if(TestTimerExpired(ref_time, SENSOR_TIMEOUT))
-        {
-            return 1;
-        }
-    } // Waiting start of data
+        return SENSOR_ERR_TIMEOUT;
+    }
 
-    for(uint8_t j=0 ; j<BYTES ; j++)
+    for(uint8_t bit=0 ; bit<(BYTES*BYTE) ; bit++)
     {
-        for(uint8_t i=0 ; i<BYTE ; i++)
+        uint32_t width = edge_time[bit + 1U] - edge_time[bit];
+        if((width < DhtSensor::BIT_MIN_US) || (width > DhtSensor::BIT_MAX_US))
         {
-            while(!digitalRead(TEMP_GPIO)) {}
-            delayMicroseconds(30); // se descer é "0"
-            itens[j] = itens[j] << 1;
-            if(digitalRead(TEMP_GPIO))
-            {
-                // printf("Um!\n");
-                itens[j] = itens[j] | 1;
-            }
-            while(digitalRead(TEMP_GPIO))
-            {
-                if(TestTimerExpired(ref_time, SENSOR_TIMEOUT))
-                {
-                    return 1;
-                }
-            } // aguardar descer
+            return SENSOR_ERR_FRAME; // borda perdida ou espúria
+        }
+        itens[bit/BYTE] = itens[bit/BYTE] << 1;
+        if(width >= DhtSensor::BIT_ONE_MIN_US)
+        {
+            itens[bit/BYTE] = itens[bit/BYTE] | 1;
         }
     }
     if(!isDataValid(itens))
     {
         // printf("Dado corrompido! =(\n");
-        return 1;
+        return SENSOR_ERR_CHECKSUM;
     }
-    return 0;
+    return SENSOR_OK;
 }
 
 static bool isDataValid(uint8_t itens[BYTES])
 {
-    // checksum
-    if(itens[0]+itens[1]+itens[2]+itens[3] == itens[4])
+    // checksum - low byte of the sum
+    if((uint8_t)(itens[0]+itens[1]+itens[2]+itens[3]) == itens[4])
     {
         return true;
     }
@@ -229,6 +350,115 @@ static bool isDataValid(uint8_t itens[BYTES])
     }
 }
 
+#if defined(BENCHMARK) && !defined(NATIVE_BUILD)
+/** Número de repetições por medição de \e benchmark */
+#define BENCH_ITERATIONS 32U
+/** Leituras do pino por quadro no decodificador anterior, por amostragem:
+ *  no mínimo a saída da espera de subida, a amostra e a saída da espera de descida */
+#define BENCH_POLLED_READS_PER_FRAME (3U * BYTES * BYTE)
+
+/** Destino das leituras medidas, evita que o compilador as elimine */
+static volatile uint8_t bench_sink;
+
+/**
+ * \brief Mede o custo, em ciclos, dos acessos ao pino do sensor: API Arduino e FastPin
+ *
+ * Mede o par de acessos de cada fase do sinal de início (modo + nível) e
+ *   uma leitura, e estima o custo por quadro do decodificador por amostragem
+ *   anterior à captura de bordas. Usa o pino do sensor - chamar antes da
+ *   primeira medição.
+ */
+void Dht11Benchmark(void)
+{
+    uint16_t start;
+    uint16_t overhead;
+    uint16_t cycles[4];
+
+    SetupCycleCounter();
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = i; }
+    overhead = GetCycleCount() - start;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        pinMode(TEMP_GPIO, OUTPUT);
+        digitalWrite(TEMP_GPIO, LOW);
+        digitalWrite(TEMP_GPIO, HIGH);
+        pinMode(TEMP_GPIO, INPUT);
+        bench_sink = i;
+    }
+    cycles[0] = GetCycleCount() - start - overhead;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        TempPin::clear();
+        TempPin::setOutput();
+        TempPin::set();
+        TempPin::setInput();
+        bench_sink = i;
+    }
+    cycles[1] = GetCycleCount() - start - overhead;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = digitalRead(TEMP_GPIO); }
+    cycles[2] = GetCycleCount() - start - overhead;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = TempPin::read(); }
+    cycles[3] = GetCycleCount() - start - overhead;
+
+    Serial.print("[BENCH] DHT11 sinal de inicio Arduino/FastPin: ");
+    Serial.print(cycles[0] / BENCH_ITERATIONS);
+    Serial.print("/");
+    Serial.print(cycles[1] / BENCH_ITERATIONS);
+    Serial.print(" ciclos, leitura: ");
+    Serial.print(cycles[2] / BENCH_ITERATIONS);
+    Serial.print("/");
+    Serial.print(cycles[3] / BENCH_ITERATIONS);
+    Serial.print(" ciclos, quadro por amostragem: ");
+    Serial.print((uint32_t)(cycles[2] / BENCH_ITERATIONS) * BENCH_POLLED_READS_PER_FRAME);
+    Serial.print("/");
+    Serial.print((uint32_t)(cycles[3] / BENCH_ITERATIONS) * BENCH_POLLED_READS_PER_FRAME);
+    Serial.println(" ciclos");
+}
+#endif
+
+/**
+ * \brief Gets the read error statistics
+ */
+void Dht11GetStats(DHT_STATS_t *stats)
+{
+    *stats = dht_stats;
+}
+
+/**
+ * \brief Prints the read error statistics
+ */
+void Dht11ReportStats(void)
+{
+    Serial.print("[DHT] reads=");
+    Serial.print(dht_stats.reads);
+    Serial.print(" ok=");
+    Serial.print(dht_stats.good_reads);
+    Serial.print(" timeouts response/ready/data=");
+    Serial.print(dht_stats.timeout_response);
+    Serial.print("/");
+    Serial.print(dht_stats.timeout_ready);
+    Serial.print("/");
+    Serial.print(dht_stats.timeout_data);
+    Serial.print(" frame=");
+    Serial.print(dht_stats.frame_errors);
+    Serial.print(" checksum=");
+    Serial.print(dht_stats.checksum_errors);
+    Serial.print(" retries=");
+    Serial.print(dht_stats.retries);
+    Serial.print(" give ups=");
+    Serial.println(dht_stats.give_ups);
+}
+
 float Dht11GetTemperature(void)
 {
     return temperature;
@@ -236,7 +466,7 @@ float Dht11GetTemperature(void)
 
 uint16_t Dht11GetEncodedTemperature(void)
 {
-    return (temperature+200)*100;
+    return SensorEncode(temperature);
 }
 
 float Dht11GetHumidity(void)
@@ -1,54 +1,240 @@
+/**
+ * \file mcu_temperature_access.cpp
+ */
+
+/**
+ *  \defgroup temperature_access_module MCU temperature
+ *
+ *  \brief Calibrated MCU internal temperature, from the ADC sampler
+ *
+ *  The internal sensor is sampled by the ADC sampler, which owns the
+ *  switch to the 1.1V reference; this module only filters the samples,
+ *  once a second from the very slow time task, and converts them with a
+ *  two point calibration:
+ *
+ *      T = T_low + (raw - raw_low) * (T_high - T_low) / (raw_high - raw_low)
+ *
+ *  in integer arithmetic, with the readings in ADC codes with
+ *  MCU_RAW_FRAC_BITS fractional bits and the temperatures in
+ *  centi-degrees. The two points live in EEPROM, with a checksum; with no
+ *  valid record the datasheet typical values are used (about 1.22 LSB/C,
+ *  324 LSB at 0C - several degrees off on a given part).
+ *
+ *  The result goes to the sensor cache (SENSOR_MCU_TEMPERATURE) and stays
+ *  readable from GetMcuCentiTemperature(): being the temperature of the
+ *  board itself, it is the input for the self-heating compensation of the
+ *  ambient sensors mounted on it.
+ *
+ *  @{
+ */
 #include <Arduino.h>
+#include <avr/eeprom.h>
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <stdio.h>
 
+#include "tasks.h"
 #include "mcu_temperature_access.h"
+#include "adc_sampler.h"
+#include "adc_filter.h"
+#include "sensor_cache.h"
+#include "eeprom_map.h"
+
+/** Calibration record validity marker */
+#define MCU_CALIBRATION_MAGIC 0x4D43U
+/** Smallest calibration span, in raw units - 16 LSB, about 13C */
+#define MCU_CALIBRATION_MIN_SPAN (16U << MCU_RAW_FRAC_BITS)
+
+/** Median of 3, 4 samples (one sampler burst) decimated to 11 bits, EMA 1/8 */
+typedef AdcFilterConfig<3, 1, 3> McuFilterConfig;
+
+static_assert(McuFilterConfig::OVERSAMPLE_BITS <= MCU_RAW_FRAC_BITS, "raw reading keeps MCU_RAW_FRAC_BITS");
+static_assert(sizeof(MCU_TEMP_CALIBRATION_t) <= EEPROM_MCU_CALIBRATION_SIZE, "calibration must fit its EEPROM area");
 
-static float volatile temp;
+/** Datasheet typical values: 324.31 LSB at 0C, 1.22 LSB/C */
+static const MCU_TEMP_CALIBRATION_t default_calibration =
+{
+    MCU_CALIBRATION_MAGIC,
+    5189U,  0,      // 324.31 << 4, 0.00C
+    7141U,  10000,  // 446.31 << 4, 100.00C
+    0U
+};
+
+static MCU_TEMP_CALIBRATION_t calibration;
+static AdcFilter<McuFilterConfig> mcu_filter;
+/** Last filtered reading, MCU_RAW_FRAC_BITS fractional bits */
+static uint16_t raw_reading;
+/** Last temperature, in centi-degrees */
+static int16_t centi_temperature;
 
-int8_t TemperatureAccessSetup(void){}
+static void mcuTemperaturePowerOn(void);
+static void mcuTemperatureUpdate(void);
+static uint8_t calibrationChecksum(const MCU_TEMP_CALIBRATION_t *record);
+static bool calibrationValid(const MCU_TEMP_CALIBRATION_t *record);
 
-/** @brief Function for main application entry.
+/**
+ * Module's tasks runner
  */
-float GetMcuInternalTemperature(void)
+void MCU_TEMPERATURE_run(TASKS_t running_task)
 {
-    // Set the reference voltage to the internal 1.1V reference (REFS1 | REFS0)
-  // and select the temperature sensor channel (MUX3)
-  ADMUX = _BV(REFS1) | _BV(REFS0) | _BV(MUX3);
-  
-  // Wait for the voltage reference to stabilize (typically requires a delay, 
-  // but a "dummy" read often suffices as the first reading is discarded).
-  delay(20); 
+    switch(running_task)
+    {
+    case POWERON_TASK:
+        mcuTemperaturePowerOn();
+        break;
+    case VERY_SLOW_TIME_TASK:
+        mcuTemperatureUpdate();
+        break;
+    default:
+        /* Log internal error */
+        // INTERRLOG("tried to run an unsupported task");
+        break;
+    }
+}
 
-  ADCSRA |= _BV(ADEN); // Enable the ADC
-  ADCSRA |= _BV(ADSC); // Start the first conversion (dummy read)
-  while (ADCSRA & _BV(ADSC)); // Wait for it to complete
+/**
+ * \brief Loads the calibration from EEPROM
+ *
+ * @return 0 if the EEPROM holds a valid calibration, -1 if the defaults are used
+ */
+int8_t TemperatureAccessSetup(void)
+{
+    eeprom_read_block(&calibration, (const void *)EEPROM_MCU_CALIBRATION_ADDR, sizeof(calibration));
+    if (calibrationValid(&calibration))
+    {
+        return 0;
+    }
+    calibration = default_calibration;
+    return -1;
+}
 
-  ADCSRA |= _BV(ADSC); // Start the actual conversion
-  while (ADCSRA & _BV(ADSC)); // Wait for it to complete
+/**
+ * \brief Stores a new two point calibration in EEPROM and applies it
+ *
+ * The readings are taken with GetMcuRawReading() while the board is held
+ *   at each reference temperature.
+ *
+ * @param [in] raw_low, centi_low - reading and temperature of the low point
+ * @param [in] raw_high, centi_high - reading and temperature of the high point
+ * @return 0 on success, -1 if the points are too close or out of order
+ */
+int8_t McuTemperatureCalibrate(uint16_t raw_low, int16_t centi_low, uint16_t raw_high, int16_t centi_high)
+{
+    MCU_TEMP_CALIBRATION_t record;
 
-  // Read the 10-bit result (ADCL must be read first, then ADCH)
-  long rawTemp = ADCW; 
+    record.magic = MCU_CALIBRATION_MAGIC;
+    record.raw_low = raw_low;
+    record.centi_low = centi_low;
+    record.raw_high = raw_high;
+    record.centi_high = centi_high;
+    record.checksum = calibrationChecksum(&record);
+    if (!calibrationValid(&record))
+    {
+        return -1;
+    }
 
-  // Conversion formula from the datasheet (varies slightly by calibration, 
-  // but this is a common starting point). The measured voltage has a linear 
-  // relationship to temperature.
-  long temperatureC = (rawTemp - 324.31) / 1.22;
+    eeprom_update_block(&record, (void *)EEPROM_MCU_CALIBRATION_ADDR, sizeof(record));
+    calibration = record;
+    return 0;
+}
 
-  return temperatureC;
+/**
+ * \brief Gets the last temperature - never blocks, no conversion started
+ */
+float GetMcuInternalTemperature(void)
+{
+    return centi_temperature * 0.01f;
 }
 
 float GetInternalTemperature(void)
 {
-    return temp;
+    return centi_temperature * 0.01f;
+}
+
+/**
+ * \brief Gets the last temperature, in centi-degrees
+ */
+int16_t GetMcuCentiTemperature(void)
+{
+    return centi_temperature;
+}
+
+/**
+ * \brief Gets the last filtered reading, ADC code with MCU_RAW_FRAC_BITS fractional bits
+ */
+uint16_t GetMcuRawReading(void)
+{
+    return raw_reading;
 }
 
 uint16_t GetEncodedInternalTemperature(void)
 {
-    return (temp+200)*100;
+    return (uint16_t)(centi_temperature + SENSOR_ENCODING_OFFSET);
+}
+
+static void mcuTemperaturePowerOn(void)
+{
+    if (TemperatureAccessSetup() < 0)
+    {
+        Serial.println("[MCU_TEMP] no calibration, datasheet values");
+    }
+}
+
+/**
+ * \brief Filters the new sensor samples and converts them
+ *
+ * With no new sample the sensor cache is left alone, so the value ages.
+ */
+static void mcuTemperatureUpdate(void)
+{
+    uint16_t samples[ADC_RING_SIZE];
+    uint8_t n = AdcSamplerRead(ADC_CHANNEL_MCU_TEMPERATURE, samples, ADC_RING_SIZE);
+    bool updated = false;
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        updated |= mcu_filter.push(samples[i]);
+    }
+    if (!updated)
+    {
+        return;
+    }
+
+    raw_reading = (uint16_t)(mcu_filter.value() << (MCU_RAW_FRAC_BITS - McuFilterConfig::OVERSAMPLE_BITS));
+
+    /* Rounded to the nearest centi-degree; |product| < 2^30 */
+    int32_t span = (int32_t)calibration.raw_high - calibration.raw_low;
+    int32_t product = ((int32_t)raw_reading - calibration.raw_low) *
+                      ((int32_t)calibration.centi_high - calibration.centi_low);
+    int32_t centi = calibration.centi_low + ((product >= 0) ? (product + span / 2) : (product - span / 2)) / span;
+
+    centi_temperature = (int16_t)((centi > INT16_MAX) ? INT16_MAX : ((centi < INT16_MIN) ? INT16_MIN : centi));
+    SensorCacheUpdate(SENSOR_MCU_TEMPERATURE, centi_temperature * 0.01f);
 }
 
+static uint8_t calibrationChecksum(const MCU_TEMP_CALIBRATION_t *record)
+{
+    const uint8_t *bytes = (const uint8_t *)record;
+    uint8_t sum = 0;
 
-/** @} */
+    for (uint8_t i = 0; i < offsetof(MCU_TEMP_CALIBRATION_t, checksum); i++)
+    {
+        sum += bytes[i];
+    }
+    /* Inverted, so an erased (all 0xFF) or zeroed area does not pass */
+    return (uint8_t)~sum;
+}
+
+static bool calibrationValid(const MCU_TEMP_CALIBRATION_t *record)
+{
+    return (MCU_CALIBRATION_MAGIC == record->magic) &&
+           (calibrationChecksum(record) == record->checksum) &&
+           (record->raw_high >= record->raw_low + MCU_CALIBRATION_MIN_SPAN) &&
+           (record->centi_high > record->centi_low);
+}
+
+/**  @}
+ * End of temperature_access_module group definition
+ */
@@ -15,59 +15,80 @@
 #include <math.h>
 #include "tasks.h"
 #include "ntc_temperature.h"
+#include "ntc_table.h"
 #include "timer.h"
+#include "sensor_cache.h"
+#include "adc_sampler.h"
+#include "adc_filter.h"
+#include "fsm.h"
 //#include "lininterp.h"
 //#include "system.h"
 //#include "fsm_manager.h"
 
 #define TEMP_GPIO (0U)
 
+/** Thermistor fitted on TEMP_GPIO - selects the conversion table */
+typedef Ntc10kB3950 NtcThermistor;
+/** Median of 3 against spikes, 16 samples decimated to 12 bits, EMA 1/4 across measurements */
+typedef AdcFilterConfig<3, 2, 2> NtcFilterConfig;
+
+static_assert(NtcFilterConfig::OVERSAMPLE_BITS <= NTC_CODE_FRAC_BITS, "table input keeps NTC_CODE_FRAC_BITS");
+static_assert(NtcFilterConfig::SAMPLES_PER_OUTPUT <= UINT8_MAX, "sample counter is 8 bit");
+
+/** Longest measurement, in ms: 16 samples at 5ms, plus a reference switch of the ADC */
+#define NTC_MEASUREMENT_TIMEOUT 250U
+
 /**********************/
 /* Module global data */
 /**********************/
-CELLTEMP_STATUS_t cell_temp_fsm;
-static void cellTempSetState(CELLTEMP_STATE_t new_state);
-static void cellTempFastTime(void);
+static void ntcIdleEntry(void);
+static CELLTEMP_STATE_t ntcIdleRun(void);
+static void ntcMeasurementEntry(void);
+static CELLTEMP_STATE_t ntcMeasurementRun(void);
+static void ntcFaultEntry(void);
+static CELLTEMP_STATE_t ntcFaultRun(void);
 
 static bool cli_request = false;
 
-static float calculated_temperature;
 static float interpolated_temperature;
-static const uint64_t SENSOR_TIMEOUT = 5000;
+/** Last conversion, in centi-degrees Celsius */
+static int16_t centi_temperature;
+static const uint32_t SENSOR_TIMEOUT = 5000;
 
 static void temperaturePowerOn(void);
 static uint8_t measureTemperature(void);
 
-// é multiplicado por 10
-// entao em 25º é 10K
-// este termistor trabalha na faixa de 213K ate 470 ohms
-static float temp_table[17] = { 80, 75, 70,  65,  60,  55,  50,  45, 40, 
-                                35, 30, 25, 20, 15,  10,  5,   0               
-                              };
-
-static float m_table[17] =      {1.673, // 80
-                                 1.929, // 75
-                                 2.232, // 70
-                                 2.593, // 65
-                                 3.023, // 60
-                                 3.539, // 55
-                                 4.161, // 50
-                                 4.912, // 45
-                                 5.825, // 40
-                                 6.940, // 35
-                                 8.310, // 30
-                                 10.000, // 25
-                                 12.099, // 20
-                                 14.720, // 15
-                                 18.015, // 10
-                                 22.184, // 5
-                                 27.494  // 0
-                                };
-
-static const uint8_t    SAMPLE_N = 30;
-static uint32_t         sum_adc = 0;
+/** Samples per measurement - one filter output */
+static const uint8_t    SAMPLE_N = NtcFilterConfig::SAMPLES_PER_OUTPUT;
 static uint8_t          adc_counter = 0;
-static uint16_t         adc_sample;
+static uint16_t         adc_samples[ADC_RING_SIZE];
+static AdcFilter<NtcFilterConfig> ntc_filter;
+
+/** States: entry action, state action, guard timeout */
+static constexpr FsmStateConfig<CELLTEMP_STATE_t> ntc_states[] =
+{
+    { CELLTEMP_IDLE,        &ntcIdleEntry,        &ntcIdleRun,        0U,                      CELLTEMP_IDLE  },
+    { CELLTEMP_MEASUREMENT, &ntcMeasurementEntry, &ntcMeasurementRun, NTC_MEASUREMENT_TIMEOUT, CELLTEMP_FAULT },
+    { CELLTEMP_FAULT,       &ntcFaultEntry,       &ntcFaultRun,       0U,                      CELLTEMP_IDLE  },
+};
+
+/** Allowed transitions */
+static constexpr FsmTransition<CELLTEMP_STATE_t> ntc_transitions[] =
+{
+    { CELLTEMP_IDLE,        CELLTEMP_MEASUREMENT },
+    { CELLTEMP_MEASUREMENT, CELLTEMP_IDLE        },
+    { CELLTEMP_MEASUREMENT, CELLTEMP_FAULT       },
+    { CELLTEMP_FAULT,       CELLTEMP_IDLE        },
+};
+
+static_assert(sizeof(ntc_states) / sizeof(ntc_states[0]) == CELLTEMP_STATE_COUNT, "one entry per state");
+static_assert(FsmStatesIndexed(ntc_states, CELLTEMP_STATE_COUNT), "state table must be in state order");
+static_assert(FsmTimeoutsAllowed(ntc_states, CELLTEMP_STATE_COUNT, ntc_transitions,
+                                 sizeof(ntc_transitions) / sizeof(ntc_transitions[0])),
+              "timeouts must lead to allowed transitions");
+
+static Fsm<CELLTEMP_STATE_t, CELLTEMP_STATE_COUNT, sizeof(ntc_transitions) / sizeof(ntc_transitions[0])>
+    ntc_fsm("NTC", ntc_states, ntc_transitions, CELLTEMP_IDLE);
 
 /**
  * Module's tasks runner
@@ -82,7 +103,7 @@ void NTC_TEMPERATURE_run(TASKS_t running_task)
         temperaturePowerOn();
         break;
     case FAST_TIME_TASK:
-        cellTempFastTime();
+        ntc_fsm.run();
         break;
     case VERY_SLOW_TIME_TASK:
         ret_code = measureTemperature();
@@ -99,165 +120,96 @@ void NTC_TEMPERATURE_run(TASKS_t running_task)
     }
 }
 
-static void cellTempSetState(CELLTEMP_STATE_t new_state)
+static void ntcIdleEntry(void)
 {
-    if (new_state == cell_temp_fsm.state)
+    AdcSamplerEnable(ADC_CHANNEL_NTC, false);
+    if(cli_request)
     {
-        return;
+        cli_request = false;
+        Serial.print("  [NTC_TEMPERATURE]");
+        Serial.print(interpolated_temperature);
+        Serial.println("graus C");
     }
+}
 
-    // Caso do ultimo estado
-    if (cell_temp_fsm.state == CELLTEMP_END)
-    {
-            if(new_state != CELLTEMP_IDLE)
-            {
-                // Soh vai pra IDLE se estiver em END_STATE
-                return;
-            }
-    } else if (cell_temp_fsm.state == CELLTEMP_CHEK_SETUP)
+static CELLTEMP_STATE_t ntcIdleRun(void)
+{
+    return cli_request ? CELLTEMP_MEASUREMENT : CELLTEMP_IDLE;
+}
+
+static void ntcMeasurementEntry(void)
+{
+    // Amostras do NTC so a partir daqui
+    AdcSamplerEnable(ADC_CHANNEL_NTC, true);
+    adc_counter = 0;
+    /* A measurement cut by a timeout leaves a partial sum - one output per measurement */
+    ntc_filter.restart();
+}
+
+static CELLTEMP_STATE_t ntcMeasurementRun(void)
+{
+    // Le o sensor algumas vezes - amostras do amostrador do ADC
+    uint8_t wanted = SAMPLE_N - adc_counter;
+    uint8_t n = AdcSamplerRead(ADC_CHANNEL_NTC, adc_samples,
+                               (wanted < ADC_RING_SIZE) ? wanted : ADC_RING_SIZE);
+    for (uint8_t i = 0; i < n; i++)
     {
-        if (new_state == CELLTEMP_MEASUREMENT ||
-            new_state == CELLTEMP_END ||
-            new_state == CELLTEMP_READ_SETUP)
-        {
-            new_state = CELLTEMP_IDLE;
-            Serial.println("[CELLTEMP_FSM] Invalid transition from CHECK state");
-        }
+        ntc_filter.push(adc_samples[i]);
     }
-    // Demais estados
-    else if (new_state != (cell_temp_fsm.state + 1))
+    adc_counter += n;
+    if (adc_counter < SAMPLE_N)
     {
-        // Demais transicoes devem ser sempre pra frente
-        // Transicao invalida
-        //  0         1          2          3               4               5          6
-        // IDLE -> SETUP -> READ_SETUP -> CHECK_SETUP -> START_MEAS -> MEASUREMENT -> END
-        Serial.println("[TEMP_FSM][ERRO] Transicao invalida de estado\n");
-        return;
+        return CELLTEMP_MEASUREMENT;
     }
 
-    /* State change and store transition time stamp */
-    cell_temp_fsm.state = new_state;
-    cell_temp_fsm.transition_time = GetSystemTime();
-
-    /* State specific entry actions */
-    switch(cell_temp_fsm.state)
+    uint16_t decimated = ntc_filter.decimated();
+    if ((0U == decimated) || (decimated >= (NTC_ADC_MAX << NtcFilterConfig::OVERSAMPLE_BITS)))
     {
-    case CELLTEMP_IDLE:
-        if(cli_request)
-        {
-            cli_request = false;
-            Serial.print("  [NTC_TEMPERATURE]");
-            Serial.print(interpolated_temperature);
-            Serial.println("graus C");
-        }
-        break;
-    case CELLTEMP_SETUP:
-        break;
-
-    case CELLTEMP_READ_SETUP:
-        break;
-    
-    case CELLTEMP_CHEK_SETUP:
-        
-        break;
-
-    case CELLTEMP_START_MEASUREMENT:
-        break;
-
-    case CELLTEMP_MEASUREMENT:
-        break;
-     case CELLTEMP_END:
-        adc_counter = 0;
-        sum_adc = 0;
-        break;
-     default:
-         /* Log internal error */
-         Serial.println("tried to process an unknown driver state");
-         break;
+        /* Open or shorted thermistor - keep the fault out of the average */
+        ntc_filter.reset();
+        SensorCacheReportError(SENSOR_NTC_TEMPERATURE, SENSOR_ERR_RANGE);
     }
+    else
+    {
+        interpolated_temperature = MeasureExtTmp();
+        SensorCacheUpdate(SENSOR_NTC_TEMPERATURE, interpolated_temperature);
+    }
+    return CELLTEMP_IDLE;
 }
 
-static void cellTempFastTime(void)
+/** The samples did not come in time - the ADC sampler is stuck or starved */
+static void ntcFaultEntry(void)
 {
-    uint16_t spi_timeout = 150;
-
-    switch(cell_temp_fsm.state)
-    {
-        case CELLTEMP_IDLE:
-        if(cli_request)
-        {
-            measureTemperature();
-        }
-        break;
-        
-        case CELLTEMP_SETUP:
-        //if(TestTimerExpired(cell_temp_fsm.transition_time, 10))
-        //{
-            cellTempSetState(CELLTEMP_READ_SETUP);
-        //}
-        break;
-
-        case CELLTEMP_READ_SETUP:
-        //if(TestTimerExpired(cell_temp_fsm.transition_time, 10))
-        //{
-            cellTempSetState(CELLTEMP_CHEK_SETUP);
-        //}
-        break;
-
-        case CELLTEMP_CHEK_SETUP:
-        cellTempSetState(CELLTEMP_START_MEASUREMENT);
-        
-        break;
-
-        case CELLTEMP_START_MEASUREMENT:
-        //if(TestTimerExpired(cell_temp_fsm.transition_time, 20))
-        //{
-            cellTempSetState(CELLTEMP_MEASUREMENT);
-        //}
-        break;
+    SensorCacheReportError(SENSOR_NTC_TEMPERATURE, SENSOR_ERR_TIMEOUT);
+}
 
-        case CELLTEMP_MEASUREMENT:
-            // Le o sensor algumas vezes
-            if (adc_counter < SAMPLE_N)
-            {
-                adc_sample = analogRead(TEMP_GPIO);
-                sum_adc += adc_sample;
-                adc_counter++;
-            } else
-            {
-                interpolated_temperature = MeasureExtTmp();
-                cellTempSetState(CELLTEMP_END);
-            }
-            break;
-        case CELLTEMP_END:
-            cellTempSetState(CELLTEMP_IDLE);
-            break;
-    }
+static CELLTEMP_STATE_t ntcFaultRun(void)
+{
+    return CELLTEMP_IDLE;
 }
 
 CELLTEMP_STATE_t GetCellTempState(void)
 {
-    return cell_temp_fsm.state;
+    return ntc_fsm.state();
 }
 
 static void temperaturePowerOn(void) {
     Serial.print("Entrada de temperatura instanciada na porta ");
     Serial.println(TEMP_GPIO);
-    cell_temp_fsm.state = CELLTEMP_IDLE;
+    ntc_fsm.start(CELLTEMP_IDLE);
 }
 
 static uint8_t measureTemperature(void)
 {
     // FsmGetTicket(FSM_TEMPERATURE);
-    cellTempSetState(CELLTEMP_SETUP);
+    ntc_fsm.setState(CELLTEMP_MEASUREMENT);
 
     return 0;
 }
 
 void SetupCellTemperature(void)
 {
-    cellTempSetState(CELLTEMP_SETUP);
-    cell_temp_fsm.setup_count = 0;
+    ntc_fsm.setState(CELLTEMP_MEASUREMENT);
 }
 
 float GetTemperature(void)
@@ -267,76 +219,102 @@ float GetTemperature(void)
 
 uint16_t GetEncodedTemperature(void)
 {
-    return (interpolated_temperature+200)*100;
+    return (uint16_t)(centi_temperature + SENSOR_ENCODING_OFFSET);
 }
 
-float MeasureExtTmp(void)
+int16_t GetCentiTemperature(void)
 {
+    return centi_temperature;
+}
 
-    float volt_adc_equivalent;
-
-    //#ifdef CALCULATED_TEMPERATURE
-    const uint16_t  b_value = 3950.0; //3435;
-    const uint16_t  resistor = 10000;
-    const float     t0 = 25.0; //273.0 + 25.0;
-    const float     rx = 10000; //resistor * exp(-b_value/t0);
-    //#endif
-
-    // Determina a resistência do termistor
-    // volt_adc_equivalent = (sum_adc*3.6) / (SAMPLE_N*16384);
-    volt_adc_equivalent = (sum_adc*5.0) / (SAMPLE_N*1023.0);
-    float mean_adc = sum_adc / SAMPLE_N;
-
-    // Serial.print("Tensao lida no adc para temperatura = ");
-    // Serial.println(volt_adc_equivalent);
-
-    //#ifdef CALCULATED_TEMPERATURE
-    // Fórmula simplificada utilizando apenas 1 resistor
-    float simplified_rt = resistor * (1023.0 / mean_adc - 1.0);
-
-    // equacao beta
-    float temp = simplified_rt / resistor;
-    temp = log(temp);
-    temp /= b_value;
-    temp += 1.0/ (t0 + 273.15);
-    temp = 1 / temp;
-    temp -= 273.15;
-
-    // float resultado_do_log = ( b_value / log(simplified_rt/rx) );
-    // Serial.print("Resultado do log: ");
-    // Serial.println(resultado_do_log);
-     calculated_temperature =  temp;//resultado_do_log - 273;
-    // Serial.print("Temperatura calculada   = %.2f graus C\n", calculated_temperature);
-    //#endif
-
+/**
+ * \brief Converts the filtered NTC reading to temperature
+ *
+ * The filter output carries OVERSAMPLE_BITS fractional bits, scaled up to
+ *   the NTC_CODE_FRAC_BITS of the table input, and is interpolated on the
+ *   thermistor's flash table - no float, no log().
+ */
+float MeasureExtTmp(void)
+{
+    uint16_t code = (uint16_t)(ntc_filter.value() << (NTC_CODE_FRAC_BITS - NtcFilterConfig::OVERSAMPLE_BITS));
 
-    if(volt_adc_equivalent == 0)
+    if(0U == code)
     {
         Serial.println("  [MEASURE_EXT_TMP][ERROR] LEU ZERO DO ADC");
     }
 
-    // Determina a resistência do termistor
+    centi_temperature = NtcCodeToCentiDegrees<NtcThermistor>(code);
+    return centi_temperature * 0.01f;
+}
 
-   // float rt = ( (gopamp * VDD * R1) / divisor) - R1 - 2;
+void CliTempTest(void)
+{
+    cli_request = true;
+}
 
-    float rt = (((3*6.8)/volt_adc_equivalent)-6.8);
+#if defined(BENCHMARK) && !defined(NATIVE_BUILD)
+/** Conversions per benchmark measurement - the float path must fit in 65535 cycles */
+#define BENCH_ITERATIONS 8U
 
+/** Conversion results, keeps the compiler from dropping the measured calls */
+static volatile float bench_sink;
+/** Benchmark input - ADC code with NTC_CODE_FRAC_BITS fractional bits, volatile so
+ *  the conversions are not folded at compile time */
+static volatile uint16_t bench_code;
 
-    // Calcula a temperatura
-    float table_input = rt;
+/** Previous conversion: beta equation in float, one log() per call */
+static __attribute__((noinline)) float benchBetaEquation(uint16_t code)
+{
+    float mean_adc = code / (float)(1U << NTC_CODE_FRAC_BITS);
+    float temp = (1023.0 / mean_adc - 1.0);
+    temp = log(temp);
+    temp /= 3950.0;
+    temp += 1.0 / (25.0 + 273.15);
+    temp = 1 / temp;
+    return temp - 273.15;
+}
 
-    //#ifdef CALCULATED_TEMPERATURE
-    return calculated_temperature;
-    //#else
-    //INDEX_RATIO_t i_ratio = index_ratio(table_input, m_table, 17);
-    //return interp_1d(i_ratio, temp_table, 17);
-    //#endif
+static __attribute__((noinline)) float benchTable(uint16_t code)
+{
+    return NtcCodeToCentiDegrees<NtcThermistor>(code) * 0.01f;
 }
 
-void CliTempTest(void)
+/**
+ * \brief Measures the cycles of a conversion, float beta equation against the flash table
+ *
+ * The table size is its flash cost; the code size difference between the
+ *   two paths shows up in the build size report.
+ */
+void NtcBenchmark(void)
 {
-    cli_request = true;
+    uint16_t start;
+    uint16_t overhead;
+    uint16_t cycles[2];
+
+    SetupCycleCounter();
+    bench_code = 400U << NTC_CODE_FRAC_BITS;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = bench_code; }
+    overhead = GetCycleCount() - start;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = benchBetaEquation(bench_code); }
+    cycles[0] = GetCycleCount() - start - overhead;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = benchTable(bench_code); }
+    cycles[1] = GetCycleCount() - start - overhead;
+
+    Serial.print("[BENCH] NTC beta/tabela: ");
+    Serial.print(cycles[0] / BENCH_ITERATIONS);
+    Serial.print("/");
+    Serial.print(cycles[1] / BENCH_ITERATIONS);
+    Serial.print(" ciclos, tabela: ");
+    Serial.print((uint16_t)sizeof(NtcTable<NtcThermistor>::values));
+    Serial.println(" bytes de flash");
 }
+#endif
 
 /**  @}
  * End of bat_temperature_module group definition
@@ -0,0 +1,395 @@
+/**
+ * \file adc_sampler.cpp
+ */
+
+/**
+ *  \defgroup adc_sampler_module ADC sampler
+ *
+ *  \brief Interrupt driven ADC conversions, on a channel schedule, into per channel rings
+ *
+ *  The ADC is owned by this module alone - analogRead() and direct ADMUX
+ *  writes must not be used elsewhere. Channels that need a different
+ *  voltage reference (the NTC divider on AVcc, the internal temperature
+ *  sensor on 1.1V) no longer undo each other's ADMUX setting, and the
+ *  reference switch and its settling time are handled here, once.
+ *
+ *  Each channel has a visit period, a number of samples per visit (burst)
+ *  and a number of conversions to throw away on entry. The fast time task
+ *  marks the enabled channels that are due and, when the ADC is idle,
+ *  starts the first one; from there the ADC conversion complete interrupt
+ *  stores each result and starts the next conversion, walking the due
+ *  channels in ADC_CHANNEL_t order - channels on the same reference are
+ *  kept next to each other, so a round switches reference at most twice.
+ *
+ *  When the next channel is on another reference, the chain stops: the
+ *  fast time task resumes it once the reference had its settling time -
+ *  the AREF pin capacitor must discharge from AVcc down to 1.1V - so no
+ *  conversion time is spent on throw-away readings.
+ *
+ *  Results go to a ring of the last ADC_RING_SIZE samples per channel. A
+ *  full ring drops its oldest sample, so a consumer always finds the most
+ *  recent ones; the drops are counted.
+ *
+ *  @{
+ */
+#include <Arduino.h>
+#include <util/atomic.h>
+#ifndef NATIVE_BUILD
+#include <avr/interrupt.h>
+#endif
+
+#include "tasks.h"
+#include "timer.h"
+#include "adc_sampler.h"
+
+/** ADMUX reference selection */
+#define ADC_REF_AVCC    (_BV(REFS0))
+#define ADC_REF_1V1     (_BV(REFS1) | _BV(REFS0))
+#define ADC_REF_MASK    (_BV(REFS1) | _BV(REFS0))
+/** No reference selected yet - the first channel always waits its settling time */
+#define ADC_REF_NONE    0xFFU
+/** ADMUX input selection of the internal temperature sensor */
+#define ADC_MUX_TEMPERATURE (_BV(MUX3))
+/** ADC enabled, conversion complete interrupt, 125kHz ADC clock (16MHz / 128) */
+#define ADC_CONTROL     (_BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0))
+
+/** Channels sampled from power on - the others are enabled by their consumers */
+#define ADC_DEFAULT_CHANNELS (_BV(ADC_CHANNEL_MCU_TEMPERATURE))
+
+/**
+ * \brief Channel schedule entry
+ */
+typedef struct AdcChannelConfig
+{
+    uint8_t  admux;     //!< ADMUX value: reference and input
+    uint8_t  discard;   //!< Conversions thrown away when the channel is entered
+    uint8_t  burst;     //!< Samples stored per visit
+    uint8_t  settle;    //!< Wait after switching to the channel's reference, in ms
+    uint16_t period;    //!< Visit period, in ms
+} ADC_CHANNEL_CONFIG_t;
+
+/** Channel schedule, indexed by ADC_CHANNEL_t */
+static const ADC_CHANNEL_CONFIG_t adc_channels[] =
+{
+    /* NTC: one sample every fast task run */
+    { ADC_REF_AVCC | 0U,               0U, 1U,  2U,    5U },
+    /* Microphone: short bursts, envelope detection */
+    { ADC_REF_AVCC | 1U,               0U, 8U,  2U,    5U },
+    /* Temperature sensor: the first conversion after selecting it reads high */
+    { ADC_REF_1V1 | ADC_MUX_TEMPERATURE, 1U, 4U, 20U, 1000U },
+};
+
+static_assert(sizeof(adc_channels) / sizeof(adc_channels[0]) == ADC_CHANNEL_COUNT,
+              "one schedule entry per channel");
+static_assert((ADC_RING_SIZE & (ADC_RING_SIZE - 1U)) == 0U, "ring size must be a power of two");
+
+/**
+ * \brief Sampler state
+ */
+typedef enum AdcState
+{
+    ADC_IDLE,       //!< No conversion running - waiting for due channels
+    ADC_CONVERTING, //!< Conversion chain running from the interrupt
+    ADC_SETTLING    //!< Reference just switched - waiting its settling time
+} ADC_STATE_t;
+
+/**
+ * \brief Last samples of a channel
+ */
+typedef struct AdcRing
+{
+    uint16_t samples[ADC_RING_SIZE];
+    uint8_t  first;     //!< Index of the oldest sample
+    uint8_t  count;     //!< Samples held
+} ADC_RING_t;
+
+static ADC_RING_t adc_rings[ADC_CHANNEL_COUNT];
+static ADC_STATS_t adc_stats;
+
+/** Sampler state, written by the interrupt */
+static volatile uint8_t adc_state = ADC_IDLE;
+/** Due channels not visited yet, one bit per channel */
+static volatile uint8_t adc_pending;
+/** Channel being converted */
+static uint8_t adc_channel;
+/** Conversions left to throw away, and samples left to store, in the current visit */
+static uint8_t adc_discard;
+static uint8_t adc_remaining;
+/** Reference selected in ADMUX */
+static uint8_t adc_reference = ADC_REF_NONE;
+/** System time of the last reference switch */
+static uint32_t settle_start;
+
+/** Enabled channels, one bit per channel - task context only */
+static uint8_t adc_enabled;
+/** System time of each channel's last visit */
+static uint32_t last_visit[ADC_CHANNEL_COUNT];
+
+static void adcSamplerPowerOn(void);
+static void adcSamplerFastTime(void);
+static void adcStartNext(void);
+static void adcConversionComplete(void);
+
+/**
+ * Module's tasks runner
+ */
+void ADC_SAMPLER_run(TASKS_t running_task)
+{
+    switch(running_task)
+    {
+    case POWERON_TASK:
+        adcSamplerPowerOn();
+        break;
+    case FAST_TIME_TASK:
+        adcSamplerFastTime();
+        break;
+    default:
+        /* Log internal error */
+        // INTERRLOG("tried to run an unsupported task");
+        break;
+    }
+}
+
+/**
+ * \brief Starts or stops sampling a channel
+ *
+ * Enabling a channel empties its ring and makes it due at once, so the
+ *   samples read afterwards are all newer than the call.
+ *
+ * @param [in] channel - channel
+ * @param [in] enable - true to sample the channel
+ */
+void AdcSamplerEnable(ADC_CHANNEL_t channel, bool enable)
+{
+    if (channel >= ADC_CHANNEL_COUNT)
+    {
+        return;
+    }
+
+    uint8_t bit = (uint8_t)_BV(channel);
+    if (enable)
+    {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            adc_rings[channel].count = 0;
+        }
+        last_visit[channel] = GetSystemTime() - adc_channels[channel].period;
+        adc_enabled |= bit;
+    }
+    else
+    {
+        adc_enabled &= (uint8_t)~bit;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            adc_pending &= (uint8_t)~bit;
+        }
+    }
+}
+
+/**
+ * \brief Gets the number of samples held for a channel
+ */
+uint8_t AdcSamplerAvailable(ADC_CHANNEL_t channel)
+{
+    return (channel < ADC_CHANNEL_COUNT) ? adc_rings[channel].count : 0U;
+}
+
+/**
+ * \brief Takes the oldest samples of a channel out of its ring
+ *
+ * @param [in] channel - channel
+ * @param [out] samples - samples, oldest first
+ * @param [in] max_samples - room in 'samples'
+ * @return number of samples copied
+ */
+uint8_t AdcSamplerRead(ADC_CHANNEL_t channel, uint16_t *samples, uint8_t max_samples)
+{
+    uint8_t n = 0;
+
+    if (channel >= ADC_CHANNEL_COUNT)
+    {
+        return 0;
+    }
+
+    ADC_RING_t *ring = &adc_rings[channel];
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        while ((n < max_samples) && (ring->count > 0U))
+        {
+            samples[n++] = ring->samples[ring->first];
+            ring->first = (uint8_t)((ring->first + 1U) & (ADC_RING_SIZE - 1U));
+            ring->count--;
+        }
+    }
+    return n;
+}
+
+/**
+ * \brief Gets a snapshot of the sampler counters
+ */
+void AdcSamplerGetStats(ADC_STATS_t *stats)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        *stats = adc_stats;
+    }
+}
+
+/**
+ * \brief Prints the sampler counters
+ */
+void AdcSamplerReportStats(void)
+{
+    ADC_STATS_t stats;
+    AdcSamplerGetStats(&stats);
+
+    Serial.print("[ADC] samples ntc/mic/mcu=");
+    Serial.print(stats.samples[ADC_CHANNEL_NTC]);
+    Serial.print("/");
+    Serial.print(stats.samples[ADC_CHANNEL_MIC]);
+    Serial.print("/");
+    Serial.print(stats.samples[ADC_CHANNEL_MCU_TEMPERATURE]);
+    Serial.print(" overwritten=");
+    Serial.print(stats.overwritten[ADC_CHANNEL_NTC]);
+    Serial.print("/");
+    Serial.print(stats.overwritten[ADC_CHANNEL_MIC]);
+    Serial.print("/");
+    Serial.print(stats.overwritten[ADC_CHANNEL_MCU_TEMPERATURE]);
+    Serial.print(" reference switches=");
+    Serial.println(stats.reference_switches);
+}
+
+static void adcSamplerPowerOn(void)
+{
+#ifdef NATIVE_BUILD
+    HalInstallAdcCallback(&adcConversionComplete);
+#endif
+    uint32_t now = GetSystemTime();
+    for (uint8_t channel = 0; channel < ADC_CHANNEL_COUNT; channel++)
+    {
+        last_visit[channel] = now - adc_channels[channel].period;
+    }
+    adc_enabled = ADC_DEFAULT_CHANNELS;
+    adc_reference = ADC_REF_NONE;
+    adc_state = ADC_IDLE;
+    ADCSRA = ADC_CONTROL;
+}
+
+static void adcSamplerFastTime(void)
+{
+    uint8_t due = 0;
+
+    for (uint8_t channel = 0; channel < ADC_CHANNEL_COUNT; channel++)
+    {
+        if ((adc_enabled & _BV(channel)) && TestTimerExpired(last_visit[channel], adc_channels[channel].period))
+        {
+            last_visit[channel] = GetSystemTime();
+            due |= (uint8_t)_BV(channel);
+        }
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        adc_pending |= due;
+        if (ADC_IDLE == adc_state)
+        {
+            adcStartNext();
+        }
+        else if ((ADC_SETTLING == adc_state) &&
+                 TestTimerExpired(settle_start, adc_channels[adc_channel].settle))
+        {
+            adc_state = ADC_CONVERTING;
+            ADCSRA |= _BV(ADSC);
+        }
+    }
+}
+
+/**
+ * \brief Moves to the next due channel - interrupts disabled
+ */
+static void adcStartNext(void)
+{
+    uint8_t channel = 0;
+
+    while ((channel < ADC_CHANNEL_COUNT) && !(adc_pending & _BV(channel)))
+    {
+        channel++;
+    }
+    if (channel >= ADC_CHANNEL_COUNT)
+    {
+        adc_state = ADC_IDLE;
+        return;
+    }
+
+    const ADC_CHANNEL_CONFIG_t *config = &adc_channels[channel];
+    adc_pending &= (uint8_t)~_BV(channel);
+    adc_channel = channel;
+    adc_discard = config->discard;
+    adc_remaining = config->burst;
+
+    ADMUX = config->admux;
+    if ((config->admux & ADC_REF_MASK) != adc_reference)
+    {
+        /* The chain resumes from the fast time task once the reference settled */
+        adc_reference = (uint8_t)(config->admux & ADC_REF_MASK);
+        adc_stats.reference_switches++;
+        settle_start = GetSystemTime();
+        adc_state = ADC_SETTLING;
+        return;
+    }
+
+    adc_state = ADC_CONVERTING;
+    ADCSRA |= _BV(ADSC);
+}
+
+/**
+ * \brief Stores a conversion result and starts the next conversion - interrupt context
+ */
+static void adcConversionComplete(void)
+{
+    uint16_t sample = ADCW;
+
+    if (adc_discard > 0U)
+    {
+        adc_discard--;
+    }
+    else
+    {
+        ADC_RING_t *ring = &adc_rings[adc_channel];
+        ring->samples[(uint8_t)(ring->first + ring->count) & (ADC_RING_SIZE - 1U)] = sample;
+        if (ring->count < ADC_RING_SIZE)
+        {
+            ring->count++;
+        }
+        else
+        {
+            ring->first = (uint8_t)((ring->first + 1U) & (ADC_RING_SIZE - 1U));
+            adc_stats.overwritten[adc_channel]++;
+        }
+        adc_stats.samples[adc_channel]++;
+        adc_remaining--;
+    }
+
+    if (adc_remaining > 0U)
+    {
+        ADCSRA |= _BV(ADSC);
+    }
+    else
+    {
+        adcStartNext();
+    }
+}
+
+#ifndef NATIVE_BUILD
+/**
+ * \brief ADC conversion complete
+ */
+ISR(ADC_vect)
+{
+    adcConversionComplete();
+}
+#endif
+
+/**  @}
+ * End of adc_sampler_module group definition
+ */
@@ -0,0 +1,415 @@
+/**
+ * \file sample_store.cpp
+ */
+
+/**
+ *  \defgroup sample_store_module Sample store
+ *
+ *  \brief EEPROM store-and-forward ring of readings, wear levelled
+ *
+ *  Readings that cannot be published - link down, or no room left in the
+ *  MQTT window - are kept here until the uplink can forward them, oldest
+ *  first. The ring takes the whole EEPROM_SAMPLE_STORE area, as fixed size
+ *  records:
+ *
+ *  | byte | content                                                    |
+ *  |------|------------------------------------------------------------|
+ *  | 0    | sequence, 1 to 254, +1 per record - 0xFF: never written    |
+ *  | 1    | metric, bit 7 set while the record is not forwarded        |
+ *  | 2-3  | encoded value, as SensorEncode()                          |
+ *  | 4-7  | system time of the reading, in ms                          |
+ *
+ *  Wear levelling comes from the layout itself: records are written in
+ *  ring order and no pointer is ever stored - at power on the write
+ *  position is found where the sequence breaks, and the records not
+ *  forwarded yet are the ones before it with bit 7 set. Each slot is
+ *  written once per lap, plus the forwarded mark, so the EEPROM endurance
+ *  (100k cycles) is spread over all the slots. A full ring overwrites its
+ *  oldest record.
+ *
+ *  Forwarding takes two steps: SampleStoreNext() hands the readings out,
+ *  oldest first, and a reading counts as forwarded - its mark is written -
+ *  only when the uplink confirms its delivery, SampleStoreAcknowledge(),
+ *  once the broker acknowledged it. Readings handed out and never
+ *  confirmed are handed out again after SampleStoreRewind(), or after a
+ *  reset: a reading may be forwarded twice, but is not lost.
+ *
+ *  An EEPROM byte takes 3.4ms to write and avr-libc busy-waits for the
+ *  previous one, so the writes are queued in RAM and done one byte per
+ *  medium task run, when the EEPROM is ready. The sequence byte of a
+ *  record is erased first and written last: a record cut by a reset is
+ *  seen as never written.
+ *
+ *  @{
+ */
+#include <Arduino.h>
+#include <avr/eeprom.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tasks.h"
+#include "timer.h"
+#include "eeprom_map.h"
+#include "sample_store.h"
+
+/** Record size, in bytes */
+#define STORE_RECORD_SIZE   8U
+/** Records in the ring */
+#define STORE_SLOTS         (EEPROM_SAMPLE_STORE_SIZE / STORE_RECORD_SIZE)
+/** Sequence of a slot never written */
+#define STORE_SEQ_ERASED    0xFFU
+/** Sequences go 1 to STORE_SEQ_LAST */
+#define STORE_SEQ_LAST      0xFEU
+/** Metric byte: record not forwarded yet */
+#define STORE_NOT_FORWARDED 0x80U
+/** Write steps of a record: sequence erased, bytes 1 to 7, sequence */
+#define STORE_WRITE_STEPS   (STORE_RECORD_SIZE + 1U)
+
+static_assert(EEPROM_SAMPLE_STORE_ADDR + EEPROM_SAMPLE_STORE_SIZE <= E2END + 1U, "store must fit the EEPROM");
+static_assert(STORE_SLOTS < STORE_SEQ_LAST, "the sequence must not wrap within one lap");
+static_assert(STORE_SLOTS <= UINT8_MAX, "slot indexes are 8 bit");
+
+/**
+ * \brief Reading waiting to be written
+ */
+typedef struct StorePending
+{
+    uint8_t  metric;
+    uint16_t value;
+    uint32_t time;      //!< System time of the reading, in ms
+} STORE_PENDING_t;
+
+/** Next slot written, and its sequence */
+static uint8_t store_head;
+static uint8_t store_seq = 1U;
+/** Oldest record not forwarded, and count of those */
+static uint8_t store_tail;
+static uint8_t store_count;
+/** Of those, records written before power on - their age is unknown */
+static uint8_t store_old;
+/** Of those, records handed out, their delivery not confirmed yet */
+static uint8_t store_sent;
+/** First forwarded record whose mark is not written yet - trails store_tail - and count of those.
+ *  A count, not store_marked != store_tail: a whole lap forwarded at once brings them level */
+static uint8_t store_marked;
+static uint8_t store_unmarked;
+
+static STORE_PENDING_t pending[SAMPLE_STORE_PENDING_MAX];
+static uint8_t pending_first;
+static uint8_t pending_count;
+
+/** Record being written, and the next write step - STORE_WRITE_STEPS: none */
+static uint8_t write_record[STORE_RECORD_SIZE];
+static uint8_t write_step = STORE_WRITE_STEPS;
+
+static SAMPLE_STORE_STATS_t store_stats;
+
+static void storePowerOn(void);
+static void storeWriteStep(void);
+static void storeStartRecord(void);
+static uint8_t storeNextSlot(uint8_t slot);
+static uint8_t storeNextSeq(uint8_t seq);
+static uint8_t *storeSlotAddress(uint8_t slot);
+
+/**
+ * Module's tasks runner
+ */
+void SAMPLE_STORE_run(TASKS_t running_task)
+{
+    switch(running_task)
+    {
+    case POWERON_TASK:
+        storePowerOn();
+        break;
+    case MEDIUM_TIME_TASK:
+        storeWriteStep();
+        break;
+    default:
+        /* Log internal error */
+        // INTERRLOG("tried to run an unsupported task");
+        break;
+    }
+}
+
+/**
+ * \brief Queues a reading for the ring
+ *
+ * @param [in] metric - metric identifier, up to SAMPLE_STORE_METRIC_MAX
+ * @param [in] value - encoded value
+ * @return false if the write queue is full
+ */
+bool SampleStoreAppend(uint8_t metric, uint16_t value)
+{
+    if ((metric > SAMPLE_STORE_METRIC_MAX) || (pending_count >= SAMPLE_STORE_PENDING_MAX))
+    {
+        store_stats.dropped++;
+        return false;
+    }
+
+    STORE_PENDING_t *entry = &pending[(pending_first + pending_count) % SAMPLE_STORE_PENDING_MAX];
+    entry->metric = metric;
+    entry->value = value;
+    entry->time = GetSystemTime();
+    pending_count++;
+    return true;
+}
+
+/**
+ * \brief Hands out the oldest reading not forwarded, nor handed out yet
+ *
+ * @param [out] sample - the reading, and the slot to confirm its delivery with
+ * @return false if there is none
+ */
+bool SampleStoreNext(STORED_SAMPLE_t *sample)
+{
+    uint8_t record[STORE_RECORD_SIZE];
+
+    if (store_sent >= store_count)
+    {
+        return false;
+    }
+
+    uint8_t slot = (uint8_t)((store_tail + store_sent) % STORE_SLOTS);
+    eeprom_read_block(record, storeSlotAddress(slot), sizeof(record));
+    uint32_t time = (uint32_t)record[4] | ((uint32_t)record[5] << 8) |
+                    ((uint32_t)record[6] << 16) | ((uint32_t)record[7] << 24);
+
+    sample->slot = slot;
+    sample->metric = (uint8_t)(record[1] & ~STORE_NOT_FORWARDED);
+    sample->value = (uint16_t)(record[2] | (record[3] << 8));
+    sample->aged = (store_sent >= store_old);
+    /* Elapsed milliseconds: wrap-safe, unlike a difference of seconds */
+    sample->age = sample->aged ? (GetElapsedTime(time) / 1000U) : 0U;
+    store_sent++;
+    return true;
+}
+
+/**
+ * \brief Confirms the delivery of a reading handed out - the mark is written later
+ *
+ * Delivery is confirmed in the order the readings were handed out; a
+ * reading other than the oldest one handed out - overwritten meanwhile, or
+ * out of order - is ignored, to be handed out again after SampleStoreRewind().
+ *
+ * @param [in] slot - STORED_SAMPLE_t slot of the reading
+ */
+void SampleStoreAcknowledge(uint8_t slot)
+{
+    if ((0U == store_sent) || (slot != store_tail))
+    {
+        return;
+    }
+
+    store_tail = storeNextSlot(store_tail);
+    store_count--;
+    store_sent--;
+    store_unmarked++;
+    if (store_old > 0U)
+    {
+        store_old--;
+    }
+    store_stats.forwarded++;
+}
+
+/**
+ * \brief Takes back the readings handed out and not confirmed - they are handed out again
+ */
+void SampleStoreRewind(void)
+{
+    store_sent = 0;
+}
+
+/**
+ * \brief Tells how many readings wait to be forwarded - the queued ones not included
+ */
+uint8_t SampleStoreCount(void)
+{
+    return store_count;
+}
+
+void SampleStoreGetStats(SAMPLE_STORE_STATS_t *stats)
+{
+    *stats = store_stats;
+}
+
+/**
+ * \brief Prints the store statistics
+ */
+void SampleStoreReportStats(void)
+{
+    Serial.print("[STORE] held=");
+    Serial.print(store_count);
+    Serial.print(" stored=");
+    Serial.print(store_stats.stored);
+    Serial.print(" forwarded=");
+    Serial.print(store_stats.forwarded);
+    Serial.print(" overwritten=");
+    Serial.print(store_stats.overwritten);
+    Serial.print(" dropped=");
+    Serial.println(store_stats.dropped);
+}
+
+/**
+ * \brief Finds the write position and the records not forwarded
+ */
+static void storePowerOn(void)
+{
+    store_head = 0;
+    store_seq = 1U;
+
+    /* The newest record is the one whose next slot does not follow its sequence */
+    for (uint8_t slot = 0; slot < STORE_SLOTS; slot++)
+    {
+        uint8_t seq = eeprom_read_byte(storeSlotAddress(slot));
+        if ((0U == seq) || (seq > STORE_SEQ_LAST))
+        {
+            continue;
+        }
+        uint8_t next = storeNextSlot(slot);
+        if (eeprom_read_byte(storeSlotAddress(next)) != storeNextSeq(seq))
+        {
+            store_head = next;
+            store_seq = storeNextSeq(seq);
+            break;
+        }
+    }
+
+    /* Walk back over the records not forwarded yet */
+    store_count = 0;
+    uint8_t slot = store_head;
+    uint8_t seq = store_seq;
+    while (store_count < STORE_SLOTS)
+    {
+        slot = (0U == slot) ? (uint8_t)(STORE_SLOTS - 1U) : (uint8_t)(slot - 1U);
+        seq = (1U == seq) ? STORE_SEQ_LAST : (uint8_t)(seq - 1U);
+        if ((eeprom_read_byte(storeSlotAddress(slot)) != seq) ||
+            !(eeprom_read_byte(storeSlotAddress(slot) + 1U) & STORE_NOT_FORWARDED))
+        {
+            break;
+        }
+        store_count++;
+    }
+    store_tail = (uint8_t)((store_head + STORE_SLOTS - store_count) % STORE_SLOTS);
+    store_marked = store_tail;
+    store_unmarked = 0;
+    store_old = store_count;
+    store_sent = 0;
+
+    if (store_count > 0U)
+    {
+        Serial.print("[STORE] ");
+        Serial.print(store_count);
+        Serial.println(" readings to forward");
+    }
+}
+
+/**
+ * \brief Writes one byte - the mark of a forwarded record, or the next byte of a record
+ */
+static void storeWriteStep(void)
+{
+    if (!eeprom_is_ready())
+    {
+        return;
+    }
+
+    if (write_step < STORE_WRITE_STEPS)
+    {
+        uint8_t *address = storeSlotAddress(store_head);
+        if (0U == write_step)
+        {
+            eeprom_update_byte(address, STORE_SEQ_ERASED);
+        }
+        else if (write_step < STORE_RECORD_SIZE)
+        {
+            eeprom_update_byte(address + write_step, write_record[write_step]);
+        }
+        else
+        {
+            eeprom_update_byte(address, write_record[0]);
+
+            store_head = storeNextSlot(store_head);
+            store_seq = storeNextSeq(store_seq);
+            store_count++;
+            store_stats.stored++;
+        }
+        write_step++;
+        return;
+    }
+
+    if (store_unmarked > 0U)
+    {
+        uint8_t *address = storeSlotAddress(store_marked) + 1U;
+        eeprom_update_byte(address, (uint8_t)(eeprom_read_byte(address) & ~STORE_NOT_FORWARDED));
+        store_marked = storeNextSlot(store_marked);
+        store_unmarked--;
+        return;
+    }
+
+    if (pending_count > 0U)
+    {
+        storeStartRecord();
+    }
+}
+
+/**
+ * \brief Takes the oldest queued reading and starts writing it at store_head
+ */
+static void storeStartRecord(void)
+{
+    const STORE_PENDING_t *entry = &pending[pending_first];
+
+    write_record[0] = store_seq;
+    write_record[1] = (uint8_t)(entry->metric | STORE_NOT_FORWARDED);
+    write_record[2] = (uint8_t)(entry->value & 0xFFU);
+    write_record[3] = (uint8_t)(entry->value >> 8);
+    write_record[4] = (uint8_t)(entry->time & 0xFFU);
+    write_record[5] = (uint8_t)(entry->time >> 8);
+    write_record[6] = (uint8_t)(entry->time >> 16);
+    write_record[7] = (uint8_t)(entry->time >> 24);
+    pending_first = (uint8_t)((pending_first + 1U) % SAMPLE_STORE_PENDING_MAX);
+    pending_count--;
+
+    if (STORE_SLOTS == store_count)
+    {
+        /* Full - the oldest record goes */
+        store_tail = storeNextSlot(store_tail);
+        store_count--;
+        if (store_old > 0U)
+        {
+            store_old--;
+        }
+        if (store_sent > 0U)
+        {
+            store_sent--;
+        }
+        store_stats.overwritten++;
+    }
+    if ((store_unmarked > 0U) && (store_marked == store_head))
+    {
+        /* Forwarded, mark pending - the slot is rewritten anyway */
+        store_marked = storeNextSlot(store_marked);
+        store_unmarked--;
+    }
+    write_step = 0;
+}
+
+static uint8_t storeNextSlot(uint8_t slot)
+{
+    return (slot + 1U >= STORE_SLOTS) ? 0U : (uint8_t)(slot + 1U);
+}
+
+static uint8_t storeNextSeq(uint8_t seq)
+{
+    return (seq >= STORE_SEQ_LAST) ? 1U : (uint8_t)(seq + 1U);
+}
+
+static uint8_t *storeSlotAddress(uint8_t slot)
+{
+    return (uint8_t *)(uintptr_t)(EEPROM_SAMPLE_STORE_ADDR + (uint16_t)slot * STORE_RECORD_SIZE);
+}
+
+/**  @}
+ * End of sample_store_module group definition
+ */
@@ -0,0 +1,144 @@
+/**
+ * \file sensor_cache.cpp
+ */
+
+/**
+ *  \defgroup sensor_cache_module Sensor cache
+ *
+ *  \brief Last reading of every sensor, with its age and quality
+ *
+ *  Sensor drivers publish each read attempt here - SensorCacheUpdate() for
+ *  a good value, SensorCacheReportError() for a failed one - and consumers
+ *  (control and uplink logic) read the cache instead of the drivers:
+ *
+ *  * a failed read does not overwrite the last good value with a marker
+ *    such as 0 - it sets SENSOR_FLAG_LAST_FAILED and the error code, and
+ *    the value simply ages;
+ *  * SensorCacheGetFresh() answers "value no older than N ms" from the
+ *    cache, without starting a physical read, so consumers act on
+ *    staleness instead of guessing from the value.
+ *
+ *  Slots may be written from interrupt handlers, so both sides copy a slot
+ *  with interrupts disabled - a few bytes, so the critical section is short
+ *  and a snapshot is always consistent.
+ *
+ *  @{
+ */
+#include <Arduino.h>
+#include <util/atomic.h>
+#include <math.h>
+
+#include "timer.h"
+#include "sensor_cache.h"
+
+/** Sensor slots - all start as SENSOR_ERR_NO_DATA, no flags */
+static SENSOR_READING_t sensor_cache[SENSOR_COUNT] =
+{
+    { 0.0f, 0U, 0U, SENSOR_ERR_NO_DATA },
+    { 0.0f, 0U, 0U, SENSOR_ERR_NO_DATA },
+    { 0.0f, 0U, 0U, SENSOR_ERR_NO_DATA },
+    { 0.0f, 0U, 0U, SENSOR_ERR_NO_DATA },
+};
+
+static_assert(sizeof(sensor_cache) / sizeof(sensor_cache[0]) == SENSOR_COUNT,
+              "one initializer per sensor slot");
+
+/**
+ * \brief Stores a good reading
+ *
+ * @param [in] sensor - sensor slot
+ * @param [in] value - value read
+ */
+void SensorCacheUpdate(SENSOR_ID_t sensor, float value)
+{
+    if (sensor >= SENSOR_COUNT)
+    {
+        return;
+    }
+
+    uint32_t now = GetSystemTime();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        SENSOR_READING_t *slot = &sensor_cache[sensor];
+        slot->value = value;
+        slot->timestamp = now;
+        slot->flags = SENSOR_FLAG_VALID;
+        slot->error = SENSOR_OK;
+    }
+}
+
+/**
+ * \brief Records a failed read attempt - the last good value is kept
+ *
+ * @param [in] sensor - sensor slot
+ * @param [in] error - failure cause
+ */
+void SensorCacheReportError(SENSOR_ID_t sensor, SENSOR_ERROR_t error)
+{
+    if (sensor >= SENSOR_COUNT)
+    {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        SENSOR_READING_t *slot = &sensor_cache[sensor];
+        slot->flags |= SENSOR_FLAG_LAST_FAILED;
+        slot->error = (uint8_t)error;
+    }
+}
+
+/**
+ * \brief Gets a consistent snapshot of a sensor slot
+ *
+ * @param [in] sensor - sensor slot
+ * @param [out] reading - slot snapshot
+ * @return true if the slot holds a good value, of any age
+ */
+bool SensorCacheGet(SENSOR_ID_t sensor, SENSOR_READING_t *reading)
+{
+    if (sensor >= SENSOR_COUNT)
+    {
+        return false;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        *reading = sensor_cache[sensor];
+    }
+    return 0U != (reading->flags & SENSOR_FLAG_VALID);
+}
+
+/**
+ * \brief Gets a sensor value, if it is recent enough
+ *
+ * @param [in] sensor - sensor slot
+ * @param [in] max_age - maximum value age, in ms
+ * @param [out] value - cached value, only written when true is returned
+ * @return true if the slot holds a good value read at most max_age ms ago
+ */
+bool SensorCacheGetFresh(SENSOR_ID_t sensor, uint32_t max_age, float *value)
+{
+    SENSOR_READING_t reading;
+    if (!SensorCacheGet(sensor, &reading) || (GetElapsedTime(reading.timestamp) > max_age))
+    {
+        return false;
+    }
+    *value = reading.value;
+    return true;
+}
+
+/**
+ * \brief Encodes a value as GetEncodedTemperature() does: centi-units + SENSOR_ENCODING_OFFSET
+ *
+ * @param [in] value - value, -200.00 to 455.35
+ * @return encoded value
+ */
+uint16_t SensorEncode(float value)
+{
+    return (uint16_t)(lroundf(value * 100.0f) + SENSOR_ENCODING_OFFSET);
+}
+
+/**  @}
+ * End of sensor_cache_module group definition
+ */
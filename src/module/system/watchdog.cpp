@@ -0,0 +1,248 @@
+/**
+ * \file watchdog.cpp
+ */
+
+/**
+ *  \defgroup watchdog_module Watchdog
+ *
+ *  \brief Task budgets, overrun detection and hardware watchdog feeding
+ *
+ *  Each periodic task has a run time budget. The scheduler reports every
+ *  task start and end to this module, which:
+ *
+ *  * records budget overruns - count, offending task and its run time;
+ *  * keeps track of which tasks made progress (completed at least one run)
+ *    since the hardware watchdog was last fed;
+ *  * feeds the AVR watchdog, from the very slow time task, only when all
+ *    periodic tasks made progress - a task that hangs, or one that is
+ *    starved by another, lets the watchdog expire.
+ *
+ *  The watchdog runs in "interrupt and system reset" mode: the first
+ *  timeout calls the WDT interrupt, which stores the task that was running
+ *  into the record, and the second one resets the MCU. The record lives in
+ *  the .noinit section, so it survives the reset and is reported by the
+ *  power on task - when MCUSR says the reset came from the watchdog. If
+ *  the task recovers before the second timeout, the next feed re-arms the
+ *  interrupt.
+ *
+ *  @{
+ */
+#include <Arduino.h>
+#include <avr/wdt.h>
+#ifndef NATIVE_BUILD
+#include <avr/interrupt.h>
+#endif
+
+#include "tasks.h"
+#include "watchdog.h"
+
+/** Hardware watchdog timeout - the interrupt comes after 2s, the reset after 4s */
+#define WATCHDOG_TIMEOUT WDTO_2S
+/** Record validity marker */
+#define WATCHDOG_MAGIC   0x5744U
+
+#ifdef NATIVE_BUILD
+#define WATCHDOG_NOINIT
+#else
+#define WATCHDOG_NOINIT __attribute__((section(".noinit")))
+#endif
+
+/** Task run time budgets, in microseconds, indexed by TASKS_t - 0: not checked */
+static const uint32_t task_budget_us[] =
+{
+    0,          // POWERON_TASK
+    2000,       // FAST_TIME_TASK
+    20000,      // MEDIUM_TIME_TASK - the AT engine writes up to 10 bytes per run, ~1ms each
+    20000,      // SLOW_TIME_TASK
+    50000,      // VERY_SLOW_TIME_TASK
+    0           // POWEROFF_TASK
+};
+
+static_assert(sizeof(task_budget_us) / sizeof(task_budget_us[0]) == (POWEROFF_TASK + 1),
+              "one budget per task");
+
+/** Tasks that must make progress between two watchdog feeds */
+static const uint8_t REQUIRED_PROGRESS = _BV(FAST_TIME_TASK) | _BV(MEDIUM_TIME_TASK) |
+                                         _BV(SLOW_TIME_TASK) | _BV(VERY_SLOW_TIME_TASK);
+
+/** Overrun and hang record, kept across watchdog resets */
+static WATCHDOG_RECORD_t record WATCHDOG_NOINIT;
+/** MCUSR at reset, saved before it is cleared */
+static uint8_t reset_cause WATCHDOG_NOINIT;
+/** Tasks that completed a run since the last feed */
+static uint8_t progress;
+/** The last reset was caused by the watchdog */
+static bool wdt_reset_occurred;
+
+static void watchdogPowerOn(void);
+static void watchdogFeed(void);
+
+/**
+ * Module's tasks runner
+ */
+void WATCHDOG_run(TASKS_t running_task)
+{
+    switch(running_task)
+    {
+    case POWERON_TASK:
+        watchdogPowerOn();
+        break;
+    case VERY_SLOW_TIME_TASK:
+        watchdogFeed();
+        break;
+    default:
+        /* Log internal error */
+        // INTERRLOG("tried to run an unsupported task");
+        break;
+    }
+}
+
+/**
+ * \brief Notifies the start of a task run
+ */
+void WatchdogTaskStart(TASKS_t task)
+{
+    record.running_task = (uint8_t)task;
+}
+
+/**
+ * \brief Notifies the end of a task run, checking it against the task budget
+ *
+ * @param [in] task - task that ran
+ * @param [in] run_time - task run time, in microseconds
+ */
+void WatchdogTaskDone(TASKS_t task, uint32_t run_time)
+{
+    record.running_task = WATCHDOG_NO_TASK;
+    progress |= (uint8_t)_BV(task);
+
+    uint32_t budget = task_budget_us[task];
+    if ((budget > 0U) && (run_time > budget))
+    {
+        if (record.overrun_count < UINT16_MAX)
+        {
+            record.overrun_count++;
+        }
+        record.overrun_task = (uint8_t)task;
+        record.overrun_time = run_time;
+    }
+}
+
+/**
+ * \brief Gets the overrun and hang record
+ */
+const WATCHDOG_RECORD_t *WatchdogGetRecord(void)
+{
+    return &record;
+}
+
+/**
+ * \brief Checks whether the last reset was caused by the watchdog
+ */
+bool WatchdogResetOccurred(void)
+{
+    return wdt_reset_occurred;
+}
+
+static void watchdogPowerOn(void)
+{
+    if ((WATCHDOG_MAGIC == record.magic) && (reset_cause & _BV(WDRF)))
+    {
+        /* Coming back from a watchdog reset: report what the record kept -
+           no running task if the interrupt could not run */
+        wdt_reset_occurred = true;
+        if (record.wdt_reset_count < UINT8_MAX)
+        {
+            record.wdt_reset_count++;
+        }
+        Serial.print("[WATCHDOG] reset - running task: ");
+        Serial.print(record.hung_task);
+        Serial.print(", last overrun: task ");
+        Serial.print(record.overrun_task);
+        Serial.print(" ");
+        Serial.print(record.overrun_time);
+        Serial.print("us, overruns: ");
+        Serial.println(record.overrun_count);
+    }
+    else if (WATCHDOG_MAGIC != record.magic)
+    {
+        /* Power on: the record holds garbage */
+        record.magic = WATCHDOG_MAGIC;
+        record.overrun_count = 0;
+        record.overrun_task = WATCHDOG_NO_TASK;
+        record.overrun_time = 0;
+        record.wdt_reset_count = 0;
+    }
+    record.running_task = WATCHDOG_NO_TASK;
+    record.hung_task = WATCHDOG_NO_TASK;
+    record.wdt_fired = false;
+    progress = 0;
+
+    wdt_enable(WATCHDOG_TIMEOUT);
+    /* Interrupt first, reset on the next timeout */
+    WDTCSR |= _BV(WDIE);
+}
+
+static void watchdogFeed(void)
+{
+    /* Runs within the very slow task, before WatchdogTaskDone() counts it: without
+       this, the first feed would wait the task's second run, right at the timeout */
+    progress |= (uint8_t)_BV(VERY_SLOW_TIME_TASK);
+
+    if ((progress & REQUIRED_PROGRESS) == REQUIRED_PROGRESS)
+    {
+        progress = 0;
+        wdt_reset();
+
+        if (record.wdt_fired)
+        {
+            /* The hung task recovered: back to interrupt then reset mode */
+            Serial.print("[WATCHDOG] task ");
+            Serial.print(record.hung_task);
+            Serial.println(" recovered");
+            record.wdt_fired = false;
+            record.hung_task = WATCHDOG_NO_TASK;
+            WDTCSR |= _BV(WDIE);
+        }
+    }
+}
+
+#ifndef NATIVE_BUILD
+/**
+ * \brief Watchdog timeout: stores the hung task - the next timeout resets the MCU
+ *
+ * The hardware clears WDIE when this interrupt runs, so the
+ *   watchdog is now in plain reset mode - watchdogFeed() sets it again if
+ *   the task recovers.
+ */
+ISR(WDT_vect)
+{
+    record.hung_task = record.running_task;
+    record.wdt_fired = true;
+}
+
+/**
+ * \brief Stops the watchdog right after reset, before the C runtime init
+ *
+ * After a watchdog reset the watchdog stays enabled, at its shortest
+ *   timeout, until it is explicitly disabled - that must happen before
+ *   setup() gets a chance to run. WDRF must be cleared for that, so MCUSR
+ *   is saved first. Optiboot clears MCUSR itself and, from version 6 on,
+ *   hands its value over in r2.
+ */
+void watchdogEarlyInit(void) __attribute__((naked, used, section(".init3")));
+void watchdogEarlyInit(void)
+{
+    reset_cause = MCUSR;
+    if (0U == reset_cause)
+    {
+        __asm__ __volatile__("sts %0, r2" : "=m"(reset_cause));
+    }
+    MCUSR = 0;
+    wdt_disable();
+}
+#endif
+
+/**  @}
+ * End of watchdog_module group definition
+ */
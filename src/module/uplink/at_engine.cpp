@@ -0,0 +1,574 @@
+/**
+ * \file at_engine.cpp
+ */
+
+/**
+ *  \defgroup at_engine_module AT engine
+ *
+ *  \brief Non-blocking ESP-01 AT command engine
+ *
+ *  Owns the ESP-01 serial link. Callers queue commands - a command line,
+ *  or a payload sent through AT+CIPSEND - with a timeout and a result
+ *  variable, then poll that variable (from a protothread, typically) until
+ *  it leaves AT_PENDING. Commands run one at a time, in queue order.
+ *
+ *  The medium time task drives the engine:
+ *
+ *  * the received bytes go through an incremental tokenizer, which splits
+ *    lines and recognizes "OK", "ERROR"/"FAIL", "SEND OK", "SEND FAIL",
+ *    "CLOSED" (also as "<id>,CLOSED"), the '>' send prompt, which has no
+ *    line end, and "+IPD,<len>:" frames, whose <len> binary bytes are
+ *    collected and handed to the IPD handler;
+ *  * the running command advances on those tokens;
+ *  * at most AT_TX_BYTES_PER_RUN bytes are written per run - SoftwareSerial
+ *    blocks about 1ms per byte, so a long command or payload is spread
+ *    over several runs instead of stalling the task for tens of ms.
+ *
+ *  Each command's timeout is a software timer, armed when the command
+ *  starts; on expiry the command completes with AT_TIMEOUT. The same timer
+ *  holds the 50ms guard between the '>' prompt and the payload, which the
+ *  ESP-01 (SDK 0.9.5) needs.
+ *
+ *  With -D AT_TRACE the commands and the received lines are printed.
+ *
+ *  @{
+ */
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tasks.h"
+#include "timer.h"
+#include "at_engine.h"
+
+/** Bytes written to the ESP-01 per medium task run - about 1ms each */
+#define AT_TX_BYTES_PER_RUN  8U
+/** Received line kept for classification - longer lines are truncated */
+#define AT_LINE_MAX         24U
+/** Wait between the '>' prompt and the payload, in ms */
+#define AT_PROMPT_GUARD_MS  50U
+
+static_assert((AT_QUEUE_SIZE & (AT_QUEUE_SIZE - 1U)) == 0U, "queue size must be a power of two");
+
+/**
+ * \brief Queued command
+ */
+typedef struct AtCommand
+{
+    const char    *text;         //!< Command line, without line end - NULL for a payload send
+    const uint8_t *payload;      //!< Payload of a send, kept by the caller until completion
+    uint16_t       payload_len;  //!< Payload length
+    uint16_t       timeout;      //!< Timeout, in ms
+    AT_RESULT_t   *result;       //!< Caller's result variable, or NULL
+} AT_COMMAND_t;
+
+/**
+ * \brief Engine state - of the command at the head of the queue
+ */
+typedef enum AtState
+{
+    AT_IDLE,            //!< No command running
+    AT_TX_COMMAND,      //!< Writing the command line
+    AT_WAIT_RESPONSE,   //!< Waiting "OK"/"ERROR"
+    AT_WAIT_PROMPT,     //!< Waiting the '>' prompt of AT+CIPSEND
+    AT_PROMPT_GUARD,    //!< Prompt received, waiting AT_PROMPT_GUARD_MS
+    AT_TX_PAYLOAD,      //!< Writing the payload
+    AT_WAIT_SEND_OK     //!< Waiting "SEND OK"/"SEND FAIL"
+} AT_STATE_t;
+
+/**
+ * \brief Tokens recognized in the ESP-01 output
+ */
+typedef enum AtToken
+{
+    AT_TOKEN_NONE,      //!< Any other line - echo, "busy p...", "Recv N bytes"
+    AT_TOKEN_OK,
+    AT_TOKEN_ERROR,
+    AT_TOKEN_PROMPT,
+    AT_TOKEN_SEND_OK,
+    AT_TOKEN_SEND_FAIL,
+    AT_TOKEN_CLOSED
+} AT_TOKEN_t;
+
+// ESP-01 link on SoftwareSerial: pin 7 is RX, pin 8 is TX - no other module
+// may drive them. Pins 0 and 1 are the hardware serial (programming/monitoring),
+// pin 2 is the DHT INT0 capture.
+static SoftwareSerial ESPserial(7, 8); // RX, TX
+
+static AT_COMMAND_t at_queue[AT_QUEUE_SIZE];
+/** Head of the queue - the running command */
+static uint8_t at_queue_first;
+static uint8_t at_queue_count;
+static AT_STATE_t at_state = AT_IDLE;
+/** Command timeout, then prompt guard */
+static SOFT_TIMER_t at_timer;
+
+/** Bytes left to write, and the line end still due after them */
+static const uint8_t *tx_data;
+static uint16_t tx_len;
+static bool tx_line_end;
+/** "AT+CIPSEND=<len>" */
+static char cipsend_line[18];
+
+/** Line being received */
+static char rx_line[AT_LINE_MAX + 1U];
+static uint8_t rx_line_len;
+/** +IPD payload bytes still to come, and bytes kept */
+static uint16_t ipd_remaining;
+static uint8_t ipd_len;
+static uint8_t ipd_data[AT_IPD_MAX];
+/** More payload bytes came than were kept */
+static bool ipd_truncated;
+
+static AT_IPD_HANDLER_t at_ipd_handler;
+static AT_CLOSED_HANDLER_t at_closed_handler;
+static AT_STATS_t at_stats;
+
+static bool atEnqueue(const char *text, const uint8_t *payload, uint16_t len, uint16_t timeout_ms, AT_RESULT_t *result);
+static void atStartNext(void);
+static void atTransmit(void);
+static void atReceive(void);
+static void atReceiveByte(uint8_t c);
+static void atReceiveIpd(uint8_t c);
+static void atIpdHeader(void);
+static AT_TOKEN_t atClassifyLine(void);
+static void atToken(AT_TOKEN_t token);
+static void atComplete(AT_RESULT_t result);
+static void atTimerExpired(void *context);
+
+/**
+ * Module's tasks runner
+ */
+void AT_ENGINE_run(TASKS_t running_task)
+{
+    switch(running_task)
+    {
+    case POWERON_TASK:
+        // Start the software serial port for communication with the ESP-01
+        ESPserial.begin(9600);
+        break;
+    case MEDIUM_TIME_TASK:
+        atReceive();
+        if (AT_IDLE == at_state)
+        {
+            atStartNext();
+        }
+        atTransmit();
+        break;
+    default:
+        /* Log internal error */
+        // INTERRLOG("tried to run an unsupported task");
+        break;
+    }
+}
+
+/**
+ * \brief Queues an AT command
+ *
+ * @param [in] command - command line, without line end - must stay valid until it is sent
+ * @param [in] timeout_ms - time for the final response, from the command start
+ * @param [out] result - set to AT_PENDING now, and to the result on completion - may be NULL
+ * @return false if the queue is full
+ */
+bool AtEngineCommand(const char *command, uint16_t timeout_ms, AT_RESULT_t *result)
+{
+    return atEnqueue(command, NULL, 0U, timeout_ms, result);
+}
+
+/**
+ * \brief Queues a payload send: AT+CIPSEND, '>' prompt, payload, "SEND OK"
+ *
+ * @param [in] payload - bytes to send - must stay valid until completion
+ * @param [in] len - payload length
+ * @param [in] timeout_ms - time for the '>' prompt, from the command start, then again for "SEND OK"
+ * @param [out] result - set to AT_PENDING now, and to the result on completion - may be NULL
+ * @return false if the queue is full
+ */
+bool AtEngineSend(const uint8_t *payload, uint16_t len, uint16_t timeout_ms, AT_RESULT_t *result)
+{
+    return atEnqueue(NULL, payload, len, timeout_ms, result);
+}
+
+/**
+ * \brief Tells whether no command is queued or running
+ */
+bool AtEngineIdle(void)
+{
+    return 0U == at_queue_count;
+}
+
+/**
+ * \brief Sets the inbound data and link closed handlers - NULL: ignored
+ *
+ * The handlers run from the medium time task.
+ */
+void AtEngineSetHandlers(AT_IPD_HANDLER_t ipd_handler, AT_CLOSED_HANDLER_t closed_handler)
+{
+    at_ipd_handler = ipd_handler;
+    at_closed_handler = closed_handler;
+}
+
+void AtEngineGetStats(AT_STATS_t *stats)
+{
+    *stats = at_stats;
+}
+
+/**
+ * \brief Prints the engine statistics
+ */
+void AtEngineReportStats(void)
+{
+    Serial.print("[AT] commands=");
+    Serial.print(at_stats.commands);
+    Serial.print(" errors=");
+    Serial.print(at_stats.errors);
+    Serial.print(" timeouts=");
+    Serial.print(at_stats.timeouts);
+    Serial.print(" ipd=");
+    Serial.print(at_stats.ipd_frames);
+    Serial.print(" truncated=");
+    Serial.println(at_stats.ipd_truncated);
+}
+
+static bool atEnqueue(const char *text, const uint8_t *payload, uint16_t len, uint16_t timeout_ms, AT_RESULT_t *result)
+{
+    if (at_queue_count >= AT_QUEUE_SIZE)
+    {
+        return false;
+    }
+
+    AT_COMMAND_t *command = &at_queue[(at_queue_first + at_queue_count) & (AT_QUEUE_SIZE - 1U)];
+    command->text = text;
+    command->payload = payload;
+    command->payload_len = len;
+    command->timeout = timeout_ms;
+    command->result = result;
+    at_queue_count++;
+
+    if (NULL != result)
+    {
+        *result = AT_PENDING;
+    }
+    return true;
+}
+
+/**
+ * \brief Starts the command at the head of the queue, if any
+ */
+static void atStartNext(void)
+{
+    if (0U == at_queue_count)
+    {
+        return;
+    }
+
+    const AT_COMMAND_t *command = &at_queue[at_queue_first];
+    const char *line = command->text;
+    if (NULL == line)
+    {
+        snprintf(cipsend_line, sizeof(cipsend_line), "AT+CIPSEND=%u", command->payload_len);
+        line = cipsend_line;
+    }
+#ifdef AT_TRACE
+    Serial.print("[AT] > ");
+    Serial.println(line);
+#endif
+
+    tx_data = (const uint8_t *)line;
+    tx_len = (uint16_t)strlen(line);
+    tx_line_end = true;
+    at_state = AT_TX_COMMAND;
+    SoftTimerArm(&at_timer, command->timeout, &atTimerExpired, NULL);
+}
+
+/**
+ * \brief Writes up to AT_TX_BYTES_PER_RUN bytes of the command line or payload
+ */
+static void atTransmit(void)
+{
+    if ((AT_TX_COMMAND != at_state) && (AT_TX_PAYLOAD != at_state))
+    {
+        return;
+    }
+
+    uint8_t budget = AT_TX_BYTES_PER_RUN;
+    while ((budget > 0U) && (tx_len > 0U))
+    {
+        ESPserial.write(*tx_data++);
+        tx_len--;
+        budget--;
+    }
+    if (tx_len > 0U)
+    {
+        return;
+    }
+    if (tx_line_end)
+    {
+        /* Two more bytes - not worth another run */
+        ESPserial.write('\r');
+        ESPserial.write('\n');
+        tx_line_end = false;
+    }
+
+    if (AT_TX_PAYLOAD == at_state)
+    {
+        at_state = AT_WAIT_SEND_OK;
+    }
+    else
+    {
+        at_state = (NULL == at_queue[at_queue_first].text) ? AT_WAIT_PROMPT : AT_WAIT_RESPONSE;
+    }
+}
+
+/**
+ * \brief Runs the received bytes through the tokenizer
+ */
+static void atReceive(void)
+{
+    while (ESPserial.available())
+    {
+        atReceiveByte((uint8_t)ESPserial.read());
+    }
+}
+
+static void atReceiveByte(uint8_t c)
+{
+    if (ipd_remaining > 0U)
+    {
+        atReceiveIpd(c);
+        return;
+    }
+
+    switch (c)
+    {
+    case '\r':
+        break;
+    case '\n':
+        if (rx_line_len > 0U)
+        {
+            rx_line[rx_line_len] = '\0';
+#ifdef AT_TRACE
+            Serial.print("[AT] < ");
+            Serial.println(rx_line);
+#endif
+            atToken(atClassifyLine());
+            rx_line_len = 0;
+        }
+        break;
+    case '>':
+        /* The send prompt comes alone, with no line end */
+        if (0U == rx_line_len)
+        {
+            atToken(AT_TOKEN_PROMPT);
+            break;
+        }
+        /* fall through */
+    default:
+        if (rx_line_len < AT_LINE_MAX)
+        {
+            rx_line[rx_line_len++] = (char)c;
+        }
+        if ((':' == c) && (rx_line_len > 5U) && (0 == strncmp(rx_line, "+IPD,", 5)))
+        {
+            atIpdHeader();
+        }
+        break;
+    }
+}
+
+/**
+ * \brief "+IPD,<len>:" or "+IPD,<id>,<len>:" received - the payload follows
+ */
+static void atIpdHeader(void)
+{
+    uint16_t len = 0;
+
+    for (uint8_t i = 5U; (i < rx_line_len) && (':' != rx_line[i]); i++)
+    {
+        if (',' == rx_line[i])
+        {
+            len = 0;
+        }
+        else
+        {
+            len = (uint16_t)(len * 10U + (uint8_t)(rx_line[i] - '0'));
+        }
+    }
+    rx_line_len = 0;
+    ipd_len = 0;
+    ipd_truncated = false;
+    ipd_remaining = len;
+}
+
+static void atReceiveIpd(uint8_t c)
+{
+    if (ipd_len < AT_IPD_MAX)
+    {
+        ipd_data[ipd_len++] = c;
+    }
+    else
+    {
+        ipd_truncated = true;
+    }
+    if (--ipd_remaining > 0U)
+    {
+        return;
+    }
+
+    at_stats.ipd_frames++;
+    if (ipd_truncated)
+    {
+        at_stats.ipd_truncated++;
+    }
+    if (NULL != at_ipd_handler)
+    {
+        at_ipd_handler(ipd_data, ipd_len);
+    }
+}
+
+static AT_TOKEN_t atClassifyLine(void)
+{
+    if (0 == strcmp(rx_line, "OK"))
+    {
+        return AT_TOKEN_OK;
+    }
+    if ((0 == strcmp(rx_line, "ERROR")) || (0 == strcmp(rx_line, "FAIL")))
+    {
+        return AT_TOKEN_ERROR;
+    }
+    if (0 == strcmp(rx_line, "SEND OK"))
+    {
+        return AT_TOKEN_SEND_OK;
+    }
+    if (0 == strcmp(rx_line, "SEND FAIL"))
+    {
+        return AT_TOKEN_SEND_FAIL;
+    }
+    if ((rx_line_len >= 6U) && (0 == strcmp(&rx_line[rx_line_len - 6U], "CLOSED")))
+    {
+        return AT_TOKEN_CLOSED;
+    }
+    return AT_TOKEN_NONE;
+}
+
+/**
+ * \brief Advances the running command on a token
+ */
+static void atToken(AT_TOKEN_t token)
+{
+    if (AT_TOKEN_CLOSED == token)
+    {
+        if (NULL != at_closed_handler)
+        {
+            at_closed_handler();
+        }
+        /* A send in progress has lost its link */
+        if ((AT_WAIT_PROMPT == at_state) || (AT_PROMPT_GUARD == at_state) ||
+            (AT_TX_PAYLOAD == at_state) || (AT_WAIT_SEND_OK == at_state))
+        {
+            atComplete(AT_ERROR);
+        }
+        return;
+    }
+
+    switch (at_state)
+    {
+    case AT_WAIT_RESPONSE:
+        if (AT_TOKEN_OK == token)
+        {
+            atComplete(AT_OK);
+        }
+        else if (AT_TOKEN_ERROR == token)
+        {
+            atComplete(AT_ERROR);
+        }
+        break;
+    case AT_WAIT_PROMPT:
+        /* AT+CIPSEND answers "OK" before the prompt */
+        if (AT_TOKEN_PROMPT == token)
+        {
+            at_state = AT_PROMPT_GUARD;
+            SoftTimerArm(&at_timer, AT_PROMPT_GUARD_MS, &atTimerExpired, NULL);
+        }
+        else if (AT_TOKEN_ERROR == token)
+        {
+            atComplete(AT_ERROR);
+        }
+        break;
+    case AT_WAIT_SEND_OK:
+        if (AT_TOKEN_SEND_OK == token)
+        {
+            atComplete(AT_OK);
+        }
+        else if ((AT_TOKEN_SEND_FAIL == token) || (AT_TOKEN_ERROR == token))
+        {
+            atComplete(AT_ERROR);
+        }
+        break;
+    default:
+        /* Unsolicited, or a late answer to a timed out command */
+        break;
+    }
+}
+
+/**
+ * \brief Completes the running command and drops it from the queue
+ */
+static void atComplete(AT_RESULT_t result)
+{
+    const AT_COMMAND_t *command = &at_queue[at_queue_first];
+
+    SoftTimerCancel(&at_timer);
+    if (NULL != command->result)
+    {
+        *command->result = result;
+    }
+#ifdef AT_TRACE
+    Serial.print("[AT] result ");
+    Serial.println((int)result);
+#endif
+
+    at_stats.commands++;
+    if (AT_ERROR == result)
+    {
+        at_stats.errors++;
+    }
+    else if (AT_TIMEOUT == result)
+    {
+        at_stats.timeouts++;
+    }
+
+    at_queue_first = (at_queue_first + 1U) & (AT_QUEUE_SIZE - 1U);
+    at_queue_count--;
+    at_state = AT_IDLE;
+    tx_len = 0;
+    tx_line_end = false;
+}
+
+/**
+ * \brief Command timeout or end of the prompt guard - runs from the scheduler
+ */
+static void atTimerExpired(void *context)
+{
+    (void)context;
+
+    if (AT_PROMPT_GUARD == at_state)
+    {
+        const AT_COMMAND_t *command = &at_queue[at_queue_first];
+        tx_data = command->payload;
+        tx_len = command->payload_len;
+        tx_line_end = false;
+        at_state = AT_TX_PAYLOAD;
+        SoftTimerArm(&at_timer, command->timeout, &atTimerExpired, NULL);
+        return;
+    }
+    atComplete(AT_TIMEOUT);
+}
+
+/**  @}
+ * End of at_engine_module group definition
+ */
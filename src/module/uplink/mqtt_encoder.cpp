@@ -0,0 +1,188 @@
+/**
+ * \file mqtt_encoder.cpp
+ */
+
+/**
+ *  \defgroup mqtt_encoder_module MQTT encoder
+ *
+ *  \brief MQTT 3.1.1 packet encoder, with no dynamic allocation
+ *
+ *  Each function writes one control packet into a buffer supplied by the
+ *  caller - a static one, usually - and returns its length, or 0 when the
+ *  packet does not fit; nothing is written past 'size'. Packets can be
+ *  appended to each other, to go out in a single AT+CIPSEND:
+ *
+ *  \code
+ *  uint16_t len = MqttEncodePublish(buffer, sizeof(buffer), &topic_a, a, a_len, MQTT_QOS_0, 0);
+ *  len += MqttEncodePublish(&buffer[len], sizeof(buffer) - len, &topic_b, b, b_len, MQTT_QOS_0, 0);
+ *  \endcode
+ *
+ *  The Remaining Length is encoded as the standard's variable length
+ *  integer, 7 bits per byte. Topic headers - name and length - are built
+ *  at compile time with MQTT_TOPIC() and copied from PROGMEM as they are.
+ *
+ *  @{
+ */
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mqtt_encoder.h"
+
+/** Control packet types, fixed header high nibble */
+#define MQTT_CONNECT        0x10U
+#define MQTT_PUBLISH        0x30U
+#define MQTT_PINGREQ        0xC0U
+#define MQTT_DISCONNECT     0xE0U
+
+/** CONNECT variable header: protocol name "MQTT", level 4 (3.1.1) */
+#define MQTT_PROTOCOL_LEVEL 4U
+/** CONNECT flags */
+#define MQTT_CLEAN_SESSION  0x02U
+
+static uint16_t mqttFixedHeader(uint8_t *buffer, uint16_t size, uint8_t header, uint32_t remaining);
+
+/**
+ * \brief Encodes a Remaining Length field
+ *
+ * @param [out] buffer - at least MQTT_REMAINING_LEN_MAX bytes
+ * @param [in] length - Remaining Length
+ * @return bytes written, 1 to 3
+ */
+uint8_t MqttEncodeRemainingLength(uint8_t *buffer, uint16_t length)
+{
+    uint8_t n = 0;
+
+    do
+    {
+        uint8_t digit = (uint8_t)(length & 0x7FU);
+        length >>= 7;
+        if (length > 0U)
+        {
+            digit |= 0x80U;
+        }
+        buffer[n++] = digit;
+    } while (length > 0U);
+
+    return n;
+}
+
+/**
+ * \brief Encodes a CONNECT packet - no will, no user name or password
+ *
+ * @param [out] buffer, size - output buffer
+ * @param [in] client_id - client identifier
+ * @param [in] keep_alive_s - keep alive, in seconds
+ * @param [in] clean_session - start a new session
+ * @return packet length, 0 if it does not fit
+ */
+uint16_t MqttEncodeConnect(uint8_t *buffer, uint16_t size, const char *client_id, uint16_t keep_alive_s,
+                           bool clean_session)
+{
+    static const uint8_t protocol[] = { 0x00, 0x04, 'M', 'Q', 'T', 'T', MQTT_PROTOCOL_LEVEL };
+    uint16_t id_len = (uint16_t)strlen(client_id);
+    uint32_t remaining = sizeof(protocol) + 1U + 2U + 2U + (uint32_t)id_len;
+
+    uint16_t n = mqttFixedHeader(buffer, size, MQTT_CONNECT, remaining);
+    if (0U == n)
+    {
+        return 0;
+    }
+
+    memcpy(&buffer[n], protocol, sizeof(protocol));
+    n += sizeof(protocol);
+    buffer[n++] = clean_session ? MQTT_CLEAN_SESSION : 0U;
+    buffer[n++] = (uint8_t)(keep_alive_s >> 8);
+    buffer[n++] = (uint8_t)(keep_alive_s & 0xFFU);
+    buffer[n++] = (uint8_t)(id_len >> 8);
+    buffer[n++] = (uint8_t)(id_len & 0xFFU);
+    memcpy(&buffer[n], client_id, id_len);
+
+    return (uint16_t)(n + id_len);
+}
+
+/**
+ * \brief Encodes a PUBLISH packet
+ *
+ * @param [out] buffer, size - output buffer
+ * @param [in] topic - topic header, in PROGMEM
+ * @param [in] payload, payload_len - application message
+ * @param [in] qos - quality of service
+ * @param [in] packet_id - packet identifier, not 0 - ignored for QoS 0
+ * @return packet length, 0 if it does not fit
+ */
+uint16_t MqttEncodePublish(uint8_t *buffer, uint16_t size, const MQTT_TOPIC_t *topic, const uint8_t *payload,
+                           uint16_t payload_len, MQTT_QOS_t qos, uint16_t packet_id)
+{
+    uint16_t topic_len = (uint16_t)((pgm_read_byte(&topic->length[0]) << 8) | pgm_read_byte(&topic->length[1]));
+    uint16_t id_len = (MQTT_QOS_0 == qos) ? 0U : 2U;
+    uint32_t remaining = 2U + topic_len + id_len + (uint32_t)payload_len;
+
+    uint16_t n = mqttFixedHeader(buffer, size, (uint8_t)(MQTT_PUBLISH | (qos << 1)), remaining);
+    if (0U == n)
+    {
+        return 0;
+    }
+
+    memcpy_P(&buffer[n], topic, 2U + topic_len);
+    n += 2U + topic_len;
+    if (id_len > 0U)
+    {
+        buffer[n++] = (uint8_t)(packet_id >> 8);
+        buffer[n++] = (uint8_t)(packet_id & 0xFFU);
+    }
+    memcpy(&buffer[n], payload, payload_len);
+
+    return (uint16_t)(n + payload_len);
+}
+
+/**
+ * \brief Encodes a PINGREQ packet
+ *
+ * @return packet length, 0 if it does not fit
+ */
+uint16_t MqttEncodePingreq(uint8_t *buffer, uint16_t size)
+{
+    return mqttFixedHeader(buffer, size, MQTT_PINGREQ, 0U);
+}
+
+/**
+ * \brief Encodes a DISCONNECT packet
+ *
+ * @return packet length, 0 if it does not fit
+ */
+uint16_t MqttEncodeDisconnect(uint8_t *buffer, uint16_t size)
+{
+    return mqttFixedHeader(buffer, size, MQTT_DISCONNECT, 0U);
+}
+
+/**
+ * \brief Writes the fixed header, once the whole packet is known to fit
+ *
+ * @return fixed header length, 0 if the packet does not fit
+ */
+static uint16_t mqttFixedHeader(uint8_t *buffer, uint16_t size, uint8_t header, uint32_t remaining)
+{
+    uint8_t length[MQTT_REMAINING_LEN_MAX];
+
+    if (remaining > UINT16_MAX)
+    {
+        return 0;
+    }
+    uint8_t length_len = MqttEncodeRemainingLength(length, (uint16_t)remaining);
+    if (1U + length_len + remaining > size)
+    {
+        return 0;
+    }
+
+    buffer[0] = header;
+    memcpy(&buffer[1], length, length_len);
+    return (uint16_t)(1U + length_len);
+}
+
+/**  @}
+ * End of mqtt_encoder_module group definition
+ */
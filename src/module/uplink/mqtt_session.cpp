@@ -0,0 +1,517 @@
+/**
+ * \file mqtt_session.cpp
+ */
+
+/**
+ *  \defgroup mqtt_session_module MQTT session
+ *
+ *  \brief MQTT session layer: CONNACK, keep-alive and QoS 1 delivery
+ *
+ *  Sits between the uplink, which owns the connection sequence and sends
+ *  the packets through the AT engine, and the MQTT encoder. The session:
+ *
+ *  * decodes the inbound +IPD data - the uplink installs
+ *    MqttSessionReceive() as the AT engine's IPD handler - as a byte stream,
+ *    so a packet split over two frames, or two packets in one frame, are
+ *    handled alike; CONNACK, PUBACK and PINGRESP are acted upon;
+ *  * sends a PINGREQ once nothing was sent for half the keep-alive, and
+ *    expects the PINGRESP, as it expects the CONNACK, within
+ *    MQTT_RESPONSE_TIMEOUT_MS;
+ *  * keeps every QoS 1 PUBLISH in a window of MQTT_INFLIGHT_MAX slots until
+ *    its PUBACK comes. The window is not stop-and-wait: a whole batch goes
+ *    out at once, each packet with its own packet identifier. An
+ *    unacknowledged packet is sent again, with DUP set, every
+ *    MQTT_RETRY_MS, and at once after a reconnection - the window
+ *    survives the link going down.
+ *
+ *  A broker that does not answer - no CONNACK, no PINGRESP, or no PUBACK
+ *  after MQTT_RETRY_MAX retransmissions - leaves the session
+ *  MQTT_SESSION_LOST, for the uplink to reconnect.
+ *
+ *  A caller that must know when a given PUBLISH was delivered - the uplink,
+ *  for the stored readings - takes its packet identifier from
+ *  MqttSessionLastPacketId() and gets it back in the PUBACK handler. The timeouts are
+ *  checked from the medium time task.
+ *
+ *  Packets are encoded into the caller's buffer; the session assumes they
+ *  are sent right away - a failed send is recovered by the retransmissions.
+ *
+ *  @{
+ */
+#include <Arduino.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tasks.h"
+#include "timer.h"
+#include "mqtt_encoder.h"
+#include "mqtt_session.h"
+
+/** MQTT Keep Alive, in s */
+#define MQTT_KEEP_ALIVE_S           60U
+/** Idle time before a PINGREQ, in ms - half the keep-alive */
+#define MQTT_PING_IDLE_MS           (MQTT_KEEP_ALIVE_S * 1000UL / 2U)
+/** Time for the CONNACK or the PINGRESP, in ms */
+#define MQTT_RESPONSE_TIMEOUT_MS    10000U
+/** Time for a PUBACK before the PUBLISH is sent again, in ms */
+#define MQTT_RETRY_MS               5000U
+/** Retransmissions of a PUBLISH before the session is given up */
+#define MQTT_RETRY_MAX              3U
+
+/** Inbound control packet types, fixed header high nibble */
+#define MQTT_CONNACK                0x20U
+#define MQTT_PUBACK                 0x40U
+#define MQTT_PINGRESP               0xD0U
+/** PUBLISH fixed header DUP flag */
+#define MQTT_PUBLISH_DUP            0x08U
+/** Variable header bytes kept from an inbound packet - CONNACK and PUBACK have 2 */
+#define MQTT_RX_BODY_MAX            2U
+
+/**
+ * \brief In-flight QoS 1 PUBLISH
+ */
+typedef struct MqttInFlight
+{
+    const MQTT_TOPIC_t *topic;                      //!< Topic header, in PROGMEM - NULL: free slot
+    uint16_t            packet_id;                  //!< Packet identifier
+    uint32_t            sent;                       //!< System time of the last send
+    uint8_t             retries;                    //!< Retransmissions on this connection
+    uint8_t             payload_len;
+    uint8_t             payload[MQTT_PAYLOAD_MAX];
+} MQTT_INFLIGHT_t;
+
+/**
+ * \brief Inbound stream decoder state
+ */
+typedef enum MqttRxState
+{
+    MQTT_RX_HEADER,     //!< Waiting a fixed header
+    MQTT_RX_LENGTH,     //!< Within the Remaining Length
+    MQTT_RX_BODY,       //!< Within the variable header and payload
+    MQTT_RX_DROP        //!< Malformed stream - ignored until the next connection
+} MQTT_RX_STATE_t;
+
+static MQTT_SESSION_STATE_t session_state = MQTT_SESSION_DOWN;
+static MQTT_INFLIGHT_t inflight[MQTT_INFLIGHT_MAX];
+static uint16_t next_packet_id = 1U;
+/** Packet identifier of the last PUBLISH queued - 0: none yet */
+static uint16_t last_packet_id;
+static MQTT_PUBACK_HANDLER_t puback_handler;
+/** System time of the CONNECT */
+static uint32_t connect_time;
+/** System time of the last packet sent */
+static uint32_t last_sent;
+/** PINGREQ sent, PINGRESP not received yet */
+static bool ping_outstanding;
+static uint32_t ping_time;
+
+static MQTT_RX_STATE_t rx_state = MQTT_RX_HEADER;
+static uint8_t  rx_header;
+static uint16_t rx_remaining;
+static uint8_t  rx_shift;
+static uint8_t  rx_count;
+static uint8_t  rx_body[MQTT_RX_BODY_MAX];
+
+static MQTT_SESSION_STATS_t session_stats;
+
+static void mqttSessionSupervise(void);
+static void mqttSessionSetLost(const char *reason);
+static void mqttReceiveByte(uint8_t c);
+static void mqttPacketReceived(void);
+static void mqttConnackReceived(void);
+static void mqttPubackReceived(void);
+
+/**
+ * Module's tasks runner
+ */
+void MQTT_SESSION_run(TASKS_t running_task)
+{
+    switch(running_task)
+    {
+    case POWERON_TASK:
+        session_state = MQTT_SESSION_DOWN;
+        break;
+    case MEDIUM_TIME_TASK:
+        mqttSessionSupervise();
+        break;
+    default:
+        /* Log internal error */
+        // INTERRLOG("tried to run an unsupported task");
+        break;
+    }
+}
+
+/**
+ * \brief Encodes the CONNECT of a new connection - the TCP link is up
+ *
+ * The session waits the CONNACK from then on.
+ *
+ * @param [out] buffer, size - output buffer
+ * @param [in] client_id - client identifier
+ * @return packet length, 0 if it does not fit
+ */
+uint16_t MqttSessionConnect(uint8_t *buffer, uint16_t size, const char *client_id)
+{
+    uint16_t len = MqttEncodeConnect(buffer, size, client_id, MQTT_KEEP_ALIVE_S, true);
+
+    if (len > 0U)
+    {
+        rx_state = MQTT_RX_HEADER;
+        ping_outstanding = false;
+        connect_time = GetSystemTime();
+        last_sent = connect_time;
+        session_state = MQTT_SESSION_CONNECTING;
+    }
+    return len;
+}
+
+/**
+ * \brief Encodes a QoS 1 PUBLISH and keeps it in the window until its PUBACK
+ *
+ * @param [out] buffer, size - output buffer
+ * @param [in] topic - topic header, in PROGMEM
+ * @param [in] payload, payload_len - application message, up to MQTT_PAYLOAD_MAX bytes
+ * @return packet length, 0 if not connected, the window is full or the packet does not fit
+ */
+uint16_t MqttSessionPublish(uint8_t *buffer, uint16_t size, const MQTT_TOPIC_t *topic, const uint8_t *payload,
+                            uint8_t payload_len)
+{
+    if ((MQTT_SESSION_CONNECTED != session_state) || (payload_len > MQTT_PAYLOAD_MAX))
+    {
+        return 0;
+    }
+
+    MQTT_INFLIGHT_t *slot = NULL;
+    for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    {
+        if (NULL == inflight[i].topic)
+        {
+            slot = &inflight[i];
+            break;
+        }
+    }
+    if (NULL == slot)
+    {
+        session_stats.window_full++;
+        return 0;
+    }
+
+    uint16_t len = MqttEncodePublish(buffer, size, topic, payload, payload_len, MQTT_QOS_1, next_packet_id);
+    if (0U == len)
+    {
+        return 0;
+    }
+
+    slot->topic = topic;
+    slot->packet_id = next_packet_id;
+    last_packet_id = next_packet_id;
+    slot->sent = GetSystemTime();
+    slot->retries = 0;
+    slot->payload_len = payload_len;
+    memcpy(slot->payload, payload, payload_len);
+
+    /* Packet identifiers are non zero */
+    if (0U == ++next_packet_id)
+    {
+        next_packet_id = 1U;
+    }
+    last_sent = slot->sent;
+    session_stats.published++;
+    return len;
+}
+
+/**
+ * \brief Tells the packet identifier of the last PUBLISH queued by MqttSessionPublish()
+ */
+uint16_t MqttSessionLastPacketId(void)
+{
+    return last_packet_id;
+}
+
+/**
+ * \brief Installs the PUBACK handler - called once per PUBLISH, when its PUBACK comes
+ */
+void MqttSessionSetPubackHandler(MQTT_PUBACK_HANDLER_t handler)
+{
+    puback_handler = handler;
+}
+
+/**
+ * \brief Encodes the packets due now: PUBLISH retransmissions, or a PINGREQ
+ *
+ * Call whenever the link is free to send.
+ *
+ * @param [out] buffer, size - output buffer
+ * @return bytes to send, 0 if nothing is due
+ */
+uint16_t MqttSessionPoll(uint8_t *buffer, uint16_t size)
+{
+    uint16_t n = 0;
+
+    if (MQTT_SESSION_CONNECTED != session_state)
+    {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    {
+        MQTT_INFLIGHT_t *slot = &inflight[i];
+        if ((NULL == slot->topic) || !TestTimerExpired(slot->sent, MQTT_RETRY_MS))
+        {
+            continue;
+        }
+        if (slot->retries >= MQTT_RETRY_MAX)
+        {
+            mqttSessionSetLost("no PUBACK");
+            return 0;
+        }
+
+        uint16_t len = MqttEncodePublish(&buffer[n], size - n, slot->topic, slot->payload, slot->payload_len,
+                                         MQTT_QOS_1, slot->packet_id);
+        if (0U == len)
+        {
+            /* The rest goes out at the next call */
+            break;
+        }
+        buffer[n] |= MQTT_PUBLISH_DUP;
+        n += len;
+        slot->sent = GetSystemTime();
+        slot->retries++;
+        session_stats.retransmits++;
+    }
+
+    if ((0U == n) && !ping_outstanding && TestTimerExpired(last_sent, MQTT_PING_IDLE_MS))
+    {
+        n = MqttEncodePingreq(buffer, size);
+        if (n > 0U)
+        {
+            ping_outstanding = true;
+            ping_time = GetSystemTime();
+            session_stats.pings++;
+        }
+    }
+
+    if (n > 0U)
+    {
+        last_sent = GetSystemTime();
+    }
+    return n;
+}
+
+/**
+ * \brief Decodes inbound data - the AT engine's IPD handler
+ */
+void MqttSessionReceive(const uint8_t *data, uint8_t len)
+{
+    for (uint8_t i = 0; i < len; i++)
+    {
+        mqttReceiveByte(data[i]);
+    }
+}
+
+/**
+ * \brief The TCP link went down - the in-flight packets are kept, for the next connection
+ */
+void MqttSessionLinkDown(void)
+{
+    session_state = MQTT_SESSION_DOWN;
+    ping_outstanding = false;
+    rx_state = MQTT_RX_HEADER;
+}
+
+MQTT_SESSION_STATE_t MqttSessionState(void)
+{
+    return session_state;
+}
+
+/**
+ * \brief Tells how many PUBLISH packets await their PUBACK
+ */
+uint8_t MqttSessionInFlight(void)
+{
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    {
+        count += (NULL != inflight[i].topic) ? 1U : 0U;
+    }
+    return count;
+}
+
+void MqttSessionGetStats(MQTT_SESSION_STATS_t *stats)
+{
+    *stats = session_stats;
+}
+
+/**
+ * \brief Prints the session statistics
+ */
+void MqttSessionReportStats(void)
+{
+    Serial.print("[MQTT] connects=");
+    Serial.print(session_stats.connects);
+    Serial.print(" published=");
+    Serial.print(session_stats.published);
+    Serial.print(" acked=");
+    Serial.print(session_stats.acknowledged);
+    Serial.print(" retransmits=");
+    Serial.print(session_stats.retransmits);
+    Serial.print(" window full=");
+    Serial.print(session_stats.window_full);
+    Serial.print(" pings=");
+    Serial.print(session_stats.pings);
+    Serial.print(" lost=");
+    Serial.println(session_stats.lost);
+}
+
+/**
+ * \brief Gives up a session whose broker does not answer
+ */
+static void mqttSessionSupervise(void)
+{
+    if ((MQTT_SESSION_CONNECTING == session_state) && TestTimerExpired(connect_time, MQTT_RESPONSE_TIMEOUT_MS))
+    {
+        mqttSessionSetLost("no CONNACK");
+    }
+    else if ((MQTT_SESSION_CONNECTED == session_state) && ping_outstanding &&
+             TestTimerExpired(ping_time, MQTT_RESPONSE_TIMEOUT_MS))
+    {
+        mqttSessionSetLost("no PINGRESP");
+    }
+}
+
+static void mqttSessionSetLost(const char *reason)
+{
+    Serial.print("[MQTT] session lost: ");
+    Serial.println(reason);
+    session_state = MQTT_SESSION_LOST;
+    ping_outstanding = false;
+    session_stats.lost++;
+}
+
+static void mqttReceiveByte(uint8_t c)
+{
+    switch (rx_state)
+    {
+    case MQTT_RX_HEADER:
+        rx_header = c;
+        rx_remaining = 0;
+        rx_shift = 0;
+        rx_count = 0;
+        rx_state = MQTT_RX_LENGTH;
+        break;
+    case MQTT_RX_LENGTH:
+        if ((rx_shift >= 14U) && (c & 0xFCU))
+        {
+            /* 64KB or more - a 4th length byte, or a 3rd over 3: not from our broker.
+               The packet bounds are lost, so is the rest of the stream */
+            rx_state = MQTT_RX_DROP;
+            mqttSessionSetLost("malformed packet");
+            break;
+        }
+        rx_remaining |= (uint16_t)(c & 0x7FU) << rx_shift;
+        rx_shift += 7U;
+        if (c & 0x80U)
+        {
+            break;
+        }
+        if (0U == rx_remaining)
+        {
+            mqttPacketReceived();
+            rx_state = MQTT_RX_HEADER;
+        }
+        else
+        {
+            rx_state = MQTT_RX_BODY;
+        }
+        break;
+    case MQTT_RX_BODY:
+        if (rx_count < MQTT_RX_BODY_MAX)
+        {
+            rx_body[rx_count] = c;
+        }
+        rx_count++;
+        if (0U == --rx_remaining)
+        {
+            mqttPacketReceived();
+            rx_state = MQTT_RX_HEADER;
+        }
+        break;
+    case MQTT_RX_DROP:
+        break;
+    }
+}
+
+static void mqttPacketReceived(void)
+{
+    switch (rx_header & 0xF0U)
+    {
+    case MQTT_CONNACK:
+        mqttConnackReceived();
+        break;
+    case MQTT_PUBACK:
+        mqttPubackReceived();
+        break;
+    case MQTT_PINGRESP:
+        ping_outstanding = false;
+        break;
+    default:
+        /* No subscriptions - nothing else is expected */
+        break;
+    }
+}
+
+static void mqttConnackReceived(void)
+{
+    if ((MQTT_SESSION_CONNECTING != session_state) || (rx_count < 2U))
+    {
+        return;
+    }
+    if (0U != rx_body[1])
+    {
+        Serial.print("[MQTT] connection refused, code ");
+        Serial.println(rx_body[1]);
+        mqttSessionSetLost("CONNACK refused");
+        return;
+    }
+
+    session_state = MQTT_SESSION_CONNECTED;
+    session_stats.connects++;
+
+    /* Unacknowledged packets of the previous connection go out at once */
+    uint32_t now = GetSystemTime();
+    for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    {
+        inflight[i].sent = now - MQTT_RETRY_MS;
+        inflight[i].retries = 0;
+    }
+}
+
+static void mqttPubackReceived(void)
+{
+    if (rx_count < 2U)
+    {
+        return;
+    }
+
+    uint16_t packet_id = (uint16_t)((rx_body[0] << 8) | rx_body[1]);
+    for (uint8_t i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    {
+        if ((NULL != inflight[i].topic) && (inflight[i].packet_id == packet_id))
+        {
+            inflight[i].topic = NULL;
+            session_stats.acknowledged++;
+            if (NULL != puback_handler)
+            {
+                puback_handler(packet_id);
+            }
+            return;
+        }
+    }
+}
+
+/**  @}
+ * End of mqtt_session_module group definition
+ */
@@ -0,0 +1,545 @@
+/**
+ * \file uplink.cpp
+ */
+
+/**
+ *  \defgroup uplink_module Uplink
+ *
+ *  \brief ESP-01 (AT commands) + MQTT uplink
+ *
+ *  Connects to the Wi-Fi network and to the MQTT broker through the ESP-01,
+ *  and publishes every fresh metric each uplink cycle, with QoS 1. In
+ *  between, the MQTT session layer gets the link to send its PUBLISH
+ *  retransmissions and keep-alive PINGREQs; when the ESP-01 reports the
+ *  link "CLOSED", or the session is lost, the uplink reconnects.
+ *
+ *  Readings that cannot be published - link down, or the MQTT window full
+ *  - go to the EEPROM sample store. Once connected, they are forwarded
+ *  oldest first, UPLINK_REPLAY_BATCH readings at a time, only when the
+ *  MQTT window is empty and no cycle is due, and at most once every
+ *  UPLINK_REPLAY_PERIOD_MS - live data keeps priority. A reading taken
+ *  since power on is published to its metric's topic as Ubidots JSON, with
+ *  its age: {"value":24.50,"context":{"age":312}}. The readings found in
+ *  the store at power on have no known age, and go to the metric's
+ *  "_undated" topic instead, so they never land out of place in the live
+ *  series. A stored reading is forwarded only once the broker acknowledged
+ *  its PUBLISH - the session's PUBACK handler - and is handed out again
+ *  otherwise.
+ *
+ *  The DHT read error counters - timeouts by phase and checksum failures -
+ *  are published to topics of their own, once per cycle at most, when
+ *  they changed and the cycle's metrics were acknowledged.
+ *
+ *  The metrics of a cycle are batched: their PUBLISH packets are encoded
+ *  back to back and go out in a single AT+CIPSEND, so publishing all of
+ *  them costs one ESP-01 round trip, as publishing one did.
+ *
+ *  The AT commands go through the AT engine, which owns the ESP-01 link;
+ *  the uplink sequence is a protothread resumed by the medium time task,
+ *  queueing one command at a time and waiting for its result, so waiting
+ *  for the ESP-01 never blocks the other tasks.
+ *
+ *  @{
+ */
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+#include "tasks.h"
+#include "timer.h"
+#include "protothread.h"
+#include "at_engine.h"
+#include "mqtt_encoder.h"
+#include "mqtt_session.h"
+#include "uplink.h"
+#include "mcu_temperature_access.h"
+#include "fast_pin.h"
+#include "sensor_cache.h"
+#include "sample_store.h"
+#include "dht11_access.h"
+
+/** Uplink cycle, in ms - MQTT Keep-Alive is 60s */
+#define UPLINK_CYCLE_MS     20000U
+/** CIPSEND '>' prompt timeout, then "SEND OK" timeout, in ms */
+#define SEND_TIMEOUT_MS      3000U
+/** Metrics published per uplink cycle */
+#define UPLINK_METRIC_COUNT     4U
+/** DHT read error counters published */
+#define UPLINK_DHT_ERROR_COUNT  4U
+/** Longest value published live, in bytes: a dtostrf() metric, or a counter */
+#define UPLINK_VALUE_MAX        9U
+/** MQTT client identifier */
+#define MQTT_CLIENT_ID         "A1"
+/** Wait before reconnecting a lost link, in ms */
+#define UPLINK_RECONNECT_MS  5000U
+/** Stored readings forwarded at a time, and the least time between two batches of them, in ms */
+#define UPLINK_REPLAY_BATCH     2U
+#define UPLINK_REPLAY_PERIOD_MS 1000U
+/** Fan relay - active low */
+#define FAN_GPIO               4U
+/** Oldest DHT reading still published or used for fan control, in ms - the
+ *  very slow task requests a measurement every second */
+#define DHT_MAX_AGE_MS      10000U
+/** Oldest MCU temperature reading still published, in ms - it is refreshed every second */
+#define MCU_MAX_AGE_MS       3000U
+
+static constexpr MQTT_TOPIC_t topics[UPLINK_METRIC_COUNT] PROGMEM = {MQTT_TOPIC("/v1.6/devices/central_conforto/dhtemp"),
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/mcu_temp"),
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/loud"),
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/umidade")};
+/** Topics of the stored readings of unknown age, metric by metric */
+static constexpr MQTT_TOPIC_t undated_topics[UPLINK_METRIC_COUNT] PROGMEM = {
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/dhtemp_undated"),
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/mcu_temp_undated"),
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/loud_undated"),
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/umidade_undated")};
+static constexpr MQTT_TOPIC_t dht_error_topics[UPLINK_DHT_ERROR_COUNT] PROGMEM = {
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/dht_to_resp"),
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/dht_to_ready"),
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/dht_to_data"),
+                                                MQTT_TOPIC("/v1.6/devices/central_conforto/dht_checksum")};
+
+/** Longest topic name of 'table', from entry i on */
+static constexpr uint16_t uplinkLongestTopic(const MQTT_TOPIC_t *table, uint8_t count, uint8_t i)
+{
+    return (i >= count) ? 0U :
+           (((uint16_t)((table[i].length[0] << 8) | table[i].length[1]) > uplinkLongestTopic(table, count, i + 1U)) ?
+            (uint16_t)((table[i].length[0] << 8) | table[i].length[1]) : uplinkLongestTopic(table, count, i + 1U));
+}
+
+static constexpr uint16_t uplinkMax(uint16_t a, uint16_t b)
+{
+    return (a > b) ? a : b;
+}
+
+/** Largest PUBLISH packet of a cycle: header (2), topic (2 + longest name), packet identifier (2), value */
+static constexpr uint16_t PUBLISH_PACKET_MAX =
+    2U + 2U + uplinkMax(uplinkLongestTopic(topics, UPLINK_METRIC_COUNT, 0U),
+                        uplinkLongestTopic(dht_error_topics, UPLINK_DHT_ERROR_COUNT, 0U)) + 2U + UPLINK_VALUE_MAX;
+/** Largest PUBLISH packet of a stored reading: the topic as above, or undated, and a JSON payload */
+static constexpr uint16_t REPLAY_PACKET_MAX =
+    2U + 2U + uplinkMax(uplinkLongestTopic(topics, UPLINK_METRIC_COUNT, 0U),
+                        uplinkLongestTopic(undated_topics, UPLINK_METRIC_COUNT, 0U)) + 2U + MQTT_PAYLOAD_MAX;
+
+static_assert(UPLINK_DHT_ERROR_COUNT <= MQTT_INFLIGHT_MAX, "the DHT error counters go out in one batch");
+static_assert(REPLAY_PACKET_MAX - 2U < 128U, "the packet sizes above assume a 1 byte Remaining Length");
+static_assert(UPLINK_REPLAY_BATCH * REPLAY_PACKET_MAX <= UPLINK_METRIC_COUNT * PUBLISH_PACKET_MAX,
+              "a batch of stored readings must fit batch_packets");
+
+const int   MQTT_PORT   = 1883;
+const char* MQTT_BROKER = "192.168.15.50"; //endereço do broker MQTT HiveMQ
+
+/** Main uplink sequence */
+static PT_t uplink_pt;
+/** Connection sequence */
+static PT_t connect_pt;
+/** Result of the AT command being waited for */
+static AT_RESULT_t step_result;
+
+/* Packets - protothread locals do not survive a wait */
+static uint8_t  batch_packets[UPLINK_METRIC_COUNT * PUBLISH_PACKET_MAX];
+static uint16_t batch_len;
+static uint8_t  batch_count;
+/** Batch of stored readings */
+static bool     batch_replay;
+/** Batch of DHT error counters */
+static bool     batch_dht_errors;
+/** Stored readings of the last batch: packet identifier - 0 once acknowledged - and store slot */
+static uint16_t replay_packet_ids[UPLINK_REPLAY_BATCH];
+static uint8_t  replay_slots[UPLINK_REPLAY_BATCH];
+/** System time of the last uplink cycle */
+static uint32_t cycle_time;
+/** Uplink cycle due, not run yet */
+static bool     cycle_due;
+/** System time of the last forwarding of stored readings */
+static uint32_t replay_time;
+/** DHT error counters due this cycle, and their last published values */
+static bool     dht_errors_due;
+static uint16_t dht_errors_sent[UPLINK_DHT_ERROR_COUNT];
+
+static PT_THREAD(uplinkThread(PT_t *pt));
+static PT_THREAD(connectThread(PT_t *pt));
+static void uplinkFanControl(void);
+static void uplinkCycle(void);
+static void uplinkBatchAppend(uint8_t metric, const char *text, float value);
+static void uplinkReplay(void);
+static void uplinkPuback(uint16_t packet_id);
+static void uplinkDhtErrors(void);
+static void uplinkCommand(const char *command, uint16_t timeout_ms);
+static void uplinkSend(const uint8_t *data, uint16_t len);
+static void uplinkLinkClosed(void);
+
+/**
+ * Module's tasks runner
+ */
+void UPLINK_run(TASKS_t running_task)
+{
+    switch(running_task)
+    {
+    case POWERON_TASK:
+        AtEngineSetHandlers(&MqttSessionReceive, &uplinkLinkClosed);
+        MqttSessionSetPubackHandler(&uplinkPuback);
+        PT_INIT(&uplink_pt);
+        break;
+    case MEDIUM_TIME_TASK:
+        /* Runs with the link up or down */
+        if (TestTimerExpired(cycle_time, UPLINK_CYCLE_MS))
+        {
+            cycle_time = GetSystemTime();
+            cycle_due = true;
+            dht_errors_due = true;
+            uplinkFanControl();
+        }
+        uplinkThread(&uplink_pt);
+        if (cycle_due && (MQTT_SESSION_CONNECTED != MqttSessionState()))
+        {
+            /* Link down - the readings go to the store */
+            cycle_due = false;
+            uplinkCycle();
+        }
+        break;
+    default:
+        /* Log internal error */
+        // INTERRLOG("tried to run an unsupported task");
+        break;
+    }
+}
+
+/**
+ * Main uplink sequence: joins the Wi-Fi network, connects, then runs the
+ *   uplink cycles while the MQTT session holds, reconnecting otherwise.
+ */
+static PT_THREAD(uplinkThread(PT_t *pt))
+{
+    PT_BEGIN(pt);
+
+    // Let the ESP-01 boot
+    PT_WAIT_MS(pt, 1000);
+
+    // 0. IMPORTANT: Turn off echo so "AT+CIPSEND" doesn't end up in the MQTT stream
+    uplinkCommand("ATE0", 1000);
+    PT_WAIT_UNTIL(pt, AT_PENDING != step_result);
+
+    // 1. Connect to WiFi
+    uplinkCommand("AT+CWJAP=\"ponto_de_rede\",\"senha\"", 8000);
+    PT_WAIT_UNTIL(pt, AT_PENDING != step_result);
+
+    for (;;)
+    {
+        PT_SPAWN(pt, &connect_pt, connectThread(&connect_pt));
+
+        while (MQTT_SESSION_CONNECTED == MqttSessionState())
+        {
+            /* Retransmissions first, then new metrics, DHT error counters, stored ones; PINGREQ when idle */
+            batch_count = 0;
+            batch_replay = false;
+            batch_dht_errors = false;
+            batch_len = MqttSessionPoll(batch_packets, sizeof(batch_packets));
+            if ((0U == batch_len) && cycle_due)
+            {
+                cycle_due = false;
+                uplinkCycle();
+            }
+            else if ((0U == batch_len) && dht_errors_due && (0U == MqttSessionInFlight()))
+            {
+                dht_errors_due = false;
+                uplinkDhtErrors();
+            }
+            else if ((0U == batch_len) && (SampleStoreCount() > 0U) && (0U == MqttSessionInFlight()) &&
+                     TestTimerExpired(replay_time, UPLINK_REPLAY_PERIOD_MS))
+            {
+                replay_time = GetSystemTime();
+                uplinkReplay();
+            }
+
+            if (batch_len > 0U)
+            {
+                uplinkSend(batch_packets, batch_len);
+                PT_WAIT_UNTIL(pt, AT_PENDING != step_result);
+                if (AT_OK != step_result)
+                {
+                    MqttSessionLinkDown();
+                }
+                else if (batch_replay)
+                {
+                    Serial.print(" -> Stored Injected: ");
+                    Serial.print(batch_count);
+                    Serial.print(" readings, ");
+                    Serial.print(SampleStoreCount());
+                    Serial.println(" left");
+                }
+                else if (batch_dht_errors)
+                {
+                    Serial.print(" -> DHT Errors Injected: ");
+                    Serial.print(batch_count);
+                    Serial.println(" counters");
+                }
+                else if (batch_count > 0U)
+                {
+                    Serial.print(" -> Batch Injected: ");
+                    Serial.print(batch_count);
+                    Serial.print(" metrics, ");
+                    Serial.print(batch_len);
+                    Serial.println(" bytes");
+                }
+                batch_len = 0;
+            }
+            PT_YIELD(pt);
+        }
+
+        Serial.println("MQTT link lost, reconnecting.");
+        PT_WAIT_MS(pt, UPLINK_RECONNECT_MS);
+    }
+
+    PT_END(pt);
+}
+
+/**
+ * Connection sequence: TCP connection, then MQTT CONNECT - on return the
+ *   session is connected, or not, to be retried.
+ */
+static PT_THREAD(connectThread(PT_t *pt))
+{
+    PT_BEGIN(pt);
+
+    // 1. Close any ghost connections
+    uplinkCommand("AT+CIPCLOSE", 1000);
+    PT_WAIT_UNTIL(pt, AT_PENDING != step_result);
+    /* "CLOSED" of our own AT+CIPCLOSE is not a failure of the new link */
+    MqttSessionLinkDown();
+
+    // 2. Open TCP Connection
+    uplinkCommand("AT+CIPSTART=\"TCP\",\"192.168.xx.xx\",1883", 4000);
+    PT_WAIT_UNTIL(pt, AT_PENDING != step_result);
+    if (AT_OK != step_result)
+    {
+        PT_EXIT(pt);
+    }
+
+    // 3. Send MQTT CONNECT Packet (Binary)
+    uplinkSend(batch_packets, MqttSessionConnect(batch_packets, sizeof(batch_packets), MQTT_CLIENT_ID));
+    PT_WAIT_UNTIL(pt, AT_PENDING != step_result);
+    if (AT_OK != step_result)
+    {
+        MqttSessionLinkDown();
+        PT_EXIT(pt);
+    }
+    PT_WAIT_WHILE(pt, MQTT_SESSION_CONNECTING == MqttSessionState());
+
+    if (MQTT_SESSION_CONNECTED == MqttSessionState())
+    {
+        Serial.println("MQTT Connected.");
+    }
+
+    PT_END(pt);
+}
+
+/**
+ * Controls the fan from the DHT temperature
+ */
+static void uplinkFanControl(void)
+{
+    float dht_temp = 0.0f;
+
+    /* A stale reading is not acted upon */
+    if (SensorCacheGetFresh(SENSOR_DHT_TEMPERATURE, DHT_MAX_AGE_MS, &dht_temp))
+    {
+        if (dht_temp > 30)
+        {
+            FastPin<FAN_GPIO>::clear(); // Ligar ventilador
+        } else if (dht_temp < 29)
+        {
+            FastPin<FAN_GPIO>::set(); // Desligar ventilador
+        }
+    }
+}
+
+/**
+ * Samples the metrics and encodes this cycle's batch: one QoS 1 PUBLISH
+ *   packet per fresh metric, in batch_packets - or, if not connected,
+ *   stores them.
+ */
+static void uplinkCycle(void)
+{
+    /* Cached readings - stale ones are not published */
+    float dht_temp = 0.0f;
+    float humidity = 0.0f;
+    float mcu_temp = 0.0f;
+    bool dht_temp_fresh = SensorCacheGetFresh(SENSOR_DHT_TEMPERATURE, DHT_MAX_AGE_MS, &dht_temp);
+    bool humidity_fresh = SensorCacheGetFresh(SENSOR_DHT_HUMIDITY, DHT_MAX_AGE_MS, &humidity);
+    /* Refreshed every second by the MCU temperature module */
+    bool mcu_temp_fresh = SensorCacheGetFresh(SENSOR_MCU_TEMPERATURE, MCU_MAX_AGE_MS, &mcu_temp);
+
+    Serial.println((MQTT_SESSION_CONNECTED == MqttSessionState()) ? "Publishing..." : "Storing...");
+
+    char value[UPLINK_VALUE_MAX + 1U];
+    batch_len = 0;
+    batch_count = 0;
+
+    if (dht_temp_fresh)
+    {
+        dtostrf(dht_temp, 4, 2, value);
+        Serial.print("Publicar DHT temp: ");
+        Serial.println(value);
+        uplinkBatchAppend(0, value, dht_temp);
+    }
+    if (mcu_temp_fresh)
+    {
+        dtostrf(mcu_temp, 4, 2, value);
+        Serial.print("Publicar MCU temp: ");
+        Serial.println(value);
+        uplinkBatchAppend(1, value, mcu_temp);
+    }
+    uplinkBatchAppend(2, IsSoundAlarm() ? "1" : "0", IsSoundAlarm() ? 1.0f : 0.0f);
+    if (humidity_fresh)
+    {
+        dtostrf(humidity, 4, 2, value);
+        Serial.print("Publicar Umidade: ");
+        Serial.println(value);
+        uplinkBatchAppend(3, value, humidity);
+    }
+}
+
+// Appends a PUBLISH of a metric to the batch - or, if that fails, stores it
+static void uplinkBatchAppend(uint8_t metric, const char *text, float value)
+{
+    uint16_t len = 0;
+
+    if (MQTT_SESSION_CONNECTED == MqttSessionState())
+    {
+        len = MqttSessionPublish(&batch_packets[batch_len], sizeof(batch_packets) - batch_len, &topics[metric],
+                                 (const uint8_t *)text, (uint8_t)strlen(text));
+    }
+    if (0U == len)
+    {
+        if (!SampleStoreAppend(metric, SensorEncode(value)))
+        {
+            Serial.println("[UPLINK] store queue full, metric dropped");
+        }
+        return;
+    }
+    batch_len += len;
+    batch_count++;
+}
+
+// Appends the oldest stored readings to the batch, as Ubidots JSON - the window is empty
+static void uplinkReplay(void)
+{
+    STORED_SAMPLE_t sample;
+    char payload[MQTT_PAYLOAD_MAX + 1U];
+
+    /* Nothing in flight: the readings handed out and not acknowledged go again */
+    SampleStoreRewind();
+    memset(replay_packet_ids, 0, sizeof(replay_packet_ids));
+
+    batch_len = 0;
+    batch_replay = true;
+    while ((batch_count < UPLINK_REPLAY_BATCH) && SampleStoreNext(&sample))
+    {
+        if (sample.metric >= UPLINK_METRIC_COUNT)
+        {
+            /* Readings of an unknown metric are dropped */
+            SampleStoreAcknowledge(sample.slot);
+            continue;
+        }
+
+        int16_t centi = (int16_t)(sample.value - SENSOR_ENCODING_OFFSET);
+        uint16_t magnitude = (uint16_t)((centi < 0) ? -centi : centi);
+        int n = snprintf(payload, sizeof(payload), "{\"value\":%s%u.%02u", (centi < 0) ? "-" : "",
+                         magnitude / 100U, magnitude % 100U);
+        if (sample.aged)
+        {
+            snprintf(&payload[n], sizeof(payload) - n, ",\"context\":{\"age\":%lu}}", (unsigned long)sample.age);
+        }
+        else
+        {
+            snprintf(&payload[n], sizeof(payload) - n, "}");
+        }
+
+        const MQTT_TOPIC_t *topic = sample.aged ? &topics[sample.metric] : &undated_topics[sample.metric];
+        uint16_t len = MqttSessionPublish(&batch_packets[batch_len], sizeof(batch_packets) - batch_len, topic,
+                                          (const uint8_t *)payload, (uint8_t)strlen(payload));
+        if (0U == len)
+        {
+            /* No room - the next time */
+            break;
+        }
+        replay_packet_ids[batch_count] = MqttSessionLastPacketId();
+        replay_slots[batch_count] = sample.slot;
+        batch_len += len;
+        batch_count++;
+    }
+}
+
+// The broker acknowledged a PUBLISH - a stored reading is forwarded once its PUBACK comes
+static void uplinkPuback(uint16_t packet_id)
+{
+    for (uint8_t i = 0; i < UPLINK_REPLAY_BATCH; i++)
+    {
+        if (replay_packet_ids[i] == packet_id)
+        {
+            replay_packet_ids[i] = 0;
+            SampleStoreAcknowledge(replay_slots[i]);
+            return;
+        }
+    }
+}
+
+// Appends the DHT read error counters to the batch, if any changed since last published
+static void uplinkDhtErrors(void)
+{
+    DHT_STATS_t stats;
+    Dht11GetStats(&stats);
+    const uint16_t errors[UPLINK_DHT_ERROR_COUNT] = {stats.timeout_response, stats.timeout_ready,
+                                                     stats.timeout_data, stats.checksum_errors};
+
+    if (0 == memcmp(errors, dht_errors_sent, sizeof(errors)))
+    {
+        return;
+    }
+
+    char value[6];
+    batch_len = 0;
+    batch_dht_errors = true;
+    for (uint8_t i = 0; i < UPLINK_DHT_ERROR_COUNT; i++)
+    {
+        snprintf(value, sizeof(value), "%u", errors[i]);
+        uint16_t len = MqttSessionPublish(&batch_packets[batch_len], sizeof(batch_packets) - batch_len,
+                                          &dht_error_topics[i], (const uint8_t *)value, (uint8_t)strlen(value));
+        if (0U == len)
+        {
+            /* Not published - tried again next cycle */
+            return;
+        }
+        batch_len += len;
+        batch_count++;
+        dht_errors_sent[i] = errors[i];
+    }
+}
+
+// Queues an AT command - the result comes in 'step_result'
+static void uplinkCommand(const char *command, uint16_t timeout_ms)
+{
+    if (!AtEngineCommand(command, timeout_ms, &step_result))
+    {
+        step_result = AT_ERROR;
+    }
+}
+
+// Queues 'len' bytes of 'data' for AT+CIPSEND - the result comes in 'step_result'
+static void uplinkSend(const uint8_t *data, uint16_t len)
+{
+    if ((0U == len) || !AtEngineSend(data, len, SEND_TIMEOUT_MS, &step_result))
+    {
+        step_result = AT_ERROR;
+    }
+}
+
+// The ESP-01 reported the TCP link "CLOSED"
+static void uplinkLinkClosed(void)
+{
+    MqttSessionLinkDown();
+}
+
+/**  @}
+ * End of uplink_module group definition
+ */
@@ -10,15 +10,25 @@
  *  The scheduler is implemented by two main functions. One of them - SetTasksFlags() -
  *      runs periodically (at each 1ms) called by SysTick timer interrupt, and uses
  *      several milliseconds counters to trigger a number of predefined periodic
- *      tasks - a task triggering is performed simply by setting a "pending"
- *      task flag, associated to that task.\n
- *  The second function - RunMainLoop() - just runs an endless loop that pools the
- *      "pending" flags set by the first function. When a set "pending" flag is found,
- *      it is cleared, and it's corresponding task function is executed.
+ *      tasks - a task triggering is performed simply by setting the task's
+ *      "pending" bit, in a single pending tasks bitmask.\n
+ *  The second function - RunMainLoop() - is called from an endless loop, and
+ *      checks the "pending" bitmask set by the first function. The highest
+ *      priority pending bit is found, cleared, and it's corresponding task
+ *      function is executed.
  *
- *  * Since the loop pools the higher frequency task flags first, and only one
- *    task function is ran at each loop iteration, the higher frequency task
- *    have priority over the lower frequency ones.
+ *  * Periodic tasks are declared in a single, compile-time task table -
+ *    sched_tasks[] - each entry holding the task period, priority and
+ *    task function. Adding a task means adding one line to the table.
+ *  * The table is ordered by period, and each period must be a multiple of
+ *    the previous one; this is checked at compile time. Task counters are
+ *    cascaded - a task counter is only advanced when the previous (faster)
+ *    task is triggered - so the per-tick cost of SetTasksFlags() stays
+ *    nearly flat as tasks are added.
+ *  * A task's priority is its bit position in the pending bitmask - bit 0
+ *    is the highest priority. Dispatching is a "find first set" over the
+ *    bitmask, so only one task function is ran at each loop iteration,
+ *    and the highest priority ready task always goes first.
  *  * Tasks are implemented as dedicate functions - named after
  *    "void RunModuleName(void)" pattern.
  *  * Task functions call, one at a time, all modules' "runner" functions,
@@ -26,12 +36,26 @@
  *    calling task as argument. Each module's "runner" function will
  *    perform, at module level, actions as required for caller task.
  *  * There are also additional provisions for "missed task" detection and to
- *    measure each task execution time.
+ *    measure each task execution time - min/max/mean and a log4 histogram
+ *    per task, from the microseconds timebase - see SchedulerReportStats().
+ *  * Interrupt handlers post events - SchedulerPostEvent() - into a lock-free
+ *    single producer, single consumer ring. RunMainLoop() drains it ahead of
+ *    any other work, running the event task declared for each event in
+ *    sched_event_tasks[], so an edge is handled within one loop pass instead
+ *    of at the next periodic activation.
+ *  * Expired software timers (see SoftTimerArm()) have their callbacks ran
+ *    by RunMainLoop() ahead of any periodic task.
+ *  * When no task is pending, RunMainLoop() puts the CPU in idle sleep until
+ *    the next interrupt - the 1ms tick, a serial byte, etc. Each tick checks
+ *    whether it woke the CPU from that idle sleep; the number of such "idle
+ *    ticks" in each 1s window gives the CPU load - see SchedulerGetCpuLoad().
  *
  * @{
  */
 
 #include <Arduino.h>
+#include <util/atomic.h>
+#include <avr/sleep.h>
 
 // #include "system.h"
 
@@ -39,15 +63,12 @@
 #include "timer.h"
 
 #include "scheduler.h"
+#ifdef WATCHDOG
+#include "watchdog.h"
+#endif
 // #include "gpio_access.h"
 // #include "panel.h"
 
-/* ******************* ATTENTION: *******************
- * FAST_TIME_TASK_PERIOD   *must* be less than MEDIUM_TIME_TASK_PERIOD
- * MEDIUM_TIME_TASK_PERIOD *must* be less than SLOW_TIME_TASK_PERIOD
- * SLOW_TIME_TASK_PERIOD   *must* be less than VERY_SLOW_TIME_TASK_PERIOD
- */
-
 
 /** Fast time task period in ms */
 #define FAST_TIME_TASK_PERIOD         5
@@ -58,71 +79,194 @@
 /** Very slow time task period in ms */
 #define VERY_SLOW_TIME_TASK_PERIOD 1000
 
-/** Pending fast time task flag */
-static bool fastTimeTaskPending;
-/** Pending medium time task flag */
-static bool mediumTimeTaskPending;
-/** Pending slow time task flag */
-static bool slowTimeTaskPending;
-/** Pending very slow time task flag */
-static bool verySlowTimeTaskPending;
+/** CPU load measurement window, in ticks (ms) */
+#define CPU_LOAD_WINDOW           1000U
+
+/** Event ring size - must be a power of two, up to 128 */
+#define SCHED_EVENT_QUEUE_SIZE       8U
+#define SCHED_EVENT_QUEUE_MASK (SCHED_EVENT_QUEUE_SIZE - 1U)
+
+/** Keeps the compiler from moving memory accesses across this point */
+#define SCHED_COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/** Pending tasks bitmask type - one bit per task */
+typedef uint8_t SCHED_MASK_t;
+
+/**
+ * \brief Periodic task descriptor
+ */
+typedef struct SchedTask
+{
+    uint16_t period;        //!< Activation period, in ms
+    uint8_t  priority;      //!< Pending bit position - 0 is the highest priority
+    TASKS_t  task;          //!< Task identifier
+    void   (*runner)(void); //!< Task function
+} SCHED_TASK_t;
+
+/**
+ * \brief Periodic tasks table
+ *
+ * Entries *must* be ordered by period, and each period *must* be a
+ *   multiple of the previous entry's period (checked below).
+ */
+static constexpr SCHED_TASK_t sched_tasks[] =
+{
+    { FAST_TIME_TASK_PERIOD,      0, FAST_TIME_TASK,      &RunFastTimeTask     },
+    { MEDIUM_TIME_TASK_PERIOD,    1, MEDIUM_TIME_TASK,    &RunMediumTimeTask   },
+    { SLOW_TIME_TASK_PERIOD,      2, SLOW_TIME_TASK,      &RunSlowTimeTask     },
+    { VERY_SLOW_TIME_TASK_PERIOD, 3, VERY_SLOW_TIME_TASK, &RunVerySlowTimeTask },
+};
+
+/**
+ * \brief Event task descriptor
+ */
+typedef struct SchedEventTask
+{
+    EVENTS_t event;                 //!< Triggering event
+    void   (*runner)(uint8_t data); //!< Event task function, gets the posted data
+} SCHED_EVENT_TASK_t;
+
+/**
+ * \brief Event tasks table
+ *
+ * One entry per event, in EVENTS_t order (checked below).
+ */
+static constexpr SCHED_EVENT_TASK_t sched_event_tasks[] =
+{
+    { SOUND_DETECTED_EVENT, &RunSoundEventTask },
+};
+
+/**
+ * \brief Posted event
+ */
+typedef struct SchedEvent
+{
+    uint8_t  event;     //!< EVENTS_t
+    uint8_t  data;      //!< Event data, passed to the event task
+    uint32_t post_time; //!< Posting time, in microseconds
+} SCHED_EVENT_t;
+
+/** Number of periodic tasks */
+#define SCHED_TASK_COUNT (sizeof(sched_tasks) / sizeof(sched_tasks[0]))
+/** Number of available priorities (pending bits) */
+#define SCHED_PRIORITY_COUNT (8U * sizeof(SCHED_MASK_t))
+
+/** Checks periods are increasing multiples of each other, from entry i on */
+static constexpr bool schedPeriodsCascade(uint8_t i)
+{
+    return (i >= SCHED_TASK_COUNT) ||
+           ((sched_tasks[i].period > sched_tasks[i - 1U].period) &&
+            ((sched_tasks[i].period % sched_tasks[i - 1U].period) == 0U) &&
+            schedPeriodsCascade(i + 1U));
+}
+
+/** Checks priority 'priority' is used by no entry after entry i */
+static constexpr bool schedPriorityFreeFrom(uint8_t priority, uint8_t i)
+{
+    return (i >= SCHED_TASK_COUNT) ||
+           ((sched_tasks[i].priority != priority) && schedPriorityFreeFrom(priority, i + 1U));
+}
+
+/** Checks priorities are in range and unique, from entry i on */
+static constexpr bool schedPrioritiesValid(uint8_t i)
+{
+    return (i >= SCHED_TASK_COUNT) ||
+           ((sched_tasks[i].priority < SCHED_PRIORITY_COUNT) &&
+            schedPriorityFreeFrom(sched_tasks[i].priority, i + 1U) &&
+            schedPrioritiesValid(i + 1U));
+}
+
+/** Checks event tasks are declared in event order, from entry i on */
+static constexpr bool schedEventTasksOrdered(uint8_t i)
+{
+    return (i >= EVENT_COUNT) ||
+           ((sched_event_tasks[i].event == (EVENTS_t)i) && schedEventTasksOrdered(i + 1U));
+}
+
+static_assert((sizeof(sched_event_tasks) / sizeof(sched_event_tasks[0])) == EVENT_COUNT,
+              "one event task per event");
+static_assert(schedEventTasksOrdered(0U), "event tasks must be declared in EVENTS_t order");
+static_assert(((SCHED_EVENT_QUEUE_SIZE & SCHED_EVENT_QUEUE_MASK) == 0U) && (SCHED_EVENT_QUEUE_SIZE <= 128U),
+              "event ring size must be a power of two, up to 128");
+static_assert(SCHED_TASK_COUNT <= SCHED_PRIORITY_COUNT, "too many tasks for the pending bitmask");
+static_assert(sched_tasks[0].period > 0U, "task periods must be non-zero");
+static_assert(schedPeriodsCascade(1U), "task periods must be increasing multiples of the previous entry's period");
+static_assert(schedPrioritiesValid(0U), "task priorities must be unique and fit the pending bitmask");
+
+/** Lowest set bit of a nibble (index 0 unused) */
+static const uint8_t lowest_bit_lut[16] = {0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0};
+
+/** Pending tasks bitmask, set by SetTasksFlags() */
+static volatile SCHED_MASK_t pending_tasks;
 /** Pending power off event task flag */
-static bool powerOffEventTaskPending;
-
-/** Fast time task control counter */
-static unsigned int fast_time_task_sched_cntr;
-/** Medium time task control counter */
-static unsigned int medium_time_task_sched_cntr;
-/** Slow time task control counter */
-static unsigned int slow_time_task_sched_cntr;
-/** Very slow time task control counter */
-static unsigned int very_slow_time_task_sched_cntr;
-
-/** Fast time missed task counter */
-static unsigned int missed_fast_time_task_cntr;
-/** Medium time missed task counter */
-static unsigned int missed_medium_time_task_cntr;
-/** Slow time missed task counter */
-static unsigned int missed_slow_time_task_cntr;
-/** Very slow time missed task counter */
-static unsigned int missed_very_slow_time_task_cntr;
-
-/** Fast_time task start time, for CPU load monitoring */
-static uint64_t fast_time_task_start_time;
-/** Medium_time task start time, for CPU load monitoring */
-static uint64_t medium_time_task_start_time;
-/** Slow_time task start time, for CPU load monitoring */
-static uint64_t slow_time_task_start_time;
-/** Very slow_time task start time, for CPU load monitoring */
-static uint64_t very_slow_time_task_start_time;
-/** Power on event task start time, for CPU load monitoring */
-static uint64_t power_on_event_task_start_time;
-/** Power off event task start time, for CPU load monitoring */
-static uint64_t power_off_event_task_start_time;
-
-/** Fast time task run time, in microseconds */
-static volatile uint64_t fast_time_task_run_time;
-/** Medium time task run time, in microseconds */
-static volatile uint64_t medium_time_task_run_time;
-/** Slow time task run time, in microseconds */
-static volatile uint64_t slow_time_task_run_time;
-/** Very slow time task run time, in microseconds */
-static volatile uint64_t very_slow_time_task_run_time;
+static volatile bool powerOffEventTaskPending;
+
+/** Table index of the task owning each priority */
+static uint8_t task_by_priority[SCHED_PRIORITY_COUNT];
+
+/** Time tasks control counters, in ms */
+static uint16_t task_sched_cntr[SCHED_TASK_COUNT];
+/** Time tasks missed task counters */
+static unsigned int missed_task_cntr[SCHED_TASK_COUNT];
+
+/**
+ * \brief Run time accumulators of a periodic task
+ */
+typedef struct SchedRunTime
+{
+    uint32_t runs;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint16_t histogram[SCHED_HIST_BUCKETS];
+} SCHED_RUN_TIME_t;
+
+/** Time tasks run time statistics */
+static SCHED_RUN_TIME_t task_run_time[SCHED_TASK_COUNT];
+
+/**
+ * \brief Event ring
+ *
+ * Indexes are free running - the slot is index & SCHED_EVENT_QUEUE_MASK.
+ *   event_head is only written by the producer, event_tail only by the
+ *   consumer, and both are single byte - atomic on the AVR - so no lock is
+ *   needed. Interrupt handlers do not nest, so all of them together are the
+ *   single producer; RunMainLoop() is the single consumer.
+ */
+static SCHED_EVENT_t event_queue[SCHED_EVENT_QUEUE_SIZE];
+static volatile uint8_t event_head;
+static volatile uint8_t event_tail;
+/** Events dropped because the ring was full */
+static volatile uint16_t lost_events;
+/** Event tasks run time statistics */
+static SCHED_RUN_TIME_t event_run_time[EVENT_COUNT];
+/** Longest post to dispatch latency, per event, in microseconds */
+static uint32_t event_max_latency[EVENT_COUNT];
 /** Power on event task run time, in microseconds */
-static volatile uint64_t power_on_event_task_run_time;
+static uint32_t power_on_event_task_run_time;
 /** Power off event task run time, in microseconds */
-static volatile uint64_t power_off_event_task_run_time;
+static volatile uint32_t power_off_event_task_run_time;
 
 /** Global tasks enable flag */
-static bool tasks_enabled;
+static volatile bool tasks_enabled;
+
+/** CPU is sleeping in the idle hook */
+static volatile bool cpu_idle;
+/** Ticks of the current window that found the CPU idle */
+static uint16_t idle_tick_cntr;
+/** Ticks elapsed in the current window */
+static uint16_t load_window_cntr;
+/** Idle ticks of the last complete window */
+static volatile uint16_t last_window_idle_ticks;
 
 /*******************************/
 /* Local function declarations */
 /*******************************/
-static void setFastTimeTaskFlag(void);
-static void setMediumTimeTaskFlag(void);
-static void setSlowTimeTaskFlag(void);
-static void setVerySlowTimeTaskFlag(void);
+static bool eventPending(void);
+static void dispatchEvent(void);
+static uint8_t findFirstSet(SCHED_MASK_t mask);
+static void idleUntilInterrupt(void);
+static void recordRunTime(SCHED_RUN_TIME_t *stats, uint32_t run_time);
 
 /****************************/
 /* Functions implementation */
@@ -133,200 +277,303 @@ static void setVerySlowTimeTaskFlag(void);
  *
  * SetTasksFlags() is called, periodically (at each 1ms), by the SysTick time
  *     IRQ Handler function. It controls all system tasks execution timing.
- * * Increments one milliseconds counter for each time based, periodic task;\n
- * * Sets "pending" task flags when corresponding milliseconds counters reach
- *     their corresponding task period threshold value;\n
+ * * Increments the first (fastest) task milliseconds counter; whenever a
+ *     counter reaches its task period, the task's "pending" bit is set and
+ *     the elapsed time is carried over to the next task counter;\n
  * * Increments "missed" task counters whenever a task counter reaches its
- *     activation threshold and the corresponding "pending" flag is still set
+ *     activation threshold and the corresponding "pending" bit is still set
  *     (meaning that said task was not ran, since its last triggering time);\n
  * Since this function is called at each 1ms, it must be kept as lean as possible.
- *    This implementation uses about 20ticks, i.e., ~ 0.25% of CPU time,
- *    including running the caller function "SysTick_Handler", which is
- *    the 1ms timer Interrupt Handler itself.
+ *    Thanks to the cascaded counters, most ticks only touch the first
+ *    counter, regardless of the number of tasks in the table.
  */
 void SetTasksFlags(void)
 {
-	if (!tasks_enabled)
+    if (!tasks_enabled)
     {
         return;
     }
 
-    /* Update fast time task control counter */
-    fast_time_task_sched_cntr++;
-    /* Fast time task control: is it already time to run? */
-    if (fast_time_task_sched_cntr >= FAST_TIME_TASK_PERIOD)
-    {
-        setFastTimeTaskFlag();
-    }
-}
-
-static void setFastTimeTaskFlag(void)
-{
-    if (fastTimeTaskPending)
+    /* CPU load sampling: did this tick wake the CPU from idle sleep? */
+    if (cpu_idle)
     {
-        /* Really bad: fast time task was not ran since last time it was flagged as pending - increment it's "missed task" counter */
-        missed_fast_time_task_cntr++;
+        idle_tick_cntr++;
     }
-    else
+    if (++load_window_cntr >= CPU_LOAD_WINDOW)
     {
-        /* Everything seems to be fine, flag fast time task to be ran, asap */
-        fastTimeTaskPending = true;
+        last_window_idle_ticks = idle_tick_cntr;
+        idle_tick_cntr = 0;
+        load_window_cntr = 0;
     }
 
-    /* Update medium time task control counter */
-    medium_time_task_sched_cntr = medium_time_task_sched_cntr + fast_time_task_sched_cntr;
-    /* Medium time task control: is it already time to run? */
-    if (medium_time_task_sched_cntr >= MEDIUM_TIME_TASK_PERIOD)
+    uint16_t elapsed = 1U;
+    for (uint8_t i = 0; i < SCHED_TASK_COUNT; i++)
     {
-        setMediumTimeTaskFlag();
+        /* Update task control counter */
+        task_sched_cntr[i] += elapsed;
+        /* Task control: is it already time to run? */
+        if (task_sched_cntr[i] < sched_tasks[i].period)
+        {
+            break;
+        }
+
+        SCHED_MASK_t bit = (SCHED_MASK_t)(1U << sched_tasks[i].priority);
+        if (pending_tasks & bit)
+        {
+            /* Really bad: task was not ran since last time it was flagged as pending - increment it's "missed task" counter */
+            missed_task_cntr[i]++;
+        }
+        else
+        {
+            /* Everything seems to be fine, flag task to be ran, asap */
+            pending_tasks |= bit;
+        }
+
+        /* Carry the elapsed time over to the next (slower) task counter */
+        elapsed = task_sched_cntr[i];
+        task_sched_cntr[i] = 0;
     }
-    fast_time_task_sched_cntr = 0;
 }
 
-static void setMediumTimeTaskFlag(void)
+/**
+ * \brief Runs main scheduler loop.
+ *
+ * The **scheduler main loop** is an endless loop that monitors the **pending tasks**
+ *     bitmask to decide if it is time to run any of the predefined system tasks.
+ *     Whenever a set bit is found, the bit is cleared, the corresponding task
+ *     function is called, and the loop proceeds to its next iteration;\n
+ * Since the lowest set bit is picked and only one task is ran per loop
+ *     iteration, higher priority tasks are, naturally, prioritized over
+ *     the lower priority ones;\n
+ * Additionally, the loop code registers the execution time of the tasks it
+ *     calls, for processor load estimation, and sleeps when there is
+ *     nothing to run.
+ */
+void RunMainLoop(void)
 {
-    if (mediumTimeTaskPending)
+    /* Events go first - an interrupt asked for a prompt reaction */
+    if (eventPending())
     {
-        /* Really bad: medium time task was not ran since last time it was flagged as pending - increment it's "missed task" counter */
-        missed_medium_time_task_cntr++;
+        dispatchEvent();
+        return;
     }
-    else
+
+    /* Then expired software timers - they are a driver's next step */
+    if (SoftTimerDue())
     {
-        /* Everything seems to be fine, flag medium time task to be ran, asap */
-        mediumTimeTaskPending = true;
+        SoftTimerRun();
+        return;
     }
 
-    /* Update slow time task control counter */
-    slow_time_task_sched_cntr = slow_time_task_sched_cntr + medium_time_task_sched_cntr;
-    /* Slow time task control: is it already time to run? */
-    if (slow_time_task_sched_cntr >= SLOW_TIME_TASK_PERIOD)
+    SCHED_MASK_t ready = pending_tasks;
+    if (0U == ready)
     {
-        setSlowTimeTaskFlag();
+        idleUntilInterrupt();
+        return;
     }
-    medium_time_task_sched_cntr = 0;
-}
 
-static void setSlowTimeTaskFlag(void)
-{
-    if (slowTimeTaskPending)
+    uint8_t priority = findFirstSet(ready);
+    const SCHED_TASK_t *task = &sched_tasks[task_by_priority[priority]];
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
     {
-        /* Really bad: slow time task was not ran since last time it was flagged as pending - increment it's "missed task" counter */
-        missed_slow_time_task_cntr++;
+        pending_tasks &= (SCHED_MASK_t)~(1U << priority);
     }
-    else
+#ifdef WATCHDOG
+    WatchdogTaskStart(task->task);
+#endif
+    uint32_t start_time = GetHiResSystemTime();
+    task->runner();
+    uint32_t run_time = GetHiResElapsedTime(start_time);
+    recordRunTime(&task_run_time[task_by_priority[priority]], run_time);
+#ifdef WATCHDOG
+    WatchdogTaskDone(task->task, run_time);
+#endif
+
+    /* else if (powerOffEventTaskPending)
     {
-        /* Everything seems to be fine, flag slow time task to be ran, asap */
-        slowTimeTaskPending = true;
-    }
+        power_off_event_task_start_time = GetHiResSystemTime();
+        powerOffEventTaskPending = false;
+        RunPowerOffTask();
+        power_off_event_task_run_time = GetHiResElapsedTime(power_off_event_task_start_time);
+    } */
+}
 
-    /* Update very slow time task control counter */
-    very_slow_time_task_sched_cntr = very_slow_time_task_sched_cntr + slow_time_task_sched_cntr;
-    /* Very slow time task control: is it already time to run? */
-    if (very_slow_time_task_sched_cntr >= VERY_SLOW_TIME_TASK_PERIOD)
+/**
+ * \brief Idle hook: sleeps until the next interrupt, unless a task became pending
+ *
+ * Interrupts are disabled while the pending mask is checked, and only
+ *     re-enabled by the "sei" right before "sleep" - the AVR always runs the
+ *     instruction following "sei" before serving an interrupt, so a tick
+ *     arriving in between still wakes the CPU instead of being slept over.
+ */
+static void idleUntilInterrupt(void)
+{
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    if ((0U == pending_tasks) && !eventPending() && !SoftTimerDue())
     {
-        setVerySlowTimeTaskFlag();
+        cpu_idle = true;
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+        cpu_idle = false;
     }
-    slow_time_task_sched_cntr = 0;
+    sei();
 }
 
-static void setVerySlowTimeTaskFlag(void)
+/**
+ * \brief Posts an event, to be handled by its event task
+ *
+ * Meant to be called from interrupt handlers. When called from the main
+ *   loop, interrupts must be disabled around the call - an interrupt
+ *   handler posting in between would be a second producer.
+ *
+ * @param [in] event - posted event
+ * @param [in] data - event data, passed to the event task
+ * @return false if the ring is full - the event is dropped and counted
+ */
+bool SchedulerPostEvent(EVENTS_t event, uint8_t data)
 {
-    if (verySlowTimeTaskPending)
+    uint8_t head = event_head;
+    if ((event >= EVENT_COUNT) || ((uint8_t)(head - event_tail) >= SCHED_EVENT_QUEUE_SIZE))
     {
-        /* Really bad: very slow time task was not ran since last time it was flagged as pending - increment it's "missed task" counter */
-        missed_very_slow_time_task_cntr++;
+        if (lost_events < UINT16_MAX)
+        {
+            lost_events++;
+        }
+        return false;
     }
-    else
+
+    SCHED_EVENT_t *slot = &event_queue[head & SCHED_EVENT_QUEUE_MASK];
+    slot->event = (uint8_t)event;
+    slot->data = data;
+    slot->post_time = GetHiResSystemTime();
+    /* The slot must be complete before the consumer can see it */
+    SCHED_COMPILER_BARRIER();
+    event_head = (uint8_t)(head + 1U);
+    return true;
+}
+
+/**
+ * \brief Checks whether the event ring holds any event
+ */
+static bool eventPending(void)
+{
+    return event_head != event_tail;
+}
+
+/**
+ * \brief Takes the oldest event from the ring and runs its event task
+ */
+static void dispatchEvent(void)
+{
+    uint8_t tail = event_tail;
+    /* Read the slot only after event_head showed it is complete */
+    SCHED_COMPILER_BARRIER();
+    SCHED_EVENT_t event = event_queue[tail & SCHED_EVENT_QUEUE_MASK];
+    /* The slot must be copied before the producer can reuse it */
+    SCHED_COMPILER_BARRIER();
+    event_tail = (uint8_t)(tail + 1U);
+
+    uint32_t start_time = GetHiResSystemTime();
+    uint32_t latency = start_time - event.post_time;
+    if (latency > event_max_latency[event.event])
     {
-        /* Everything seems to be fine, flag very slow time task to be ran, asap */
-        verySlowTimeTaskPending = true;
+        event_max_latency[event.event] = latency;
     }
-    very_slow_time_task_sched_cntr = 0;
+    sched_event_tasks[event.event].runner(event.data);
+    recordRunTime(&event_run_time[event.event], GetHiResElapsedTime(start_time));
 }
 
 /**
- * \brief Runs main scheduler loop.
- *
- * The **scheduler main loop** is an endless loop that monitors **pending task** flags
- *     to decide if it is time to run any of the predefined system tasks.
- *     Whenever a set flag is found, the flag is cleared, the corresponding task
- *     function is called, and the loop proceeds to its next iteration;\n
- * Since higher frequency tasks flags are pooled first and only one task is
- *     ran per loop iteration, higher frequency task are, naturally, prioritized
- *     over the lower frequencies ones;\n
- * Additionally, the loop code registers the execution time of the tasks it
- *     calls, for processor load estimation.
+ * \brief Finds the lowest set bit of a non-zero pending mask
  */
-void RunMainLoop(void)
+static uint8_t findFirstSet(SCHED_MASK_t mask)
 {
-	
-    if (fastTimeTaskPending)
+    if (mask & 0x0FU)
     {
-        // fast_time_task_start_time = GetHiResSystemTime();
-        fastTimeTaskPending = false;
-        RunFastTimeTask();
-        // fast_time_task_run_time = GetHiResElapsedTime(fast_time_task_start_time);
+        return lowest_bit_lut[mask & 0x0FU];
     }
-    else if (mediumTimeTaskPending)
+    return 4U + lowest_bit_lut[(mask >> 4) & 0x0FU];
+}
+
+/**
+ * \brief Accounts one task run into its run time statistics
+ */
+static void recordRunTime(SCHED_RUN_TIME_t *stats, uint32_t run_time)
+{
+    if ((0U == stats->runs) || (run_time < stats->min_us))
     {
-        // medium_time_task_start_time = GetHiResSystemTime();
-        mediumTimeTaskPending = false;
-        RunMediumTimeTask();
-        // medium_time_task_run_time = GetHiResElapsedTime(medium_time_task_start_time);
+        stats->min_us = run_time;
     }
-    else if (slowTimeTaskPending)
+    if (run_time > stats->max_us)
     {
-        // slow_time_task_start_time = GetHiResSystemTime();
-        slowTimeTaskPending = false;
-        RunSlowTimeTask();
-        // slow_time_task_run_time = GetHiResElapsedTime(slow_time_task_start_time);
+        stats->max_us = run_time;
     }
-    else if (verySlowTimeTaskPending)
+    stats->runs++;
+    stats->total_us += run_time;
+
+    /* Bucket k: run_time < 16us * 4^k */
+    uint8_t bucket = 0;
+    uint32_t scaled = run_time >> 4;
+    while ((scaled > 0U) && (bucket < (SCHED_HIST_BUCKETS - 1U)))
     {
-        // very_slow_time_task_start_time = GetHiResSystemTime();
-        verySlowTimeTaskPending = false;
-        RunVerySlowTimeTask();
-        // very_slow_time_task_run_time = GetHiResElapsedTime(very_slow_time_task_start_time);
+        scaled >>= 2;
+        bucket++;
     }
-    /* else if (powerOffEventTaskPending)
+    if (stats->histogram[bucket] < UINT16_MAX)
     {
-        power_off_event_task_start_time = GetHiResSystemTime();
-        powerOffEventTaskPending = false;
-        RunPowerOffTask();
-        power_off_event_task_run_time = GetHiResElapsedTime(power_off_event_task_start_time);
-    } */
+        stats->histogram[bucket]++;
+    }
 }
 
 /**
  * \brief Enables all time based tasks
  *
  * Clears all task activation and missed task counters, as well as
- *     all pending task flags, and enables all time based, periodic
+ *     all pending task bits, and enables all time based, periodic
  *     tasks triggering.
  */
 void EnableSystemTasks(void)
 {
 	if (false == tasks_enabled)
 	{
+		for (uint8_t i = 0; i < SCHED_TASK_COUNT; i++)
+		{
+			/* Map priority to table entry */
+			task_by_priority[sched_tasks[i].priority] = i;
+			/* Clear time tasks activation counters */
+			task_sched_cntr[i] = 0;
+			/* Clear missed time tasks counters */
+			missed_task_cntr[i] = 0;
+			/* Clear run time statistics */
+			memset(&task_run_time[i], 0, sizeof(task_run_time[i]));
+		}
+
 		/* Clear pending flags */
-		fastTimeTaskPending = false;
-		mediumTimeTaskPending = false;
-		slowTimeTaskPending = false;
-		verySlowTimeTaskPending = false;
+		pending_tasks = 0;
+
+		/* Clear events and event tasks statistics */
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			event_head = 0;
+			event_tail = 0;
+			lost_events = 0;
+		}
+		for (uint8_t i = 0; i < EVENT_COUNT; i++)
+		{
+			memset(&event_run_time[i], 0, sizeof(event_run_time[i]));
+			event_max_latency[i] = 0;
+		}
+
+		/* Restart CPU load measurement - no load reported until a full window */
+		idle_tick_cntr = 0;
+		load_window_cntr = 0;
+		last_window_idle_ticks = CPU_LOAD_WINDOW;
 		powerOffEventTaskPending = false;
 
-		/* Clear time tasks activation counters */
-		fast_time_task_sched_cntr = 0;
-		medium_time_task_sched_cntr = 0;
-		slow_time_task_sched_cntr = 0;
-		very_slow_time_task_sched_cntr = 0;
-
-		/* Clear missed time tasks counters */
-		missed_fast_time_task_cntr = 0;
-		missed_medium_time_task_cntr = 0;
-		missed_slow_time_task_cntr = 0;
-		missed_very_slow_time_task_cntr = 0;
-
 		/* Enable tasks */
 		tasks_enabled = true;
 	}
@@ -339,9 +586,118 @@ void EnableSystemTasks(void)
  */
 void TriggerPowerOnTask(void)
 {
-    // power_on_event_task_start_time = GetHiResSystemTime();
+    uint32_t start_time = GetHiResSystemTime();
     RunPowerOnTask();
-    // power_on_event_task_run_time = GetHiResElapsedTime(power_on_event_task_start_time);
+    power_on_event_task_run_time = GetHiResElapsedTime(start_time);
+}
+
+/**
+ * \brief Gets the number of periodic tasks
+ */
+uint8_t SchedulerGetTaskCount(void)
+{
+    return SCHED_TASK_COUNT;
+}
+
+/**
+ * \brief Gets run time statistics of a periodic task
+ *
+ * @param [in] index - task table index, from 0 to SchedulerGetTaskCount() - 1
+ * @param [out] stats - task statistics
+ * @return false if index is out of range
+ */
+bool SchedulerGetTaskStats(uint8_t index, SCHED_TASK_STATS_t *stats)
+{
+    if (index >= SCHED_TASK_COUNT)
+    {
+        return false;
+    }
+
+    const SCHED_RUN_TIME_t *run_time = &task_run_time[index];
+    stats->runs    = run_time->runs;
+    stats->min_us  = run_time->min_us;
+    stats->max_us  = run_time->max_us;
+    stats->mean_us = (run_time->runs > 0U) ? (uint32_t)(run_time->total_us / run_time->runs) : 0U;
+    memcpy(stats->histogram, run_time->histogram, sizeof(stats->histogram));
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        stats->missed = missed_task_cntr[index];
+    }
+    return true;
+}
+
+/**
+ * \brief Gets the CPU load over the last 1s window
+ *
+ * @return CPU load, in percent - the share of ticks that did not find the CPU idle
+ */
+uint8_t SchedulerGetCpuLoad(void)
+{
+    uint16_t idle_ticks;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        idle_ticks = last_window_idle_ticks;
+    }
+    return (uint8_t)(((CPU_LOAD_WINDOW - idle_ticks) * 100UL) / CPU_LOAD_WINDOW);
+}
+
+/**
+ * \brief Prints run time statistics and missed activations of all periodic tasks
+ */
+void SchedulerReportStats(void)
+{
+    SCHED_TASK_STATS_t stats;
+
+    Serial.print("[SCHED] CPU load: ");
+    Serial.print(SchedulerGetCpuLoad());
+    Serial.println("%");
+
+    Serial.print("[SCHED] power on: ");
+    Serial.print(power_on_event_task_run_time);
+    Serial.println("us");
+    for (uint8_t i = 0; i < SCHED_TASK_COUNT; i++)
+    {
+        SchedulerGetTaskStats(i, &stats);
+        Serial.print("[SCHED] task ");
+        Serial.print(sched_tasks[i].task);
+        Serial.print(": runs=");
+        Serial.print(stats.runs);
+        Serial.print(" min=");
+        Serial.print(stats.min_us);
+        Serial.print(" mean=");
+        Serial.print(stats.mean_us);
+        Serial.print(" max=");
+        Serial.print(stats.max_us);
+        Serial.print("us missed=");
+        Serial.print(stats.missed);
+        Serial.print(" hist=");
+        for (uint8_t b = 0; b < SCHED_HIST_BUCKETS; b++)
+        {
+            Serial.print(stats.histogram[b]);
+            Serial.print((b < (SCHED_HIST_BUCKETS - 1U)) ? "/" : "\n");
+        }
+    }
+
+    uint16_t lost;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        lost = lost_events;
+    }
+    for (uint8_t i = 0; i < EVENT_COUNT; i++)
+    {
+        const SCHED_RUN_TIME_t *run_time = &event_run_time[i];
+        Serial.print("[SCHED] event ");
+        Serial.print(i);
+        Serial.print(": runs=");
+        Serial.print(run_time->runs);
+        Serial.print(" max=");
+        Serial.print(run_time->max_us);
+        Serial.print("us latency max=");
+        Serial.print(event_max_latency[i]);
+        Serial.println("us");
+    }
+    Serial.print("[SCHED] lost events: ");
+    Serial.println(lost);
 }
 
 /**  @}
@@ -8,8 +8,9 @@
  * \brief Controls all activities that must be performed by each system tasks
  *
  * All activity in the system is controlled by a number of system tasks.\n
- * There are event triggered tasks - such as the PowerOnTask, and there are
- * also tasks that are triggered in a timely, periodic basis.
+ * There are event triggered tasks - such as the PowerOnTask, or the
+ * SoundEventTask, ran when the sound detector interrupt posts its event -
+ * and there are also tasks that are triggered in a timely, periodic basis.
  *
  * @{
  */
@@ -18,15 +19,40 @@
 
 // #include "system.h"
 #include "tasks.h"
+#include "scheduler.h"
+#include "timer.h"
+#include "fast_pin.h"
+#include "sensor_cache.h"
+#include "adc_sampler.h"
 // #include "panel.h"
 // #include "terminal.h"
 #include "ntc_temperature.h"
 #include "mcu_temperature_access.h"
-// #include "watchdog.h"
+#ifdef WATCHDOG
+#include "watchdog.h"
+#endif
 #include "dht11_access.h"
+#include "at_engine.h"
+#include "mqtt_session.h"
+#include "sample_store.h"
+#include "uplink.h"
+
+/** Scheduler statistics report period, in very slow task runs */
+#define SCHED_STATS_REPORT_PERIOD 60
+
+/** Sound detector output - INT1 */
+#define SOUND_GPIO (3U)
+/** Fan relay - active low */
+#define FAN_GPIO   (4U)
+/** Oldest NTC reading used for fan control, in ms - it is read every second */
+#define NTC_MAX_AGE_MS 3000U
+/** Minimum interval between two sound alarm messages, in ms */
+#define SOUND_MESSAGE_HOLDOFF 1000U
 
 static bool alarme_sonoro = false;
 
+static void soundDetectedIsr(void);
+
 /**
  * Main power on task.
  */
@@ -43,6 +69,17 @@ void RunPowerOnTask(void)
     WATCHDOG_run(POWERON_TASK);
     #endif
 
+    ADC_SAMPLER_run(POWERON_TASK);
+    MCU_TEMPERATURE_run(POWERON_TASK);
+    DHT11_run(POWERON_TASK);
+    AT_ENGINE_run(POWERON_TASK);
+    SAMPLE_STORE_run(POWERON_TASK);
+    MQTT_SESSION_run(POWERON_TASK);
+    UPLINK_run(POWERON_TASK);
+
+    FastPin<SOUND_GPIO>::setInput();
+    attachInterrupt(digitalPinToInterrupt(SOUND_GPIO), &soundDetectedIsr, RISING);
+
     // GpioAccessSetupGpio(14); // Relay
     // GpioAccessSetupGpio(5);  // Sound alarm
     // GpioAccessSetupGpio(2);  // Sound alarm
@@ -60,8 +97,10 @@ void RunFastTimeTask(void)
     MODBUS_run(FAST_TIME_TASK);
     #endif
 
+    ADC_SAMPLER_run(FAST_TIME_TASK);
     NTC_TEMPERATURE_run(FAST_TIME_TASK);
-    
+    DHT11_run(FAST_TIME_TASK);
+
 }
 
 /**
@@ -69,14 +108,10 @@ void RunFastTimeTask(void)
  */
 void RunMediumTimeTask(void)
 {
-    uint8_t state_sound = 0;
-    state_sound = digitalRead(3); // Detector de som forte
-
-    if (state_sound)
-    {
-        Serial.println("abaixar o volume, nao maltrate o seu pet");
-        alarme_sonoro = true;
-    }
+    AT_ENGINE_run(MEDIUM_TIME_TASK);
+    SAMPLE_STORE_run(MEDIUM_TIME_TASK);
+    MQTT_SESSION_run(MEDIUM_TIME_TASK);
+    UPLINK_run(MEDIUM_TIME_TASK);
 }
 
 /**
@@ -93,9 +128,7 @@ void RunSlowTimeTask(void)
  */
 void RunVerySlowTimeTask(void)
 {
-    static uint8_t luz = 0;
     // GetNRF52832InternalTemperature();
-    digitalWrite(8, ~luz);
 
 
     // SYSTEM_run(VERY_SLOW_TIME_TASK);
@@ -107,17 +140,18 @@ void RunVerySlowTimeTask(void)
     if (minute_counter == 1)
     {
         float ntc_temp;
-        ntc_temp = GetTemperature();
-
-        Serial.print(  String(ntc_temp));
-
-        // Serial.println(alarme_sonoro, humidity);
-        if (ntc_temp > 30)
+        if (SensorCacheGetFresh(SENSOR_NTC_TEMPERATURE, NTC_MAX_AGE_MS, &ntc_temp))
         {
-            digitalWrite(4, LOW); // Ligar ventilador
-        } else
-        {
-            digitalWrite(4, HIGH); // Desligar ventilador
+            Serial.print(  String(ntc_temp));
+
+            // Serial.println(alarme_sonoro, humidity);
+            if (ntc_temp > 30)
+            {
+                FastPin<FAN_GPIO>::clear(); // Ligar ventilador
+            } else
+            {
+                FastPin<FAN_GPIO>::set(); // Desligar ventilador
+            }
         }
 
         if (alarme_sonoro)
@@ -138,8 +172,39 @@ void RunVerySlowTimeTask(void)
     }
 
     NTC_TEMPERATURE_run(VERY_SLOW_TIME_TASK);
+    MCU_TEMPERATURE_run(VERY_SLOW_TIME_TASK);
     DHT11_run(VERY_SLOW_TIME_TASK);
 
+    static uint8_t stats_counter = 0;
+    if (++stats_counter >= SCHED_STATS_REPORT_PERIOD)
+    {
+        stats_counter = 0;
+        SchedulerReportStats();
+        Dht11ReportStats();
+        AdcSamplerReportStats();
+        AtEngineReportStats();
+        MqttSessionReportStats();
+        SampleStoreReportStats();
+    }
+}
+
+/**
+ * Sound detected event task.
+ */
+void RunSoundEventTask(uint8_t data)
+{
+    static bool message_sent = false;
+    static uint32_t message_time;
+    (void)data;
+
+    alarme_sonoro = true;
+    /* A loud noise comes as a burst of edges - one message per burst */
+    if (!message_sent || TestTimerExpired(message_time, SOUND_MESSAGE_HOLDOFF))
+    {
+        Serial.println("abaixar o volume, nao maltrate o seu pet"); // Detector de som forte
+        message_sent = true;
+        message_time = GetSystemTime();
+    }
 }
 
 /**
@@ -154,6 +219,14 @@ bool IsSoundAlarm(void)
     return alarme_sonoro;
 }
 
+/**
+ * Sound detector rising edge handler.
+ */
+static void soundDetectedIsr(void)
+{
+    SchedulerPostEvent(SOUND_DETECTED_EVENT, 0U);
+}
+
 /**  @}
  * End of task_module group definition
  */
@@ -13,7 +13,10 @@
  *
  * A referência de tempo do sistema é um contador de milissegundos
  *   transcorridos desde o evento de \e Power \e On, que é incrementado
- *   a partir de uma interrupção periódica gerada pelo \e SysTick \e timer
+ *   a partir de uma interrupção periódica gerada pelo \e SysTick \e timer.
+ *   No ATmega328P o \e SysTick é o Timer2, em modo CTC, gerando uma
+ *   interrupção de comparação a cada 1 ms (o Timer0 permanece com o
+ *   núcleo Arduino, para millis() e delay()).
  *
  * O tempo de sistema pode ser obtido como o valor bruto do contador
  *   de milissegundos, através da função GetSystemTime().
@@ -22,28 +25,75 @@
  *   permitem a medição conveniente de intervalos de tempo, com resolução
  *   de milissegundos.
  *
+ * Todas as referências de tempo são de 32 bits: no AVR de 8 bits, a
+ *   aritmética e a leitura atômica de 64 bits custam várias vezes mais,
+ *   tanto na ISR quanto nos laços de espera dos \e drivers. As funções de
+ *   intervalo usam subtração sem sinal, e permanecem corretas quando o
+ *   contador reinicia (a cada ~49,7 dias em milissegundos, ~71,6 minutos
+ *   em microssegundos), desde que os intervalos medidos sejam menores que
+ *   esses períodos.
+ *
  * Adicionalmente, as funções GetHiResSystemTime() e GetHiResElapsedTime()
  *   permitem medição de intervalos de tempo com resolução mais alta,
  *   de microssegundos.
  *
+ * O módulo oferece também um serviço de temporizadores de software de
+ *   disparo único (SoftTimerArm()/SoftTimerCancel()), para que os
+ *   \e drivers agendem o seu próximo passo em vez de bloquear o
+ *   \e firmware em delay(). Os temporizadores ficam numa lista
+ *   encadeada ordenada pelo instante de expiração; a ISR do \e SysTick
+ *   apenas compara o relógio com a expiração do primeiro da lista e
+ *   sinaliza, e os \e callbacks são executados no contexto do
+ *   escalonador, por SoftTimerRun(), chamada por RunMainLoop().
+ *
  * @{
  */
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <util/atomic.h>
+#ifndef NATIVE_BUILD
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#endif
+#ifdef BENCHMARK
+#include <Arduino.h>
+#endif
 
 // #include "system.h"
 
 #include "scheduler.h"
+#include "timer.h"
 // #include "sysstart.h"
 // #include "systick_access.h"
 
-// #include "timer.h"
-
 // #include "rtc_access.h"
 
-/** Tempo transcorrido, em milissegundos, desde o último evento de power-on */
-static uint64_t system_timer;
+#ifdef NATIVE_BUILD
+#include "native_hal.h"
+#endif
+
+/** Timer2: clk/64 -> 250 kHz, 250 contagens -> 1 ms */
+#define SYSTICK_COMPARE_VALUE (F_CPU / 64UL / 1000UL - 1UL)
+/** Microssegundos por contagem do Timer2 (4 us a 16 MHz) */
+#define SYSTICK_US_PER_COUNT  (64UL * 1000000UL / F_CPU)
+
+/** Tempo transcorrido, em milissegundos, desde o último evento de power-on (reinicia a cada ~49,7 dias) */
+static volatile uint32_t system_timer;
+/** Pré-escalonador de segundos do SysTick */
+static uint16_t second_prescaler;
+
+/** Lista de temporizadores de software armados, ordenada por expiração */
+static SOFT_TIMER_t *soft_timer_list;
+/** Expiração do primeiro temporizador da lista, lida pela ISR */
+static volatile uint32_t soft_timer_next_expiry;
+/** Há temporizador armado - habilita a comparação na ISR */
+static volatile bool soft_timer_armed;
+/** O primeiro temporizador expirou: SoftTimerRun() deve ser chamada */
+static volatile bool soft_timer_due;
+
+static void softTimerUpdateHead(void);
 
 
 /**
@@ -52,14 +102,43 @@ static uint64_t system_timer;
  * Esta função inicializa o contador, o temporizador \e SysTick
  *   e registra uma função de \e callback para ser invocada
  *   pela função de tratamento de interrupções do mesmo.
+ *
+ * No ambiente \e native, o \e SysTick é o relógio virtual da HAL nativa,
+ *   que chama SystickRunner() a cada milissegundo de tempo simulado.
  */
 void SetupSystemTimer(void)
 {
-    /* Initialize SysTick timer driver */
-    // RTCAccessSetup(0);
-    /* Register call back function into SysTick driver */
-    // RTCAccessInstallCallback(0, &SystickRunner);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        system_timer = 0;
+#ifdef NATIVE_BUILD
+        HalInstallTickCallback(&SystickRunner);
+#else
+        /* Timer2 em modo CTC, interrupção na comparação com OCR2A */
+        TCCR2A = _BV(WGM21);
+        TCCR2B = _BV(CS22);
+        OCR2A  = SYSTICK_COMPARE_VALUE;
+        TCNT2  = 0;
+        TIFR2  = _BV(OCF2A);
+        TIMSK2 = _BV(OCIE2A);
+#endif
+    }
+}
+
+
+#ifndef NATIVE_BUILD
+/**
+ * \brief Tratamento da interrupção de comparação do Timer2 (\e SysTick)
+ *
+ * As interrupções permanecem desabilitadas durante SystickRunner(),
+ *   de forma que o contador e as \e flags de tarefas são atualizados
+ *   atomicamente em relação às demais interrupções.
+ */
+ISR(TIMER2_COMPA_vect)
+{
+    SystickRunner();
 }
+#endif
 
 
 /**
@@ -80,13 +159,20 @@ void SystickRunner(void)
     // int32_t system_up;
     /* Update system timer */
     system_timer += 1;
-    if( system_timer % 1000 == 0 )
+    /* Contador crescente de milissegundos em vez de 'system_timer % 1000': sem divisão na ISR */
+    if (++second_prescaler >= 1000U)
     {
+      second_prescaler = 0;
       // system_up = system_timer / 1000;
       // printf("%d segundos\n", system_up);
       // DevledToggleLed();
       // IncSystemLife();
     }
+    /* Expiração de temporizador de software: apenas sinaliza */
+    if (soft_timer_armed && ((int32_t)(system_timer - soft_timer_next_expiry) >= 0))
+    {
+        soft_timer_due = true;
+    }
     /* Set pending task flags */
     SetTasksFlags();
 }
@@ -97,26 +183,43 @@ void SystickRunner(void)
  *
  * @return O número de milissegundos transcorridos desde o evento de \e Power \e On
  */
-uint64_t GetSystemTime(void)
+uint32_t GetSystemTime(void)
 {
-    return system_timer;
+    uint32_t now;
+    /* Leitura de 32 bits não é atômica no AVR: evita ler o contador pela metade */
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        now = system_timer;
+    }
+    return now;
 }
 
 
+#ifdef NATIVE_BUILD
+/**
+ * \brief Ajusta o contador de milissegundos - apenas no \e host, para os testes alcançarem o reinício do contador
+ *
+ * @param [in] now - novo valor de GetSystemTime()
+ */
+void SetSystemTime(uint32_t now)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        system_timer = now;
+    }
+}
+#endif
+
 /**
  * \brief Obtém o número de milissegundos transcorridos desde o armazenamento de ref_time
  *
  * @param [in] ref_time - uma referência de tempo armazenada em um momento anterior, via GetSystemTime()
  * @return O número de milissegundos transcorridos desde o armazenamento de ref_time, passado como argumento
  */
-uint64_t GetElapsedTime(uint64_t ref_time)
+uint32_t GetElapsedTime(uint32_t ref_time)
 {
-    uint64_t result = (0U);
-    if (system_timer > ref_time)
-    {
-        result = system_timer - ref_time;
-    }
-    return result;
+    /* Subtração sem sinal: correta mesmo após o reinício do contador */
+    return GetSystemTime() - ref_time;
 }
 
 
@@ -127,17 +230,9 @@ uint64_t GetElapsedTime(uint64_t ref_time)
  * @param [in] timeout - o intervalo de tempo, e, milissegundos, a ser verificado
  * @return TRUE, se o tempo transcorrido desde 'ref_time' supera 'timeout', ou FALSE, em caso contrário
  */
-bool TestTimerExpired(uint64_t ref_time, uint64_t timeout)
+bool TestTimerExpired(uint32_t ref_time, uint32_t timeout)
 {
-    bool result = false;
-    if (system_timer > ref_time)
-    {
-        if ((system_timer - ref_time) >= timeout)
-        {
-            result = true;
-        }
-    }
-    return result;
+    return (GetSystemTime() - ref_time) >= timeout;
 }
 
 
@@ -150,23 +245,41 @@ bool TestTimerExpired(uint64_t ref_time, uint64_t timeout)
  *   é possível medir intervalos de tempo com resolução de microssegundos,
  *   utilizando-se a função GetHiResElapsedTime().
  *
+ * Os microssegundos são obtidos da contagem do Timer2 (resolução de 4 us);
+ *   se a interrupção de comparação estiver pendente, o milissegundo ainda
+ *   não contabilizado é somado à referência.
+ *
  * @return uma referência de tempo de alta resolução
  */
-uint64_t GetHiResSystemTime(void)
+uint32_t GetHiResSystemTime(void)
 {
-    uint32_t microseconds;
-    uint64_t milliseconds;
+    uint16_t microseconds;
+    uint32_t milliseconds;
 
-    // EnterCritical();
-    // microseconds = SystickAccessGetHiResTime();
-    milliseconds = GetSystemTime();
-    // if (SystickAccessPendingIrq())
-    // {
-    //    milliseconds++;
-    //}
-    // LeaveCritical();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+#ifdef NATIVE_BUILD
+        microseconds = HalGetTickMicros();
+        milliseconds = system_timer;
+        if (HalTickPending())
+        {
+            milliseconds++;
+        }
+#else
+        uint8_t count = TCNT2;
+        milliseconds = system_timer;
+        if (TIFR2 & _BV(OCF2A))
+        {
+            /* O contador já reiniciou mas a interrupção ainda não foi atendida:
+             * relê a contagem, que agora é certamente posterior ao reinício */
+            count = TCNT2;
+            milliseconds++;
+        }
+        microseconds = (uint16_t)count * SYSTICK_US_PER_COUNT;
+#endif
+    }
 
-    return milliseconds * (1000U) + (uint64_t)microseconds;
+    return milliseconds * (1000UL) + (uint32_t)microseconds;
 }
 
 
@@ -180,12 +293,210 @@ uint64_t GetHiResSystemTime(void)
  * @param [in] reference_time - uma referência de tempo de alta resolução, armazenada anteriormente
  * @return o número de microssegundos transcorridos desde o momento do armazenamento de 'reference_time', até o momento presente
  */
-uint64_t GetHiResElapsedTime(uint64_t reference_time)
+uint32_t GetHiResElapsedTime(uint32_t reference_time)
 {
     return GetHiResSystemTime() - reference_time;
 }
 
 
+/**
+ * \brief Arma um temporizador de software de disparo único
+ *
+ * Se o temporizador já estiver armado, ele é rearmado com o novo prazo.
+ *   Pode ser chamada de dentro de um \e callback de temporizador.
+ *
+ * @param [in] timer - temporizador, com armazenamento do chamador
+ * @param [in] delay_ms - prazo, em milissegundos, a partir de agora
+ * @param [in] callback - função chamada na expiração, no contexto do escalonador
+ * @param [in] context - argumento passado ao \e callback
+ */
+void SoftTimerArm(SOFT_TIMER_t *timer, uint32_t delay_ms, SOFT_TIMER_CALLBACK_t callback, void *context)
+{
+    SoftTimerCancel(timer);
+
+    timer->expiry   = GetSystemTime() + delay_ms;
+    timer->callback = callback;
+    timer->context  = context;
+    timer->armed    = true;
+
+    /* Inserção ordenada; empates mantêm a ordem de armação */
+    SOFT_TIMER_t **link = &soft_timer_list;
+    while ((NULL != *link) && ((int32_t)(timer->expiry - (*link)->expiry) >= 0))
+    {
+        link = &(*link)->next;
+    }
+    timer->next = *link;
+    *link = timer;
+
+    softTimerUpdateHead();
+}
+
+/**
+ * \brief Desarma um temporizador de software - nada faz se ele não estiver armado
+ */
+void SoftTimerCancel(SOFT_TIMER_t *timer)
+{
+    if (!timer->armed)
+    {
+        return;
+    }
+
+    SOFT_TIMER_t **link = &soft_timer_list;
+    while ((NULL != *link) && (*link != timer))
+    {
+        link = &(*link)->next;
+    }
+    if (NULL != *link)
+    {
+        *link = timer->next;
+    }
+    timer->next  = NULL;
+    timer->armed = false;
+
+    softTimerUpdateHead();
+}
+
+/**
+ * \brief Verifica se um temporizador de software está armado
+ */
+bool SoftTimerIsArmed(const SOFT_TIMER_t *timer)
+{
+    return timer->armed;
+}
+
+/**
+ * \brief Verifica se há temporizador de software expirado aguardando SoftTimerRun()
+ */
+bool SoftTimerDue(void)
+{
+    return soft_timer_due;
+}
+
+/**
+ * \brief Executa os \e callbacks de todos os temporizadores de software expirados
+ *
+ * Chamada no contexto do escalonador. Cada temporizador é retirado da
+ *   lista antes do seu \e callback, que pode então rearmá-lo.
+ */
+void SoftTimerRun(void)
+{
+    soft_timer_due = false;
+
+    uint32_t now = GetSystemTime();
+    while ((NULL != soft_timer_list) && ((int32_t)(now - soft_timer_list->expiry) >= 0))
+    {
+        SOFT_TIMER_t *timer = soft_timer_list;
+        soft_timer_list = timer->next;
+        timer->next  = NULL;
+        timer->armed = false;
+        softTimerUpdateHead();
+
+        timer->callback(timer->context);
+    }
+}
+
+/**
+ * \brief Publica para a ISR a expiração do primeiro temporizador da lista
+ */
+static void softTimerUpdateHead(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        soft_timer_armed = (NULL != soft_timer_list);
+        if (soft_timer_armed)
+        {
+            soft_timer_next_expiry = soft_timer_list->expiry;
+        }
+    }
+}
+
+
+#if defined(BENCHMARK) && !defined(NATIVE_BUILD)
+/** Número de chamadas por medição de \e benchmark */
+#define BENCH_ITERATIONS 64U
+
+/** Contador de referência de 64 bits (implementação anterior) */
+static volatile uint64_t bench_timer64;
+/** Destino das chamadas medidas, evita que o compilador as elimine */
+static volatile uint32_t bench_sink;
+
+static __attribute__((noinline)) uint64_t benchGetSystemTime64(void)
+{
+    uint64_t now;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        now = bench_timer64;
+    }
+    return now;
+}
+
+static __attribute__((noinline)) bool benchTestTimerExpired64(uint64_t ref_time, uint64_t timeout)
+{
+    uint64_t now = benchGetSystemTime64();
+    return (now > ref_time) && ((now - ref_time) >= timeout);
+}
+
+/**
+ * \brief Inicializa o contador de ciclos (Timer1, sem pré-escalonador)
+ */
+void SetupCycleCounter(void)
+{
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+}
+
+/**
+ * \brief Obtém a contagem de ciclos - intervalos de até 65535 ciclos (~4 ms)
+ */
+uint16_t GetCycleCount(void)
+{
+    return TCNT1;
+}
+
+/**
+ * \brief Mede o custo, em ciclos, da API de tempo de 32 bits e do caminho de 64 bits anterior
+ */
+void TimerBenchmark(void)
+{
+    uint16_t start;
+    uint16_t overhead;
+    uint16_t cycles[4];
+
+    SetupCycleCounter();
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = i; }
+    overhead = GetCycleCount() - start;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = (uint32_t)benchGetSystemTime64(); }
+    cycles[0] = GetCycleCount() - start - overhead;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = GetSystemTime(); }
+    cycles[1] = GetCycleCount() - start - overhead;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = benchTestTimerExpired64(i, 5000U); }
+    cycles[2] = GetCycleCount() - start - overhead;
+
+    start = GetCycleCount();
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; i++) { bench_sink = TestTimerExpired(i, 5000U); }
+    cycles[3] = GetCycleCount() - start - overhead;
+
+    Serial.print("[BENCH] GetSystemTime 64/32: ");
+    Serial.print(cycles[0] / BENCH_ITERATIONS);
+    Serial.print("/");
+    Serial.print(cycles[1] / BENCH_ITERATIONS);
+    Serial.print(" ciclos, TestTimerExpired 64/32: ");
+    Serial.print(cycles[2] / BENCH_ITERATIONS);
+    Serial.print("/");
+    Serial.print(cycles[3] / BENCH_ITERATIONS);
+    Serial.println(" ciclos");
+}
+#endif
+
+
 /**  @}
  * End of timer_module group definition
  */
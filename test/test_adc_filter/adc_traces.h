@@ -0,0 +1,271 @@
+#ifndef ADC_TRACES_H_
+#define ADC_TRACES_H_
+
+#include <stdint.h>
+
+/**
+ * \file adc_traces.h
+ *
+ * \brief ADC traces for the filter tests
+ *
+ * 1920 10-bit samples per channel, at a constant input: gaussian noise of
+ *   1.5 LSB sigma, plus +200 LSB single-sample spikes on 2% of the samples,
+ *   standing for relay and ESP-01 switching noise. Produced once by a
+ *   seeded generator and kept here, so every filter change is measured on
+ *   the same samples.
+ */
+
+/** NTC divider input, in LSB */
+#define NTC_TRACE_LEVEL 612.4
+/** MCU internal sensor input, in LSB - about 25C */
+#define MCU_TRACE_LEVEL 355.3
+
+static const uint16_t ntc_trace[] =
+{
+     612,  614,  613,  609,  611,  612,  611,  612,  613,  614,  612,  612,  610,  612,  608,  613,
+     612,  614,  615,  614,  612,  609,  612,  614,  610,  613,  611,  613,  613,  612,  611,  614,
+     610,  610,  614,  613,  612,  611,  613,  611,  614,  811,  614,  611,  613,  614,  611,  613,
+     612,  612,  614,  614,  614,  613,  611,  611,  612,  613,  611,  612,  610,  612,  611,  613,
+     615,  609,  811,  612,  612,  612,  612,  615,  610,  611,  615,  611,  614,  614,  612,  614,
+     610,  613,  611,  613,  612,  613,  611,  612,  613,  610,  612,  611,  610,  614,  611,  612,
+     609,  613,  613,  614,  613,  612,  613,  615,  614,  610,  614,  615,  612,  613,  612,  613,
+     613,  610,  614,  613,  612,  613,  614,  610,  612,  609,  614,  614,  612,  609,  613,  611,
+     612,  613,  610,  614,  610,  613,  813,  613,  611,  613,  614,  611,  612,  613,  611,  614,
+     616,  613,  610,  613,  612,  614,  612,  611,  614,  614,  610,  611,  612,  615,  614,  612,
+     612,  612,  613,  611,  613,  609,  613,  613,  614,  610,  611,  614,  611,  617,  614,  610,
+     611,  611,  611,  613,  611,  612,  611,  612,  613,  615,  615,  612,  612,  616,  613,  613,
+     612,  612,  613,  611,  610,  613,  612,  615,  612,  610,  613,  609,  613,  612,  613,  614,
+     611,  613,  609,  612,  615,  611,  613,  611,  607,  615,  616,  614,  614,  610,  614,  614,
+     612,  614,  614,  613,  614,  612,  610,  612,  612,  610,  614,  612,  611,  611,  612,  613,
+     613,  610,  611,  612,  612,  613,  614,  614,  614,  611,  612,  613,  610,  612,  614,  612,
+     610,  609,  610,  614,  612,  615,  610,  612,  614,  612,  613,  812,  614,  611,  610,  613,
+     614,  613,  614,  612,  613,  611,  612,  613,  613,  616,  615,  611,  614,  613,  611,  612,
+     614,  612,  613,  613,  614,  614,  613,  612,  611,  614,  614,  613,  610,  611,  613,  613,
+     613,  614,  611,  610,  614,  614,  611,  612,  612,  613,  812,  613,  612,  613,  612,  611,
+     611,  612,  613,  613,  611,  613,  615,  615,  614,  611,  612,  611,  611,  610,  612,  612,
+     611,  612,  613,  612,  612,  613,  613,  614,  612,  613,  612,  613,  611,  611,  611,  616,
+     612,  611,  612,  610,  612,  611,  809,  612,  615,  613,  612,  613,  613,  610,  613,  614,
+     613,  613,  610,  612,  615,  614,  609,  613,  613,  612,  614,  611,  614,  613,  612,  612,
+     611,  611,  609,  613,  612,  608,  613,  612,  613,  612,  613,  613,  615,  612,  616,  612,
+     614,  612,  613,  611,  611,  614,  612,  612,  613,  614,  612,  611,  613,  615,  611,  613,
+     611,  612,  613,  611,  611,  611,  611,  611,  612,  813,  614,  611,  612,  615,  613,  611,
+     612,  612,  613,  613,  610,  610,  615,  613,  611,  615,  609,  611,  612,  608,  613,  612,
+     611,  612,  612,  613,  612,  612,  612,  612,  610,  612,  613,  614,  613,  608,  613,  610,
+     611,  613,  610,  614,  613,  613,  614,  812,  613,  613,  611,  612,  612,  612,  616,  614,
+     610,  612,  614,  612,  613,  613,  614,  613,  611,  614,  612,  613,  614,  612,  612,  614,
+     611,  613,  614,  611,  613,  612,  614,  610,  613,  610,  611,  613,  615,  613,  613,  613,
+     613,  611,  613,  612,  612,  611,  615,  609,  613,  811,  611,  614,  611,  614,  615,  613,
+     612,  613,  614,  611,  613,  613,  611,  613,  610,  611,  614,  613,  612,  613,  612,  612,
+     613,  612,  615,  612,  615,  612,  612,  612,  615,  613,  614,  608,  613,  611,  612,  612,
+     615,  613,  611,  612,  612,  611,  611,  611,  613,  611,  613,  612,  611,  613,  610,  612,
+     612,  609,  612,  613,  611,  614,  614,  611,  614,  612,  612,  612,  612,  610,  609,  613,
+     610,  615,  615,  613,  614,  611,  615,  614,  612,  611,  613,  609,  813,  612,  613,  612,
+     611,  614,  613,  611,  612,  613,  613,  612,  614,  613,  610,  615,  613,  614,  614,  612,
+     614,  613,  612,  611,  612,  613,  609,  612,  614,  613,  611,  614,  615,  612,  613,  614,
+     614,  612,  611,  612,  614,  613,  611,  608,  613,  611,  613,  613,  611,  612,  611,  614,
+     612,  614,  614,  611,  616,  612,  610,  610,  612,  614,  612,  608,  612,  614,  615,  612,
+     611,  610,  614,  611,  612,  613,  612,  614,  611,  615,  607,  614,  608,  612,  610,  613,
+     612,  609,  609,  613,  612,  612,  610,  611,  612,  610,  614,  613,  613,  613,  610,  614,
+     611,  612,  613,  612,  614,  615,  612,  612,  616,  611,  612,  816,  615,  613,  610,  616,
+     611,  611,  613,  612,  613,  613,  613,  612,  612,  615,  614,  614,  610,  615,  610,  612,
+     612,  613,  614,  612,  612,  612,  612,  612,  614,  611,  612,  613,  614,  612,  612,  609,
+     612,  611,  614,  614,  608,  613,  614,  614,  612,  609,  612,  613,  616,  612,  614,  613,
+     612,  611,  614,  610,  610,  612,  610,  613,  613,  612,  611,  613,  610,  614,  613,  614,
+     611,  614,  611,  613,  614,  610,  612,  613,  611,  613,  611,  614,  611,  611,  612,  612,
+     614,  612,  614,  610,  615,  612,  614,  613,  612,  613,  614,  610,  614,  611,  612,  609,
+     614,  611,  612,  612,  612,  613,  617,  614,  610,  610,  613,  612,  611,  610,  613,  614,
+     614,  613,  615,  613,  614,  611,  611,  611,  614,  611,  613,  613,  613,  613,  615,  612,
+     611,  613,  612,  613,  614,  614,  611,  609,  608,  615,  613,  614,  610,  611,  613,  614,
+     611,  611,  612,  615,  614,  613,  613,  611,  613,  612,  616,  611,  616,  613,  611,  612,
+     610,  614,  611,  611,  613,  612,  612,  612,  615,  611,  613,  613,  612,  612,  612,  612,
+     613,  612,  614,  612,  611,  613,  612,  811,  613,  611,  610,  614,  612,  611,  614,  613,
+     612,  609,  610,  611,  611,  611,  615,  610,  615,  612,  612,  611,  612,  615,  613,  613,
+     612,  614,  614,  612,  610,  613,  613,  613,  614,  611,  613,  610,  614,  612,  611,  614,
+     613,  615,  613,  611,  612,  614,  611,  612,  610,  615,  612,  613,  611,  614,  613,  615,
+     612,  613,  611,  612,  810,  613,  613,  612,  612,  613,  612,  611,  614,  611,  612,  614,
+     612,  613,  613,  609,  609,  611,  613,  612,  812,  613,  613,  613,  610,  611,  612,  613,
+     612,  610,  613,  612,  610,  613,  613,  611,  613,  614,  611,  615,  613,  611,  613,  614,
+     611,  613,  611,  814,  614,  614,  612,  612,  615,  612,  612,  612,  612,  611,  613,  613,
+     615,  611,  615,  613,  613,  614,  614,  612,  612,  614,  613,  613,  613,  613,  611,  613,
+     611,  811,  614,  612,  613,  613,  613,  614,  611,  615,  613,  611,  612,  612,  614,  612,
+     611,  613,  612,  813,  611,  613,  614,  614,  613,  611,  611,  614,  811,  611,  614,  614,
+     613,  612,  614,  612,  613,  611,  612,  614,  610,  612,  613,  612,  613,  613,  615,  611,
+     613,  613,  612,  612,  614,  612,  613,  613,  613,  610,  612,  612,  615,  612,  614,  611,
+     613,  615,  613,  616,  611,  613,  614,  611,  611,  607,  614,  613,  612,  613,  611,  613,
+     612,  612,  611,  612,  614,  615,  610,  613,  610,  613,  614,  610,  613,  614,  612,  616,
+     612,  613,  613,  610,  612,  612,  613,  612,  613,  612,  612,  614,  614,  612,  613,  613,
+     612,  612,  612,  612,  612,  613,  613,  615,  612,  612,  616,  614,  612,  610,  612,  614,
+     612,  611,  616,  614,  616,  611,  612,  616,  614,  612,  612,  610,  612,  611,  611,  610,
+     612,  612,  614,  610,  613,  611,  611,  612,  614,  612,  613,  611,  615,  611,  615,  612,
+     609,  612,  610,  612,  613,  614,  614,  612,  612,  612,  611,  612,  614,  615,  809,  613,
+     611,  614,  613,  813,  614,  610,  612,  614,  615,  615,  610,  611,  613,  613,  613,  613,
+     614,  613,  614,  615,  615,  613,  613,  614,  614,  613,  613,  612,  612,  612,  615,  612,
+     613,  611,  611,  614,  613,  611,  613,  615,  615,  612,  614,  615,  611,  611,  613,  610,
+     613,  612,  609,  614,  611,  612,  611,  612,  615,  611,  613,  612,  812,  612,  611,  614,
+     614,  614,  613,  611,  812,  614,  613,  611,  611,  613,  613,  609,  612,  612,  613,  814,
+     612,  612,  612,  612,  614,  611,  608,  610,  610,  612,  614,  611,  613,  616,  612,  614,
+     613,  812,  613,  611,  613,  610,  613,  613,  612,  610,  613,  613,  611,  614,  614,  613,
+     614,  611,  612,  615,  610,  613,  611,  612,  610,  612,  611,  611,  610,  613,  612,  613,
+     610,  612,  609,  613,  615,  611,  611,  614,  612,  614,  613,  611,  612,  616,  612,  613,
+     613,  611,  613,  612,  613,  613,  612,  613,  614,  611,  613,  610,  612,  612,  612,  612,
+     609,  613,  614,  611,  612,  616,  612,  612,  611,  613,  611,  612,  616,  614,  612,  613,
+     615,  615,  614,  612,  613,  612,  612,  612,  611,  615,  613,  615,  614,  612,  614,  617,
+     611,  614,  615,  612,  615,  613,  611,  612,  611,  614,  612,  613,  613,  613,  610,  612,
+     609,  811,  613,  610,  613,  612,  612,  612,  610,  611,  614,  613,  612,  612,  613,  613,
+     613,  612,  611,  612,  611,  613,  614,  613,  614,  611,  613,  611,  613,  612,  611,  611,
+     610,  613,  614,  610,  610,  613,  812,  614,  611,  614,  614,  612,  612,  613,  612,  611,
+     613,  610,  810,  615,  615,  612,  614,  612,  612,  612,  612,  611,  612,  613,  613,  611,
+     612,  612,  615,  612,  610,  611,  612,  612,  612,  611,  614,  609,  611,  614,  614,  614,
+     613,  612,  613,  612,  613,  612,  613,  610,  812,  615,  610,  611,  613,  611,  614,  612,
+     613,  613,  611,  611,  614,  614,  611,  612,  613,  612,  613,  610,  611,  616,  612,  613,
+     612,  614,  612,  611,  609,  610,  613,  610,  612,  615,  608,  613,  613,  612,  611,  615,
+     612,  612,  611,  611,  613,  610,  612,  613,  615,  615,  614,  610,  614,  611,  614,  613,
+     613,  611,  614,  613,  611,  614,  614,  612,  612,  612,  614,  614,  613,  611,  611,  611,
+     611,  614,  613,  611,  612,  614,  610,  613,  614,  812,  814,  614,  613,  611,  614,  612,
+     611,  612,  610,  613,  611,  613,  611,  611,  613,  613,  611,  613,  615,  613,  612,  612,
+     611,  613,  611,  610,  611,  610,  615,  612,  614,  611,  813,  614,  613,  613,  612,  611,
+     615,  612,  614,  613,  613,  810,  611,  612,  613,  613,  613,  611,  613,  613,  613,  611,
+     612,  614,  610,  612,  615,  616,  613,  613,  612,  614,  612,  811,  611,  610,  613,  611,
+     610,  611,  610,  613,  612,  611,  614,  614,  611,  612,  615,  811,  611,  610,  613,  614,
+     614,  613,  613,  614,  612,  612,  613,  611,  610,  612,  614,  614,  614,  614,  614,  611,
+     611,  613,  610,  613,  614,  611,  612,  614,  610,  612,  613,  614,  613,  814,  612,  612,
+     612,  615,  613,  613,  613,  614,  613,  613,  614,  613,  615,  612,  611,  615,  612,  611,
+     614,  615,  611,  614,  615,  613,  610,  612,  612,  612,  613,  612,  611,  611,  610,  613,
+     611,  611,  614,  612,  615,  618,  612,  613,  612,  613,  612,  610,  608,  612,  614,  613,
+     613,  612,  614,  614,  613,  611,  611,  613,  611,  613,  611,  611,  614,  611,  612,  613,
+     613,  612,  611,  612,  612,  613,  613,  613,  612,  612,  612,  613,  614,  612,  615,  614,
+     613,  615,  612,  613,  613,  611,  613,  614,  612,  613,  616,  612,  614,  613,  614,  614,
+     612,  611,  613,  612,  614,  615,  612,  610,  613,  614,  613,  608,  612,  614,  613,  611,
+     610,  613,  613,  610,  612,  612,  613,  614,  615,  612,  612,  613,  614,  612,  610,  813,
+     615,  613,  608,  611,  613,  613,  612,  612,  613,  614,  613,  812,  612,  609,  612,  614,
+     608,  612,  615,  609,  613,  612,  610,  613,  609,  610,  613,  614,  612,  613,  614,  612,
+     613,  613,  610,  613,  613,  612,  811,  610,  612,  612,  613,  610,  612,  611,  612,  614,
+     615,  614,  613,  610,  608,  612,  613,  615,  814,  613,  609,  612,  613,  609,  612,  811,
+     614,  614,  614,  613,  613,  614,  612,  611,  611,  611,  611,  613,  616,  614,  611,  612,
+};
+
+static const uint16_t mcu_trace[] =
+{
+     355,  356,  357,  357,  358,  358,  355,  354,  355,  356,  357,  354,  555,  354,  356,  354,
+     555,  357,  357,  353,  356,  355,  353,  355,  352,  355,  353,  359,  354,  356,  355,  358,
+     358,  357,  352,  353,  356,  358,  355,  355,  357,  354,  353,  358,  356,  355,  358,  355,
+     355,  353,  355,  355,  356,  355,  355,  356,  354,  354,  356,  355,  354,  356,  357,  353,
+     356,  355,  354,  356,  356,  359,  357,  355,  356,  355,  356,  357,  356,  354,  554,  355,
+     353,  357,  353,  352,  355,  354,  352,  355,  357,  353,  354,  556,  353,  352,  355,  356,
+     355,  357,  356,  355,  355,  358,  356,  355,  355,  356,  358,  353,  355,  356,  355,  357,
+     354,  353,  353,  355,  356,  358,  358,  354,  354,  354,  357,  355,  356,  356,  353,  355,
+     358,  355,  354,  355,  355,  355,  354,  555,  354,  355,  356,  355,  356,  357,  555,  357,
+     354,  355,  355,  356,  355,  355,  355,  354,  355,  353,  358,  355,  355,  353,  356,  354,
+     358,  352,  359,  356,  356,  354,  356,  354,  355,  355,  356,  358,  356,  356,  354,  356,
+     354,  358,  358,  354,  356,  356,  356,  357,  356,  353,  356,  353,  356,  358,  355,  357,
+     355,  356,  355,  357,  355,  356,  354,  355,  355,  356,  355,  354,  353,  355,  355,  355,
+     555,  354,  354,  355,  357,  356,  356,  354,  354,  354,  357,  357,  357,  356,  358,  353,
+     556,  356,  355,  355,  358,  356,  356,  355,  354,  356,  356,  356,  358,  355,  358,  354,
+     355,  355,  355,  355,  553,  354,  358,  355,  355,  553,  358,  356,  356,  357,  353,  354,
+     357,  354,  357,  357,  351,  354,  354,  355,  354,  356,  357,  354,  353,  354,  355,  358,
+     358,  358,  357,  357,  358,  356,  356,  355,  355,  356,  355,  356,  359,  354,  356,  358,
+     355,  355,  352,  353,  353,  357,  355,  355,  355,  356,  355,  354,  357,  355,  353,  354,
+     358,  354,  355,  354,  356,  354,  356,  353,  355,  354,  354,  356,  356,  355,  355,  353,
+     356,  354,  357,  355,  356,  352,  358,  354,  358,  352,  355,  354,  357,  353,  356,  353,
+     360,  357,  353,  353,  353,  356,  355,  354,  354,  353,  359,  353,  354,  358,  357,  355,
+     355,  355,  356,  357,  355,  355,  357,  353,  355,  355,  355,  354,  356,  353,  354,  354,
+     352,  353,  353,  355,  355,  356,  354,  355,  356,  359,  353,  355,  354,  358,  356,  357,
+     356,  355,  357,  355,  355,  357,  355,  354,  359,  355,  355,  354,  356,  358,  355,  356,
+     355,  354,  355,  355,  356,  355,  354,  355,  353,  353,  355,  357,  354,  355,  355,  356,
+     355,  357,  355,  356,  355,  354,  356,  354,  358,  355,  352,  358,  354,  354,  351,  355,
+     356,  357,  558,  357,  357,  356,  355,  354,  355,  357,  356,  356,  355,  356,  352,  358,
+     355,  353,  356,  357,  354,  355,  357,  354,  355,  357,  354,  354,  356,  355,  353,  353,
+     352,  355,  356,  355,  356,  356,  352,  355,  354,  356,  353,  354,  354,  355,  356,  356,
+     355,  356,  358,  353,  355,  555,  355,  355,  356,  355,  358,  557,  356,  354,  355,  357,
+     354,  356,  356,  354,  358,  356,  353,  356,  356,  353,  354,  355,  355,  553,  354,  552,
+     356,  357,  354,  354,  355,  355,  356,  357,  358,  357,  355,  355,  354,  355,  356,  558,
+     356,  356,  356,  357,  355,  553,  355,  354,  356,  357,  356,  354,  357,  353,  355,  354,
+     353,  356,  356,  358,  357,  353,  355,  358,  357,  356,  353,  354,  357,  356,  353,  356,
+     353,  355,  356,  355,  357,  356,  353,  357,  357,  354,  353,  355,  355,  353,  356,  355,
+     353,  356,  357,  354,  355,  355,  355,  357,  357,  357,  355,  355,  359,  354,  555,  357,
+     351,  355,  354,  356,  356,  357,  354,  356,  353,  355,  357,  354,  354,  354,  356,  353,
+     353,  356,  357,  354,  354,  357,  357,  354,  355,  356,  357,  354,  354,  355,  357,  356,
+     355,  357,  353,  356,  355,  357,  356,  355,  357,  353,  358,  355,  354,  353,  353,  355,
+     354,  354,  354,  356,  356,  353,  358,  359,  353,  355,  356,  354,  355,  356,  354,  356,
+     356,  354,  354,  357,  357,  355,  357,  355,  359,  355,  358,  353,  353,  354,  355,  357,
+     355,  354,  353,  355,  356,  357,  355,  355,  353,  355,  357,  553,  358,  356,  356,  357,
+     355,  356,  353,  357,  356,  357,  356,  358,  356,  356,  354,  355,  357,  355,  357,  356,
+     355,  356,  357,  355,  355,  355,  353,  357,  356,  355,  354,  354,  355,  355,  353,  355,
+     356,  355,  354,  357,  356,  354,  357,  354,  356,  354,  355,  356,  355,  358,  357,  354,
+     357,  353,  353,  355,  354,  354,  355,  355,  355,  356,  357,  357,  356,  358,  356,  354,
+     358,  353,  353,  357,  355,  355,  355,  357,  355,  358,  355,  356,  356,  353,  354,  359,
+     356,  356,  355,  357,  354,  357,  355,  552,  355,  356,  354,  356,  358,  355,  358,  355,
+     356,  357,  353,  351,  355,  355,  356,  356,  355,  357,  356,  356,  357,  357,  353,  356,
+     352,  355,  356,  357,  355,  356,  357,  356,  356,  354,  356,  358,  356,  357,  357,  355,
+     358,  356,  355,  358,  356,  356,  354,  354,  558,  352,  354,  358,  354,  356,  357,  356,
+     356,  354,  356,  355,  356,  355,  357,  354,  354,  354,  356,  355,  354,  355,  354,  354,
+     357,  357,  356,  356,  355,  355,  355,  353,  356,  355,  354,  361,  353,  353,  357,  356,
+     357,  356,  355,  354,  354,  356,  354,  354,  355,  355,  556,  354,  356,  355,  356,  354,
+     357,  353,  357,  356,  355,  357,  354,  356,  354,  353,  356,  355,  354,  355,  354,  354,
+     357,  354,  358,  356,  357,  355,  356,  354,  356,  354,  357,  357,  354,  354,  556,  355,
+     356,  355,  353,  353,  353,  356,  357,  354,  353,  353,  352,  357,  352,  354,  354,  355,
+     356,  556,  357,  356,  359,  353,  357,  357,  354,  356,  355,  357,  357,  357,  356,  355,
+     356,  356,  354,  354,  357,  355,  353,  554,  353,  354,  356,  355,  355,  354,  353,  356,
+     355,  554,  356,  354,  355,  353,  357,  353,  354,  357,  356,  357,  355,  358,  356,  355,
+     356,  355,  558,  354,  355,  355,  355,  356,  352,  353,  354,  354,  355,  355,  359,  356,
+     357,  359,  355,  555,  357,  355,  355,  352,  556,  355,  359,  356,  355,  359,  356,  355,
+     353,  353,  357,  353,  356,  357,  354,  356,  354,  357,  355,  355,  354,  355,  359,  353,
+     357,  352,  357,  355,  356,  353,  351,  353,  357,  359,  356,  354,  358,  354,  353,  354,
+     355,  355,  355,  358,  356,  355,  358,  355,  356,  358,  358,  354,  358,  354,  354,  356,
+     356,  356,  353,  355,  359,  351,  355,  355,  354,  357,  353,  357,  354,  355,  353,  354,
+     355,  353,  355,  355,  354,  355,  555,  355,  354,  354,  353,  353,  357,  357,  354,  352,
+     355,  357,  354,  357,  355,  352,  357,  354,  357,  356,  357,  356,  356,  355,  357,  357,
+     356,  554,  356,  354,  357,  356,  356,  354,  353,  356,  355,  355,  356,  559,  356,  358,
+     355,  356,  356,  354,  356,  352,  353,  357,  353,  357,  353,  354,  356,  354,  356,  353,
+     353,  356,  355,  357,  355,  355,  354,  360,  355,  355,  354,  356,  355,  355,  352,  352,
+     354,  354,  355,  358,  357,  356,  354,  355,  356,  355,  356,  358,  356,  353,  354,  357,
+     355,  354,  355,  355,  356,  555,  356,  358,  355,  358,  356,  352,  355,  355,  355,  354,
+     354,  356,  353,  358,  356,  356,  356,  355,  356,  355,  355,  353,  354,  355,  356,  356,
+     355,  355,  353,  357,  354,  357,  355,  356,  355,  356,  354,  356,  354,  356,  354,  354,
+     556,  357,  355,  356,  354,  355,  359,  354,  358,  355,  355,  354,  356,  354,  356,  355,
+     354,  354,  355,  357,  357,  557,  358,  355,  356,  355,  354,  352,  356,  356,  357,  357,
+     353,  357,  356,  356,  356,  354,  354,  356,  351,  355,  358,  354,  356,  557,  356,  357,
+     355,  356,  356,  356,  353,  355,  356,  356,  355,  354,  356,  355,  354,  355,  355,  355,
+     357,  354,  359,  355,  355,  357,  353,  354,  354,  356,  357,  356,  355,  356,  354,  355,
+     356,  355,  356,  354,  356,  353,  356,  356,  357,  355,  358,  356,  352,  356,  354,  356,
+     355,  355,  358,  359,  356,  353,  358,  355,  354,  356,  352,  354,  354,  354,  355,  356,
+     357,  359,  558,  353,  355,  354,  358,  355,  354,  358,  354,  356,  352,  354,  357,  355,
+     356,  357,  355,  356,  355,  356,  355,  356,  352,  355,  358,  354,  355,  352,  358,  353,
+     355,  354,  356,  357,  359,  359,  356,  356,  555,  355,  358,  357,  355,  355,  355,  356,
+     355,  355,  355,  355,  355,  355,  357,  355,  355,  355,  354,  356,  357,  356,  355,  355,
+     355,  355,  357,  354,  356,  354,  355,  355,  354,  355,  358,  356,  354,  355,  355,  355,
+     357,  354,  357,  353,  356,  356,  357,  357,  354,  355,  357,  555,  355,  358,  355,  356,
+     354,  355,  357,  358,  358,  358,  355,  355,  354,  353,  354,  353,  356,  357,  355,  355,
+     357,  555,  356,  354,  354,  355,  355,  357,  355,  355,  357,  357,  357,  357,  357,  355,
+     353,  557,  355,  359,  358,  356,  353,  355,  355,  553,  357,  357,  354,  357,  354,  356,
+     356,  355,  355,  355,  356,  354,  352,  355,  357,  354,  357,  354,  356,  354,  356,  354,
+     355,  356,  354,  354,  353,  353,  354,  353,  353,  351,  354,  357,  353,  356,  358,  355,
+     356,  355,  356,  356,  356,  355,  356,  354,  353,  555,  354,  356,  353,  355,  354,  357,
+     356,  354,  356,  353,  355,  356,  355,  355,  355,  356,  356,  351,  355,  359,  357,  355,
+     356,  355,  353,  359,  356,  357,  358,  357,  354,  354,  357,  353,  357,  359,  358,  357,
+     354,  357,  354,  354,  357,  354,  356,  355,  356,  356,  356,  355,  352,  357,  355,  355,
+     356,  357,  355,  357,  355,  356,  356,  355,  354,  353,  356,  354,  358,  356,  356,  355,
+     353,  352,  357,  355,  358,  359,  353,  353,  354,  358,  357,  355,  355,  356,  356,  354,
+     356,  357,  358,  356,  354,  355,  352,  354,  355,  355,  356,  355,  355,  356,  356,  353,
+     356,  354,  358,  355,  354,  355,  356,  356,  355,  355,  357,  357,  355,  356,  356,  355,
+     355,  356,  355,  354,  357,  356,  354,  358,  356,  354,  356,  356,  357,  354,  353,  356,
+     355,  355,  356,  357,  354,  354,  357,  354,  554,  353,  355,  356,  355,  353,  354,  354,
+     357,  356,  354,  353,  356,  354,  355,  353,  354,  357,  354,  354,  356,  359,  355,  353,
+     356,  355,  358,  356,  354,  354,  357,  358,  356,  353,  357,  358,  357,  355,  355,  352,
+     355,  353,  356,  354,  355,  356,  352,  358,  355,  353,  357,  358,  355,  358,  354,  356,
+     354,  358,  356,  356,  357,  355,  356,  354,  355,  356,  354,  355,  354,  356,  358,  355,
+     554,  557,  356,  355,  354,  356,  354,  355,  554,  355,  356,  355,  356,  354,  354,  354,
+     354,  354,  355,  355,  358,  357,  355,  352,  354,  354,  356,  355,  355,  353,  359,  354,
+     355,  356,  357,  355,  354,  355,  354,  354,  355,  356,  356,  358,  355,  355,  357,  355,
+     357,  356,  358,  356,  357,  357,  355,  355,  355,  358,  355,  355,  355,  355,  356,  356,
+     356,  356,  355,  353,  354,  356,  355,  555,  353,  355,  356,  356,  355,  354,  353,  356,
+     358,  354,  355,  356,  356,  354,  356,  355,  355,  354,  357,  356,  354,  358,  354,  353,
+     356,  356,  354,  353,  355,  357,  554,  355,  358,  356,  356,  358,  354,  357,  356,  354,
+     357,  357,  355,  357,  355,  355,  355,  355,  354,  354,  356,  355,  354,  355,  355,  353,
+     355,  354,  355,  356,  359,  353,  356,  355,  354,  357,  355,  357,  356,  356,  356,  354,
+     358,  357,  357,  353,  356,  355,  357,  354,  353,  551,  355,  555,  356,  356,  354,  354,
+     354,  353,  359,  354,  355,  353,  355,  354,  354,  356,  358,  355,  355,  352,  355,  354,
+     357,  357,  353,  358,  357,  355,  354,  356,  360,  355,  356,  352,  352,  353,  355,  356,
+};
+
+#endif /* ADC_TRACES_H_ */
@@ -0,0 +1,254 @@
+/**
+ * \file test_adc_filter.cpp
+ *
+ * \brief AdcFilter host tests - pio test -e native
+ *
+ * Runs the NTC and MCU filter configurations over the traces of
+ *   adc_traces.h and checks the noise reduction against the plain means
+ *   they replaced, then the filter stages one by one.
+ */
+#include <unity.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "adc_filter.h"
+#include "adc_traces.h"
+
+/** As ntc_temperature.cpp: median of 3, 16 samples decimated to 12 bits, EMA 1/4 */
+typedef AdcFilterConfig<3, 2, 2> NtcFilterConfig;
+/** As mcu_temperature_access.cpp: median of 3, 4 samples decimated to 11 bits, EMA 1/8 */
+typedef AdcFilterConfig<3, 1, 3> McuFilterConfig;
+
+#define TRACE_LENGTH(trace) (sizeof(trace) / sizeof((trace)[0]))
+
+/**
+ * \brief Mean and standard deviation of a series of outputs, in 10 bit LSB
+ */
+typedef struct TraceStats
+{
+    double   mean;
+    double   sd;
+    uint16_t outputs;
+} TRACE_STATS_t;
+
+static void statsAdd(TRACE_STATS_t *stats, double *sum_sq, double value)
+{
+    stats->mean += value;
+    *sum_sq += value * value;
+    stats->outputs++;
+}
+
+static void statsDone(TRACE_STATS_t *stats, double sum_sq)
+{
+    stats->mean /= stats->outputs;
+    stats->sd = sqrt(sum_sq / stats->outputs - stats->mean * stats->mean);
+}
+
+/** Filter outputs over a trace */
+template <class CONFIG>
+static TRACE_STATS_t runFilter(const uint16_t *trace, uint16_t length)
+{
+    AdcFilter<CONFIG> filter;
+    TRACE_STATS_t stats = {0.0, 0.0, 0};
+    double sum_sq = 0.0;
+
+    for (uint16_t i = 0; i < length; i++)
+    {
+        if (filter.push(trace[i]))
+        {
+            statsAdd(&stats, &sum_sq, filter.value() / (double)(1U << CONFIG::OVERSAMPLE_BITS));
+        }
+    }
+    statsDone(&stats, sum_sq);
+    return stats;
+}
+
+/** Truncated means of 'n' samples - the readings before the filter stage */
+static TRACE_STATS_t runPlainMean(const uint16_t *trace, uint16_t length, uint8_t n)
+{
+    TRACE_STATS_t stats = {0.0, 0.0, 0};
+    double sum_sq = 0.0;
+
+    for (uint16_t i = 0; i + n <= length; i += n)
+    {
+        uint32_t sum = 0;
+        for (uint8_t j = 0; j < n; j++)
+        {
+            sum += trace[i + j];
+        }
+        statsAdd(&stats, &sum_sq, (double)(sum / n));
+    }
+    statsDone(&stats, sum_sq);
+    return stats;
+}
+
+static void reportStats(const char *name, const TRACE_STATS_t *stats, double level)
+{
+    char line[80];
+    snprintf(line, sizeof(line), "%s: %u outputs, SD %.3f LSB, bias %+.3f LSB", name, stats->outputs, stats->sd,
+             stats->mean - level);
+    TEST_MESSAGE(line);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/** NTC: the filter against the 30-sample mean it replaced */
+static void test_ntc_trace_noise_reduction(void)
+{
+    TRACE_STATS_t plain = runPlainMean(ntc_trace, TRACE_LENGTH(ntc_trace), 30U);
+    TRACE_STATS_t filtered = runFilter<NtcFilterConfig>(ntc_trace, TRACE_LENGTH(ntc_trace));
+    reportStats("NTC 30-sample mean", &plain, NTC_TRACE_LEVEL);
+    reportStats("NTC filter", &filtered, NTC_TRACE_LEVEL);
+
+    TEST_ASSERT_EQUAL_UINT16(TRACE_LENGTH(ntc_trace) / NtcFilterConfig::SAMPLES_PER_OUTPUT, filtered.outputs);
+    /* Spikes: the mean moves up with them, the median drops them - but two in a row */
+    TEST_ASSERT_LESS_THAN_FLOAT(plain.sd / 4.0, filtered.sd);
+    TEST_ASSERT_LESS_THAN_FLOAT(fabs(plain.mean - NTC_TRACE_LEVEL) / 4.0, fabs(filtered.mean - NTC_TRACE_LEVEL));
+    TEST_ASSERT_FLOAT_WITHIN(1.0, NTC_TRACE_LEVEL, filtered.mean);
+}
+
+/** MCU: the filter against the mean of one sampler burst it replaced */
+static void test_mcu_trace_noise_reduction(void)
+{
+    TRACE_STATS_t plain = runPlainMean(mcu_trace, TRACE_LENGTH(mcu_trace), 4U);
+    TRACE_STATS_t filtered = runFilter<McuFilterConfig>(mcu_trace, TRACE_LENGTH(mcu_trace));
+    reportStats("MCU burst mean", &plain, MCU_TRACE_LEVEL);
+    reportStats("MCU filter", &filtered, MCU_TRACE_LEVEL);
+
+    TEST_ASSERT_EQUAL_UINT16(TRACE_LENGTH(mcu_trace) / McuFilterConfig::SAMPLES_PER_OUTPUT, filtered.outputs);
+    TEST_ASSERT_LESS_THAN_FLOAT(plain.sd / 4.0, filtered.sd);
+    TEST_ASSERT_LESS_THAN_FLOAT(fabs(plain.mean - MCU_TRACE_LEVEL) / 4.0, fabs(filtered.mean - MCU_TRACE_LEVEL));
+    TEST_ASSERT_FLOAT_WITHIN(1.0, MCU_TRACE_LEVEL, filtered.mean);
+}
+
+/** An output every SAMPLES_PER_OUTPUT samples, of RESULT_BITS bits */
+static void test_output_every_decimation_window(void)
+{
+    AdcFilter<NtcFilterConfig> filter;
+
+    for (uint8_t i = 1; i < NtcFilterConfig::SAMPLES_PER_OUTPUT; i++)
+    {
+        TEST_ASSERT_FALSE(filter.push(500U));
+    }
+    TEST_ASSERT_TRUE(filter.push(500U));
+    TEST_ASSERT_EQUAL_UINT16(500U << NtcFilterConfig::OVERSAMPLE_BITS, filter.decimated());
+    TEST_ASSERT_EQUAL_UINT16(500U << NtcFilterConfig::OVERSAMPLE_BITS, filter.value());
+
+    /* Full scale fits RESULT_BITS */
+    filter.reset();
+    for (uint8_t i = 0; i < NtcFilterConfig::SAMPLES_PER_OUTPUT; i++)
+    {
+        filter.push(1023U);
+    }
+    TEST_ASSERT_TRUE(filter.value() < (1U << NtcFilterConfig::RESULT_BITS));
+}
+
+/** A single sample spike does not reach the output */
+static void test_median_drops_single_spikes(void)
+{
+    AdcFilter<NtcFilterConfig> filter;
+
+    for (uint8_t i = 0; i < NtcFilterConfig::SAMPLES_PER_OUTPUT; i++)
+    {
+        filter.push(((i % 5U) == 2U) ? 1000U : 300U);
+    }
+    TEST_ASSERT_EQUAL_UINT16(300U << NtcFilterConfig::OVERSAMPLE_BITS, filter.decimated());
+}
+
+/** Oversampling resolves a level between two codes */
+static void test_decimation_adds_resolution(void)
+{
+    AdcFilter<AdcFilterConfig<1, 2, 0> > filter;
+
+    /* 400.25: one sample in four at 401 */
+    for (uint8_t i = 0; i < 16U; i++)
+    {
+        filter.push(((i % 4U) == 0U) ? 401U : 400U);
+    }
+    TEST_ASSERT_EQUAL_UINT16((400U << 2) + 1U, filter.value());
+}
+
+/** The EMA follows a step at 1/2^EMA_SHIFT per output */
+static void test_ema_follows_a_step(void)
+{
+    AdcFilter<AdcFilterConfig<1, 0, 2> > filter;
+
+    filter.push(400U);
+    TEST_ASSERT_EQUAL_UINT16(400U, filter.value());
+    filter.push(800U);
+    TEST_ASSERT_EQUAL_UINT16(500U, filter.value());
+    TEST_ASSERT_EQUAL_UINT16(800U, filter.decimated());
+    filter.push(800U);
+    TEST_ASSERT_EQUAL_UINT16(575U, filter.value());
+}
+
+/** reset() drops the window, the partial sum and the average */
+static void test_reset_restarts_the_filter(void)
+{
+    AdcFilter<NtcFilterConfig> filter;
+
+    for (uint16_t i = 0; i < 40U; i++)
+    {
+        filter.push(200U);
+    }
+    filter.reset();
+
+    /* A whole window again before an output, and no trace of the old level */
+    for (uint8_t i = 1; i < NtcFilterConfig::SAMPLES_PER_OUTPUT; i++)
+    {
+        TEST_ASSERT_FALSE(filter.push(900U));
+    }
+    TEST_ASSERT_TRUE(filter.push(900U));
+    TEST_ASSERT_EQUAL_UINT16(900U << NtcFilterConfig::OVERSAMPLE_BITS, filter.decimated());
+    TEST_ASSERT_EQUAL_UINT16(900U << NtcFilterConfig::OVERSAMPLE_BITS, filter.value());
+}
+
+/** restart() drops the window and the partial sum, and keeps the average */
+static void test_restart_keeps_the_average(void)
+{
+    AdcFilter<AdcFilterConfig<3, 2, 2> > filter;
+
+    for (uint8_t i = 0; i < 16U; i++)
+    {
+        filter.push(400U);
+    }
+    TEST_ASSERT_EQUAL_UINT16(400U << 2, filter.value());
+
+    /* A measurement cut short - its samples must not reach the next output */
+    for (uint8_t i = 0; i < 10U; i++)
+    {
+        filter.push(1000U);
+    }
+    filter.restart();
+
+    for (uint8_t i = 1; i < 16U; i++)
+    {
+        TEST_ASSERT_FALSE(filter.push(800U));
+    }
+    TEST_ASSERT_TRUE(filter.push(800U));
+    TEST_ASSERT_EQUAL_UINT16(800U << 2, filter.decimated());
+    /* EMA 1/4 from 400 */
+    TEST_ASSERT_EQUAL_UINT16(500U << 2, filter.value());
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ntc_trace_noise_reduction);
+    RUN_TEST(test_mcu_trace_noise_reduction);
+    RUN_TEST(test_output_every_decimation_window);
+    RUN_TEST(test_median_drops_single_spikes);
+    RUN_TEST(test_decimation_adds_resolution);
+    RUN_TEST(test_ema_follows_a_step);
+    RUN_TEST(test_reset_restarts_the_filter);
+    RUN_TEST(test_restart_keeps_the_average);
+    return UNITY_END();
+}
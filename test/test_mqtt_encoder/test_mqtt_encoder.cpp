@@ -0,0 +1,157 @@
+/**
+ * \file test_mqtt_encoder.cpp
+ *
+ * \brief MQTT encoder host tests - pio test -e native
+ *
+ * Checks the packets against byte vectors written from the MQTT 3.1.1
+ *   standard, and that a buffer one byte too small gets nothing written.
+ */
+#include <unity.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mqtt_encoder.h"
+
+/** Filler of the bytes past a packet - must stay untouched */
+#define GUARD 0xA5U
+
+static const MQTT_TOPIC_t topic_ab = MQTT_TOPIC("a/b");
+
+static uint8_t buffer[300];
+
+void setUp(void)
+{
+    memset(buffer, GUARD, sizeof(buffer));
+}
+
+void tearDown(void)
+{
+}
+
+static void checkRemainingLength(uint16_t length, const uint8_t *expected, uint8_t expected_len)
+{
+    TEST_ASSERT_EQUAL_UINT8(expected_len, MqttEncodeRemainingLength(buffer, length));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buffer, expected_len);
+    TEST_ASSERT_EQUAL_HEX8(GUARD, buffer[expected_len]);
+}
+
+static void test_remaining_length_boundaries(void)
+{
+    static const uint8_t len_0[] = { 0x00 };
+    static const uint8_t len_127[] = { 0x7F };
+    static const uint8_t len_128[] = { 0x80, 0x01 };
+    static const uint8_t len_16383[] = { 0xFF, 0x7F };
+    static const uint8_t len_16384[] = { 0x80, 0x80, 0x01 };
+    static const uint8_t len_65535[] = { 0xFF, 0xFF, 0x03 };
+
+    checkRemainingLength(0U, len_0, sizeof(len_0));
+    checkRemainingLength(127U, len_127, sizeof(len_127));
+    checkRemainingLength(128U, len_128, sizeof(len_128));
+    checkRemainingLength(16383U, len_16383, sizeof(len_16383));
+    checkRemainingLength(16384U, len_16384, sizeof(len_16384));
+    checkRemainingLength(65535U, len_65535, sizeof(len_65535));
+}
+
+static void test_connect_packet(void)
+{
+    static const uint8_t expected[] =
+    {
+        0x10, 0x0E,                                 // CONNECT, remaining 14
+        0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04,       // protocol name, level 4
+        0x02,                                       // clean session
+        0x00, 0x3C,                                 // keep alive 60s
+        0x00, 0x02, 'A', '1'                        // client identifier
+    };
+
+    TEST_ASSERT_EQUAL_UINT16(sizeof(expected), MqttEncodeConnect(buffer, sizeof(buffer), "A1", 60U, true));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buffer, sizeof(expected));
+    TEST_ASSERT_EQUAL_HEX8(GUARD, buffer[sizeof(expected)]);
+
+    /* Session kept: no flag */
+    TEST_ASSERT_EQUAL_UINT16(sizeof(expected), MqttEncodeConnect(buffer, sizeof(buffer), "A1", 60U, false));
+    TEST_ASSERT_EQUAL_HEX8(0x00, buffer[9]);
+}
+
+static void test_publish_qos0_packet(void)
+{
+    static const uint8_t expected[] = { 0x30, 0x07, 0x00, 0x03, 'a', '/', 'b', 'h', 'i' };
+
+    TEST_ASSERT_EQUAL_UINT16(sizeof(expected), MqttEncodePublish(buffer, sizeof(buffer), &topic_ab,
+                                                                 (const uint8_t *)"hi", 2U, MQTT_QOS_0, 0x1234U));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buffer, sizeof(expected));
+    TEST_ASSERT_EQUAL_HEX8(GUARD, buffer[sizeof(expected)]);
+}
+
+static void test_publish_qos1_packet(void)
+{
+    static const uint8_t expected[] = { 0x32, 0x09, 0x00, 0x03, 'a', '/', 'b', 0x12, 0x34, 'h', 'i' };
+
+    TEST_ASSERT_EQUAL_UINT16(sizeof(expected), MqttEncodePublish(buffer, sizeof(buffer), &topic_ab,
+                                                                 (const uint8_t *)"hi", 2U, MQTT_QOS_1, 0x1234U));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buffer, sizeof(expected));
+    TEST_ASSERT_EQUAL_HEX8(GUARD, buffer[sizeof(expected)]);
+}
+
+/** A payload pushing the Remaining Length past 127 takes a second length byte */
+static void test_publish_two_byte_length(void)
+{
+    uint8_t payload[200];
+    memset(payload, 'x', sizeof(payload));
+
+    /* 2 + 3 topic + 2 packet id + 200 = 207 */
+    TEST_ASSERT_EQUAL_UINT16(3U + 207U, MqttEncodePublish(buffer, sizeof(buffer), &topic_ab, payload,
+                                                         sizeof(payload), MQTT_QOS_1, 1U));
+    TEST_ASSERT_EQUAL_HEX8(0x32, buffer[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xCF, buffer[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, buffer[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, buffer[3]);
+    TEST_ASSERT_EQUAL_HEX8(0x03, buffer[4]);
+    TEST_ASSERT_EQUAL_HEX8('x', buffer[3U + 206U]);
+    TEST_ASSERT_EQUAL_HEX8(GUARD, buffer[3U + 207U]);
+}
+
+static void test_ping_and_disconnect_packets(void)
+{
+    static const uint8_t pingreq[] = { 0xC0, 0x00 };
+    static const uint8_t disconnect[] = { 0xE0, 0x00 };
+
+    TEST_ASSERT_EQUAL_UINT16(2U, MqttEncodePingreq(buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(pingreq, buffer, sizeof(pingreq));
+    TEST_ASSERT_EQUAL_UINT16(2U, MqttEncodeDisconnect(buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(disconnect, buffer, sizeof(disconnect));
+}
+
+/** Exactly the packet size fits; one byte less gives 0 and writes nothing */
+static void test_too_small_buffer(void)
+{
+    TEST_ASSERT_EQUAL_UINT16(0U, MqttEncodeConnect(buffer, 15U, "A1", 60U, true));
+    TEST_ASSERT_EQUAL_HEX8(GUARD, buffer[0]);
+    TEST_ASSERT_EQUAL_UINT16(16U, MqttEncodeConnect(buffer, 16U, "A1", 60U, true));
+
+    setUp();
+    TEST_ASSERT_EQUAL_UINT16(0U, MqttEncodePublish(buffer, 10U, &topic_ab, (const uint8_t *)"hi", 2U,
+                                                   MQTT_QOS_1, 1U));
+    TEST_ASSERT_EQUAL_HEX8(GUARD, buffer[0]);
+    TEST_ASSERT_EQUAL_UINT16(11U, MqttEncodePublish(buffer, 11U, &topic_ab, (const uint8_t *)"hi", 2U,
+                                                    MQTT_QOS_1, 1U));
+
+    setUp();
+    TEST_ASSERT_EQUAL_UINT16(0U, MqttEncodePingreq(buffer, 1U));
+    TEST_ASSERT_EQUAL_HEX8(GUARD, buffer[0]);
+    TEST_ASSERT_EQUAL_UINT16(0U, MqttEncodeDisconnect(buffer, 0U));
+    TEST_ASSERT_EQUAL_HEX8(GUARD, buffer[0]);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_remaining_length_boundaries);
+    RUN_TEST(test_connect_packet);
+    RUN_TEST(test_publish_qos0_packet);
+    RUN_TEST(test_publish_qos1_packet);
+    RUN_TEST(test_publish_two_byte_length);
+    RUN_TEST(test_ping_and_disconnect_packets);
+    RUN_TEST(test_too_small_buffer);
+    return UNITY_END();
+}
@@ -0,0 +1,196 @@
+/**
+ * \file test_mqtt_session.cpp
+ *
+ * \brief MQTT session inbound decoder host tests - pio test -e native
+ *
+ * Feeds broker packets to MqttSessionReceive() - whole, split over two
+ *   +IPD frames, or back to back in one - and malformed Remaining Lengths.
+ */
+#include <unity.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mqtt_encoder.h"
+#include "mqtt_session.h"
+
+static const MQTT_TOPIC_t topic_ab = MQTT_TOPIC("a/b");
+
+static uint8_t buffer[64];
+
+/** Packet identifiers given to the PUBACK handler */
+static uint16_t acked_ids[4];
+static uint8_t  acked_count;
+
+static void pubackHandler(uint16_t packet_id)
+{
+    if (acked_count < sizeof(acked_ids) / sizeof(acked_ids[0]))
+    {
+        acked_ids[acked_count] = packet_id;
+    }
+    acked_count++;
+}
+
+static void receive(const uint8_t *data, uint8_t len)
+{
+    MqttSessionReceive(data, len);
+}
+
+static void connectSession(void)
+{
+    static const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+
+    MqttSessionLinkDown();
+    TEST_ASSERT_TRUE(MqttSessionConnect(buffer, sizeof(buffer), "A1") > 0U);
+    TEST_ASSERT_EQUAL_INT(MQTT_SESSION_CONNECTING, MqttSessionState());
+    receive(connack, sizeof(connack));
+    TEST_ASSERT_EQUAL_INT(MQTT_SESSION_CONNECTED, MqttSessionState());
+}
+
+/** Publishes "hi" to a/b, returning its packet identifier */
+static uint16_t publish(void)
+{
+    TEST_ASSERT_TRUE(MqttSessionPublish(buffer, sizeof(buffer), &topic_ab, (const uint8_t *)"hi", 2U) > 0U);
+    /* Fixed header (2), topic (2 + 3), then the packet identifier */
+    return (uint16_t)((buffer[7] << 8) | buffer[8]);
+}
+
+static void puback(uint16_t packet_id)
+{
+    const uint8_t packet[] = { 0x40, 0x02, (uint8_t)(packet_id >> 8), (uint8_t)(packet_id & 0xFFU) };
+    receive(packet, sizeof(packet));
+}
+
+void setUp(void)
+{
+    connectSession();
+}
+
+void tearDown(void)
+{
+    /* Empty the window for the next test */
+    connectSession();
+    for (uint16_t id = 1U; (MqttSessionInFlight() > 0U) && (id < 64U); id++)
+    {
+        puback(id);
+    }
+    MqttSessionLinkDown();
+    MqttSessionSetPubackHandler(NULL);
+    acked_count = 0;
+}
+
+static void test_connack_refused(void)
+{
+    static const uint8_t refused[] = { 0x20, 0x02, 0x00, 0x05 };
+
+    MqttSessionLinkDown();
+    MqttSessionConnect(buffer, sizeof(buffer), "A1");
+    receive(refused, sizeof(refused));
+    TEST_ASSERT_EQUAL_INT(MQTT_SESSION_LOST, MqttSessionState());
+}
+
+static void test_puback_releases_its_packet(void)
+{
+    uint16_t first = publish();
+    uint16_t second = publish();
+    TEST_ASSERT_EQUAL_UINT8(2U, MqttSessionInFlight());
+
+    puback(second);
+    TEST_ASSERT_EQUAL_UINT8(1U, MqttSessionInFlight());
+    /* Unknown identifier: nothing released */
+    puback((uint16_t)(second + 7U));
+    TEST_ASSERT_EQUAL_UINT8(1U, MqttSessionInFlight());
+    puback(first);
+    TEST_ASSERT_EQUAL_UINT8(0U, MqttSessionInFlight());
+}
+
+static void test_puback_split_over_two_frames(void)
+{
+    uint16_t id = publish();
+    const uint8_t head[] = { 0x40, 0x02, (uint8_t)(id >> 8) };
+    const uint8_t tail[] = { (uint8_t)(id & 0xFFU) };
+
+    receive(head, sizeof(head));
+    TEST_ASSERT_EQUAL_UINT8(1U, MqttSessionInFlight());
+    receive(tail, sizeof(tail));
+    TEST_ASSERT_EQUAL_UINT8(0U, MqttSessionInFlight());
+}
+
+static void test_packets_back_to_back(void)
+{
+    uint16_t first = publish();
+    uint16_t second = publish();
+    const uint8_t frame[] =
+    {
+        0xD0, 0x00,                                                         // PINGRESP
+        0x40, 0x02, (uint8_t)(first >> 8), (uint8_t)(first & 0xFFU),        // PUBACK
+        0x40, 0x02, (uint8_t)(second >> 8), (uint8_t)(second & 0xFFU)       // PUBACK
+    };
+
+    receive(frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_UINT8(0U, MqttSessionInFlight());
+    TEST_ASSERT_EQUAL_INT(MQTT_SESSION_CONNECTED, MqttSessionState());
+}
+
+/** The handler gets the identifier of each PUBLISH acknowledged, once */
+static void test_puback_handler(void)
+{
+    MqttSessionSetPubackHandler(&pubackHandler);
+    uint16_t first = publish();
+    TEST_ASSERT_EQUAL_UINT16(first, MqttSessionLastPacketId());
+    uint16_t second = publish();
+    TEST_ASSERT_EQUAL_UINT16(second, MqttSessionLastPacketId());
+
+    puback(second);
+    /* Unknown, or already acknowledged: not handed over */
+    puback((uint16_t)(second + 7U));
+    puback(second);
+    puback(first);
+    TEST_ASSERT_EQUAL_UINT8(2U, acked_count);
+    TEST_ASSERT_EQUAL_UINT16(second, acked_ids[0]);
+    TEST_ASSERT_EQUAL_UINT16(first, acked_ids[1]);
+}
+
+/** 65535, the largest Remaining Length taken: three bytes */
+static void test_largest_remaining_length(void)
+{
+    static const uint8_t header[] = { 0x30, 0xFF, 0xFF, 0x03 };
+
+    receive(header, sizeof(header));
+    TEST_ASSERT_EQUAL_INT(MQTT_SESSION_CONNECTED, MqttSessionState());
+}
+
+/** A 4th Remaining Length byte gives the session up, and the rest of the stream is ignored */
+static void test_fourth_length_byte_rejected(void)
+{
+    static const uint8_t header[] = { 0x30, 0xFF, 0xFF, 0xFF, 0x7F };
+    uint16_t id = publish();
+
+    receive(header, sizeof(header));
+    TEST_ASSERT_EQUAL_INT(MQTT_SESSION_LOST, MqttSessionState());
+    puback(id);
+    TEST_ASSERT_EQUAL_UINT8(1U, MqttSessionInFlight());
+}
+
+/** A 3rd Remaining Length byte over 3 does not fit 16 bits either */
+static void test_third_length_byte_over_64k_rejected(void)
+{
+    static const uint8_t header[] = { 0x30, 0x80, 0x80, 0x04 };
+
+    receive(header, sizeof(header));
+    TEST_ASSERT_EQUAL_INT(MQTT_SESSION_LOST, MqttSessionState());
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_connack_refused);
+    RUN_TEST(test_puback_releases_its_packet);
+    RUN_TEST(test_puback_split_over_two_frames);
+    RUN_TEST(test_packets_back_to_back);
+    RUN_TEST(test_puback_handler);
+    RUN_TEST(test_largest_remaining_length);
+    RUN_TEST(test_fourth_length_byte_rejected);
+    RUN_TEST(test_third_length_byte_over_64k_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+/**
+ * \file test_sample_store.cpp
+ *
+ * \brief Sample store host tests - pio test -e native
+ *
+ * Runs the store over the native HAL's EEPROM: delivery confirmation, the
+ *   age across the millisecond clock wrap, the power on rescan, and a full
+ *   ring overwritten over several laps and sequence wraps.
+ */
+#include <unity.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <avr/eeprom.h>
+
+#include "tasks.h"
+#include "timer.h"
+#include "eeprom_map.h"
+#include "sample_store.h"
+
+/** Records in the ring - 8 byte records, as sample_store.cpp */
+#define STORE_SLOTS (EEPROM_SAMPLE_STORE_SIZE / 8U)
+
+/** Runs the medium task until every queued write and forwarded mark is done */
+static void drain(void)
+{
+    for (uint16_t i = 0; i < 2U * 9U * STORE_SLOTS; i++)
+    {
+        SAMPLE_STORE_run(MEDIUM_TIME_TASK);
+    }
+}
+
+/** A reset: the RAM state is rebuilt from the EEPROM */
+static void powerOn(void)
+{
+    SAMPLE_STORE_run(POWERON_TASK);
+}
+
+static void store(uint8_t metric, uint16_t value)
+{
+    TEST_ASSERT_TRUE(SampleStoreAppend(metric, value));
+    drain();
+}
+
+void setUp(void)
+{
+    drain();
+    memset(&HalEepromData()[EEPROM_SAMPLE_STORE_ADDR], 0xFF, EEPROM_SAMPLE_STORE_SIZE);
+    SetSystemTime(0U);
+    powerOn();
+}
+
+void tearDown(void)
+{
+}
+
+/** A reading handed out stays in the store until its delivery is confirmed, oldest first */
+static void test_forwarded_on_acknowledge(void)
+{
+    STORED_SAMPLE_t first;
+    STORED_SAMPLE_t second;
+
+    store(0U, 100U);
+    store(1U, 200U);
+    store(2U, 300U);
+    TEST_ASSERT_EQUAL_UINT8(3U, SampleStoreCount());
+
+    TEST_ASSERT_TRUE(SampleStoreNext(&first));
+    TEST_ASSERT_EQUAL_UINT8(0U, first.metric);
+    TEST_ASSERT_EQUAL_UINT16(100U, first.value);
+    TEST_ASSERT_TRUE(first.aged);
+    TEST_ASSERT_TRUE(SampleStoreNext(&second));
+    TEST_ASSERT_EQUAL_UINT16(200U, second.value);
+    TEST_ASSERT_EQUAL_UINT8(3U, SampleStoreCount());
+
+    /* Not confirmed: handed out again */
+    SampleStoreRewind();
+    TEST_ASSERT_TRUE(SampleStoreNext(&first));
+    TEST_ASSERT_EQUAL_UINT16(100U, first.value);
+
+    /* Out of order: ignored */
+    SampleStoreAcknowledge(second.slot);
+    TEST_ASSERT_EQUAL_UINT8(3U, SampleStoreCount());
+    SampleStoreAcknowledge(first.slot);
+    TEST_ASSERT_EQUAL_UINT8(2U, SampleStoreCount());
+
+    TEST_ASSERT_TRUE(SampleStoreNext(&second));
+    TEST_ASSERT_EQUAL_UINT16(200U, second.value);
+}
+
+/** A reading stored before the 2^32 ms wrap and forwarded after it keeps its true age */
+static void test_age_across_clock_wrap(void)
+{
+    STORED_SAMPLE_t sample;
+
+    SetSystemTime(UINT32_MAX - 1500U);
+    store(0U, 100U);
+    SetSystemTime(2500U);
+
+    TEST_ASSERT_TRUE(SampleStoreNext(&sample));
+    TEST_ASSERT_TRUE(sample.aged);
+    /* 1501 + 2500 ms */
+    TEST_ASSERT_EQUAL_UINT32(4U, sample.age);
+}
+
+/** At power on, the readings not forwarded are found again - their age unknown */
+static void test_power_on_rescan(void)
+{
+    STORED_SAMPLE_t sample;
+
+    for (uint16_t value = 1U; value <= 4U; value++)
+    {
+        store(0U, value);
+    }
+    TEST_ASSERT_TRUE(SampleStoreNext(&sample));
+    SampleStoreAcknowledge(sample.slot);
+    /* A reading handed out, not confirmed when the reset comes */
+    TEST_ASSERT_TRUE(SampleStoreNext(&sample));
+    drain();
+
+    powerOn();
+    TEST_ASSERT_EQUAL_UINT8(3U, SampleStoreCount());
+    store(0U, 5U);
+
+    for (uint16_t value = 2U; value <= 5U; value++)
+    {
+        TEST_ASSERT_TRUE(SampleStoreNext(&sample));
+        TEST_ASSERT_EQUAL_UINT16(value, sample.value);
+        /* Only the reading taken since power on has an age */
+        TEST_ASSERT_TRUE(sample.aged == (5U == value));
+    }
+    TEST_ASSERT_FALSE(SampleStoreNext(&sample));
+}
+
+/** A full ring overwrites its oldest reading - over laps and sequence wraps, and a rescan */
+static void test_full_ring_overwrites_oldest(void)
+{
+    const uint16_t total = 300U;
+    SAMPLE_STORE_STATS_t before;
+    SAMPLE_STORE_STATS_t after;
+    STORED_SAMPLE_t sample;
+
+    SampleStoreGetStats(&before);
+    for (uint16_t i = 0; i < total; i++)
+    {
+        store(1U, (uint16_t)(1000U + i));
+    }
+    SampleStoreGetStats(&after);
+    TEST_ASSERT_EQUAL_UINT8(STORE_SLOTS, SampleStoreCount());
+    TEST_ASSERT_EQUAL_UINT16(total - STORE_SLOTS, after.overwritten - before.overwritten);
+
+    powerOn();
+    TEST_ASSERT_EQUAL_UINT8(STORE_SLOTS, SampleStoreCount());
+    for (uint16_t i = total - STORE_SLOTS; i < total; i++)
+    {
+        TEST_ASSERT_TRUE(SampleStoreNext(&sample));
+        TEST_ASSERT_EQUAL_UINT8(1U, sample.metric);
+        TEST_ASSERT_EQUAL_UINT16(1000U + i, sample.value);
+        SampleStoreAcknowledge(sample.slot);
+    }
+    TEST_ASSERT_EQUAL_UINT8(0U, SampleStoreCount());
+
+    /* The forwarded marks reach the EEPROM */
+    drain();
+    powerOn();
+    TEST_ASSERT_EQUAL_UINT8(0U, SampleStoreCount());
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_forwarded_on_acknowledge);
+    RUN_TEST(test_age_across_clock_wrap);
+    RUN_TEST(test_power_on_rescan);
+    RUN_TEST(test_full_ring_overwrites_oldest);
+    return UNITY_END();
+}